@@ -0,0 +1,97 @@
+/*
+ * Times arc-length integration through the IntegrationFunction / void* callback
+ * against the template callable path used by NurbsCurve::ApproximateLength.
+ *
+ * Build with -DENABLE_BENCHMARKS=ON and run the Benchmarks executable in Release.
+ */
+
+#include "NurbsCurve.h"
+#include "Integrator.h"
+#include "Constants.h"
+#include "XYZ.h"
+#include "XYZW.h"
+#include "LNObject.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace LNLib;
+
+namespace
+{
+	class FirstDerivativeLengthFunction : public IntegrationFunction
+	{
+		double operator()(double parameter, void* customData)
+		{
+			LN_NurbsCurve* curve = (LN_NurbsCurve*)customData;
+			return NurbsCurve::ComputeRationalCurveDerivatives(*curve, 1, parameter)[1].Length();
+		}
+	};
+
+	/// <summary>
+	/// Chebyshev arc length span by span through the virtual callback, as ApproximateLength did before the template integrators.
+	/// </summary>
+	double GetLengthByCallback(LN_NurbsCurve& curve, const std::vector<double>& series)
+	{
+		const std::vector<double>& knotVector = curve.KnotVector;
+		int n = static_cast<int>(curve.ControlPoints.size()) - 1;
+		FirstDerivativeLengthFunction function;
+		double length = 0.0;
+		for (int i = curve.Degree; i <= n; i++)
+		{
+			length += Integrator::ClenshawCurtisQuadrature(function, (void*)&curve, knotVector[i], knotVector[i + 1], series);
+		}
+		return length;
+	}
+
+	template<typename Function>
+	double MeasureMicroseconds(int repeat, Function function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repeat; i++)
+		{
+			function();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::micro>(end - start).count() / repeat;
+	}
+
+	void Run(const char* name, LN_NurbsCurve& curve, int repeat)
+	{
+		const std::vector<double>& series = Integrator::GetChebyshevSeries();
+
+		double callbackLength = 0.0;
+		double templateLength = 0.0;
+		// One untimed pass of each warms caches and the Chebyshev series.
+		callbackLength = GetLengthByCallback(curve, series);
+		templateLength = NurbsCurve::ApproximateLength(curve, IntegratorType::Chebyshev);
+
+		double callbackTime = MeasureMicroseconds(repeat, [&]() { callbackLength = GetLengthByCallback(curve, series); });
+		double templateTime = MeasureMicroseconds(repeat, [&]() { templateLength = NurbsCurve::ApproximateLength(curve, IntegratorType::Chebyshev); });
+
+		std::printf("%-24s spans %4d  callback %10.2f us  template %10.2f us  speedup %5.2fx  |difference| %.3e\n",
+			name, static_cast<int>(curve.ControlPoints.size()) - curve.Degree, callbackTime, templateTime,
+			callbackTime / templateTime, std::abs(callbackLength - templateLength));
+	}
+}
+
+int main()
+{
+	LN_NurbsCurve circle;
+	double radius = 100;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, radius, radius, circle);
+	Run("circle r=100", circle, 2000);
+
+	std::vector<XYZ> points;
+	for (int i = 0; i <= 400; i++)
+	{
+		double t = 8 * Constants::Pi * i / 400;
+		points.emplace_back(XYZ(10 * std::cos(t), 10 * std::sin(t), 2 * t));
+	}
+	LN_NurbsCurve helix;
+	NurbsCurve::GlobalInterpolation(3, points, helix);
+	Run("helix, cubic, 401 points", helix, 100);
+
+	return 0;
+}
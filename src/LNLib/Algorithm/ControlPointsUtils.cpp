@@ -11,8 +11,12 @@
 #include "ControlPointsUtils.h"
 #include "XYZ.h"
 #include "XYZW.h"
+#include "MatrixXd.h"
+#include "MathUtils.h"
+#include "ValidationUtils.h"
 #include "LNLibExceptions.h"
 #include <algorithm>
+#include <cmath>
 
 using namespace LNLib;
 
@@ -59,41 +63,102 @@ std::vector<std::vector<XYZW>> LNLib::ControlPointsUtils::ToXYZW(const std::vect
 }
 
 std::vector<std::vector<XYZW>> LNLib::ControlPointsUtils::Multiply(const std::vector<std::vector<XYZW>>& points, const std::vector<std::vector<double>>& coefficient)
+{
+	return Multiply(points, MatrixXd(coefficient));
+}
+
+std::vector<std::vector<XYZW>> LNLib::ControlPointsUtils::Multiply(const std::vector<std::vector<double>>& coefficient, const std::vector<std::vector<XYZW>>& points)
+{
+	return Multiply(MatrixXd(coefficient), points);
+}
+
+std::vector<std::vector<XYZW>> LNLib::ControlPointsUtils::Multiply(const std::vector<std::vector<XYZW>>& points, const MatrixXd& coefficient)
 {
 	int m = points.size();
-	int n = points[0].size();
-	int p = coefficient[0].size();
+	int n = coefficient.GetRowCount();
+	int p = coefficient.GetColumnCount();
 
 	std::vector<std::vector<XYZW>> result(m, std::vector<XYZW>(p));
 	for (int i = 0; i < m; i++)
 	{
-		for (int j = 0; j < p; j++)
+		for (int k = 0; k < n; k++)
 		{
-			for (int k = 0; k < n; k++)
+			const double* row = coefficient.GetRow(k);
+			for (int j = 0; j < p; j++)
 			{
-				result[i][j] += points[i][k] * coefficient[k][j];
+				result[i][j] += points[i][k] * row[j];
 			}
 		}
 	}
 	return result;
 }
 
-std::vector<std::vector<XYZW>> LNLib::ControlPointsUtils::Multiply(const std::vector<std::vector<double>>& coefficient, const std::vector<std::vector<XYZW>>& points)
+std::vector<std::vector<XYZW>> LNLib::ControlPointsUtils::Multiply(const MatrixXd& coefficient, const std::vector<std::vector<XYZW>>& points)
 {
-	int m = coefficient.size();
-	int n = coefficient[0].size();
+	int m = coefficient.GetRowCount();
+	int n = coefficient.GetColumnCount();
 	int p = points[0].size();
 
 	std::vector<std::vector<XYZW>> result(m, std::vector<XYZW>(p));
 	for (int i = 0; i < m; i++)
 	{
-		for (int j = 0; j < p; j++)
+		const double* row = coefficient.GetRow(i);
+		for (int k = 0; k < n; k++)
 		{
-			for (int k = 0; k < n; k++)
+			for (int j = 0; j < p; j++)
 			{
-				result[i][j] += coefficient[i][k] * points[k][j];
+				result[i][j] += row[k] * points[k][j];
 			}
 		}
 	}
 	return result;
-}
\ No newline at end of file
+}
+
+bool LNLib::ControlPointsUtils::ReduceBezierDegree(int degree, const std::vector<XYZW>& controlPoints, std::vector<XYZW>& updatedControlPoints)
+{
+	double tol = ValidationUtils::ComputeCurveModifyTolerance(controlPoints);
+
+	int r = (degree - 1) / 2;
+	updatedControlPoints.resize(degree);
+	updatedControlPoints[0] = controlPoints[0];
+	updatedControlPoints[degree - 1] = controlPoints[degree];
+
+	std::vector<double> alpha(degree);
+	for (int i = 0; i < degree; i++)
+	{
+		alpha[i] = double(i) / double(degree);
+	}
+	double error = 0.0;
+	if (degree % 2 == 0)
+	{
+		for (int i = 1; i < r + 1; i++)
+		{
+			updatedControlPoints[i] = (controlPoints[i] - alpha[i] * updatedControlPoints[i - 1]) / (1 - alpha[i]);
+		}
+		for (int i = degree - 2; i > r; i--)
+		{
+			updatedControlPoints[i] = (controlPoints[i + 1] - (1 - alpha[i + 1]) * updatedControlPoints[i + 1]) / alpha[i + 1];
+		}
+		error = (controlPoints[r + 1].Distance(0.5 * (updatedControlPoints[r] + updatedControlPoints[r + 1])));
+		double c = MathUtils::Binomial(degree, r + 1);
+		error = error * (c * pow(0.5, r + 1) * pow(1 - 0.5, degree - r - 1));
+	}
+	else
+	{
+		for (int i = 1; i < r; i++)
+		{
+			updatedControlPoints[i] = (controlPoints[i] - alpha[i] * updatedControlPoints[i - 1]) / (1 - alpha[i]);
+		}
+		for (int i = degree - 2; i > r; i--)
+		{
+			updatedControlPoints[i] = (controlPoints[i + 1] - (1 - alpha[i + 1]) * updatedControlPoints[i + 1]) / alpha[i + 1];
+		}
+		XYZW PLr = (controlPoints[r] - alpha[r] * updatedControlPoints[r - 1]) / (1 - alpha[r]);
+		XYZW PRr = (controlPoints[r + 1] - (1 - alpha[r + 1]) * updatedControlPoints[r + 1]) / alpha[r + 1];
+		updatedControlPoints[r] = 0.5 * (PLr + PRr);
+		error = PLr.Distance(PRr);
+		double maxU = (degree - std::sqrt(degree)) / (2 * degree);
+		error = error * 0.5 * (1 - alpha[r]) * (MathUtils::Binomial(degree, r) * pow(maxU, r) * pow(1 - maxU, r + 1) * (1 - 2 * maxU));
+	}
+	return error <= tol;
+}
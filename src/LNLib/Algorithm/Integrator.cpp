@@ -13,53 +13,19 @@
 #include "Constants.h"
 
 #include <cmath>
+#include <map>
+#include <mutex>
 
 namespace LNLib
 {
     double Integrator::Simpson(IntegrationFunction& function, void* customData, double start, double end)
     {
-        double st = (function)(start, customData);
-        double mt = (function)((start + end) / 2.0, customData);
-        double et = (function)((end), customData);
-        double result = ((end - start) / 6.0) * (st + 4 * mt + et);
-        return result;
+        return Simpson([&](double t) { return function(t, customData); }, start, end);
     }
 
 	double Integrator::Simpson(BinaryIntegrationFunction& function, void* customData, double uStart, double uEnd, double vStart, double vEnd)
 	{
-        double du = uEnd - uStart;
-        double dv = vEnd - vStart;
-        double hdu = 0.5 * du;
-        double hdv = 0.5 * dv;
-		
-        // Sample 9 points with weights
-        int sampleNumber = 9;
-        int patches = 4;
-        double uvw[27] = {
-            uStart,         vStart,         1,
-            uStart,         vStart + hdv,   4,
-            uStart,         vEnd,           1,
-            uStart + hdu,   vStart,         4,
-            uStart + hdu,   vStart + hdv,   16,
-            uStart + hdu,   vEnd,           4,
-            uEnd,           vStart,         1,
-            uEnd,           vStart + hdv,   4,
-            uEnd,           vEnd,           1,
-            };
-        
-        double sum = 0;
-        for(int i=0; i < sampleNumber; ++i)
-        {
-            double* base = uvw + i*3;
-            double u = base[0];
-            double v = base[1];
-            double w = base[2];
-            double f = function(u, v, customData);
-            sum += w * f;
-        }
-
-        sum *= du * dv / (sampleNumber * patches);
-        return sum;
+        return Simpson([&](double u, double v) { return function(u, v, customData); }, uStart, uEnd, vStart, vEnd);
 	}
 
     const std::vector<double> Integrator::GaussLegendreAbscissae =
@@ -118,6 +84,63 @@ namespace LNLib
         0.0123412297999871995468056670700372915759,
     };
 
+    const std::vector<double> Integrator::GaussKronrodAbscissae =
+    {
+        -0.991455371120812639206854697526329,
+        -0.949107912342758524526189684047851,
+        -0.864864423359769072789712788640926,
+        -0.741531185599394439863864773280788,
+        -0.586087235467691130294144845693013,
+        -0.405845151377397166906606412076961,
+        -0.207784955007898467600689403773245,
+        0.000000000000000000000000000000000,
+        0.207784955007898467600689403773245,
+        0.405845151377397166906606412076961,
+        0.586087235467691130294144845693013,
+        0.741531185599394439863864773280788,
+        0.864864423359769072789712788640926,
+        0.949107912342758524526189684047851,
+        0.991455371120812639206854697526329
+    };
+
+    const std::vector<double> Integrator::GaussKronrodWeights =
+    {
+        0.022935322010529224963732008058970,
+        0.063092092629978553290700663189204,
+        0.104790010322250183839876322541518,
+        0.140653259715525918745189590510238,
+        0.169004726639267902826583426598550,
+        0.190350578064785409913256402421014,
+        0.204432940075298892414161999234649,
+        0.209482141084727828012999174891714,
+        0.204432940075298892414161999234649,
+        0.190350578064785409913256402421014,
+        0.169004726639267902826583426598550,
+        0.140653259715525918745189590510238,
+        0.104790010322250183839876322541518,
+        0.063092092629978553290700663189204,
+        0.022935322010529224963732008058970
+    };
+
+    const std::vector<double> Integrator::GaussKronrodGaussWeights =
+    {
+        0.0,
+        0.129484966168869693270611432679082,
+        0.0,
+        0.279705391489276667901467771423780,
+        0.0,
+        0.381830050505118944950369775488975,
+        0.0,
+        0.417959183673469387755102040816327,
+        0.0,
+        0.381830050505118944950369775488975,
+        0.0,
+        0.279705391489276667901467771423780,
+        0.0,
+        0.129484966168869693270611432679082,
+        0.0
+    };
+
     std::vector<double> Integrator::ChebyshevSeries(int size)
     {
         std::vector<double> series(size);
@@ -163,119 +186,28 @@ namespace LNLib
         }
         return series;
     }
-    double Integrator::ClenshawCurtisQuadrature(IntegrationFunction& function, void* customData, double start, double end, std::vector<double>& series, double epsilon)
+    const std::vector<double>& Integrator::GetChebyshevSeries(int size)
     {
-        double integration;
-        int j, k, l;
-        double err, esf, eref, erefh, hh, ir, iback, irback, ba, ss, x, y, fx, errir;
-        int lenw = series.size() - 1;
-        esf = 10;
-        ba = 0.5 * (end - start);
-        ss = 2 * series[lenw];
-        x = ba * series[lenw];
-        series[0] = 0.5 * (function)(start, customData);
-        series[3] = 0.5 * (function)(end, customData);
-        series[2] = (function)(start + x, customData);
-        series[4] = (function)(end - x, customData);
-        series[1] = (function)(start + ba, customData);
-        eref = 0.5 * (fabs(series[0]) + std::fabs(series[1]) + std::fabs(series[2]) + std::fabs(series[3]) + std::fabs(series[4]));
-        series[0] += series[3];
-        series[2] += series[4];
-        ir = series[0] + series[1] + series[2];
-        integration = series[0] * series[lenw - 1] + series[1] * series[lenw - 2] + series[2] * series[lenw - 3];
-        erefh = eref * std::sqrt(epsilon);
-        eref *= epsilon;
-        hh = 0.25;
-        l = 2;
-        k = lenw - 5;
-        do {
-            iback = integration;
-            irback = ir;
-            x = ba * series[k + 1];
-            y = 0;
-            integration = series[0] * series[k];
-            for (j = 1; j <= l; j++) {
-                x += y;
-                y += ss * (ba - x);
-                fx = (function)(start + x, customData) + (function)(end - x, customData);
-                ir += fx;
-                integration += series[j] * series[k - j] + fx * series[k - j - l];
-                series[j + l] = fx;
-            }
-            ss = 2 * series[k + 1];
-            err = esf * l * std::fabs(integration - iback);
-            hh *= 0.25;
-            errir = hh * std::fabs(ir - 2 * irback);
-            l *= 2;
-            k -= l + 2;
-        } while ((err > erefh || errir > eref) && k > 4 * l);
-        integration *= end - start;
-        if (err > erefh || errir > eref)
-        {
-            err *= -fabs(end - start);
-        }
-        else
+        static std::map<int, std::vector<double>> seriesMap;
+        static std::mutex seriesMutex;
+
+        std::lock_guard<std::mutex> lock(seriesMutex);
+        auto it = seriesMap.find(size);
+        if (it == seriesMap.end())
         {
-            err = eref * std::fabs(end - start);
+            it = seriesMap.emplace(size, ChebyshevSeries(size)).first;
         }
-        return integration;
+        return it->second;
+    }
+
+    double Integrator::ClenshawCurtisQuadrature(IntegrationFunction& function, void* customData, double start, double end, const std::vector<double>& series, double epsilon)
+    {
+        return ClenshawCurtis([&](double t) { return function(t, customData); }, start, end, series, epsilon);
     }
+
     double Integrator::ClenshawCurtisQuadrature2(IntegrationFunction& function, void* customData, double start, double end, std::vector<double> series, double epsilon)
     {
-        double integration;
-        int j, k, l;
-        double err, esf, eref, erefh, hh, ir, iback, irback, ba, ss, x, y, fx, errir;
-        int lenw = series.size() - 1;
-        esf = 10;
-        ba = 0.5 * (end - start);
-        ss = 2 * series[lenw];
-        x = ba * series[lenw];
-        series[0] = 0.5 * (function)(start, customData);
-        series[3] = 0.5 * (function)(end, customData);
-        series[2] = (function)(start + x, customData);
-        series[4] = (function)(end - x, customData);
-        series[1] = (function)(start + ba, customData);
-        eref = 0.5 * (fabs(series[0]) + std::fabs(series[1]) + std::fabs(series[2]) + std::fabs(series[3]) + std::fabs(series[4]));
-        series[0] += series[3];
-        series[2] += series[4];
-        ir = series[0] + series[1] + series[2];
-        integration = series[0] * series[lenw - 1] + series[1] * series[lenw - 2] + series[2] * series[lenw - 3];
-        erefh = eref * std::sqrt(epsilon);
-        eref *= epsilon;
-        hh = 0.25;
-        l = 2;
-        k = lenw - 5;
-        do {
-            iback = integration;
-            irback = ir;
-            x = ba * series[k + 1];
-            y = 0;
-            integration = series[0] * series[k];
-            for (j = 1; j <= l; j++) {
-                x += y;
-                y += ss * (ba - x);
-                fx = (function)(start + x, customData) + (function)(end - x, customData);
-                ir += fx;
-                integration += series[j] * series[k - j] + fx * series[k - j - l];
-                series[j + l] = fx;
-            }
-            ss = 2 * series[k + 1];
-            err = esf * l * std::fabs(integration - iback);
-            hh *= 0.25;
-            errir = hh * std::fabs(ir - 2 * irback);
-            l *= 2;
-            k -= l + 2;
-        } while ((err > erefh || errir > eref) && k > 4 * l);
-        integration *= end - start;
-        if (err > erefh || errir > eref)
-        {
-            err *= -fabs(end - start);
-        }
-        else
-        {
-            err = eref * std::fabs(end - start);
-        }
-        return integration;
+        return ClenshawCurtisQuadrature(function, customData, start, end, series, epsilon);
     }
 }
 
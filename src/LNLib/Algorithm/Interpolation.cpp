@@ -200,6 +200,41 @@ bool LNLib::Interpolation::ComputerWeightForRationalQuadraticInterpolation(const
 	return true;
 }
 
+void LNLib::Interpolation::ComputeInterpolationMatrix(int degree, const std::vector<double>& knotVector, const std::vector<double>& params, MatrixXd& band, int& lower, int& upper)
+{
+	int size = params.size();
+	int n = size - 1;
+	int last = knotVector.size() - degree - 2;
+
+	std::vector<int> spanIndices(size);
+	int spanIndex = degree;
+	lower = 0;
+	upper = 0;
+	for (int i = 1; i < n; i++)
+	{
+		while (spanIndex < last && params[i] >= knotVector[spanIndex + 1])
+		{
+			spanIndex++;
+		}
+		spanIndices[i] = spanIndex;
+		lower = std::max(lower, i - (spanIndex - degree));
+		upper = std::max(upper, spanIndex - i);
+	}
+
+	band = MatrixXd(size, lower + upper + 1);
+	band(0, lower) = 1.0;
+	band(n, lower) = 1.0;
+	for (int i = 1; i < n; i++)
+	{
+		double basis[Constants::NURBSMaxDegree + 1];
+		Polynomials::BasisFunctions(spanIndices[i], degree, knotVector, params[i], basis);
+		for (int j = 0; j <= degree; j++)
+		{
+			band(i, spanIndices[i] - degree + j - i + lower) = basis[j];
+		}
+	}
+}
+
 bool LNLib::Interpolation::GetSurfaceMeshParameterization(const std::vector<std::vector<XYZ>>& throughPoints, std::vector<double>& paramsU, std::vector<double>& paramsV)
 {
 	int n = throughPoints.size();
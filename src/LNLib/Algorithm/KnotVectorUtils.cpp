@@ -9,6 +9,7 @@
  */
 
 #include "KnotVectorUtils.h"
+#include "LNObject.h"
 #include "UV.h"
 #include "MathUtils.h"
 #include "Polynomials.h"
@@ -45,6 +46,64 @@ namespace LNLib
 			InsertMidKnotCore(unqiueKnotVector, insert, limitNumber);
 		}
 	}
+
+	/// <summary>
+	/// Algorithm A5.5 knot pass once the spans a and b of the first and last insert knots are known.
+	/// </summary>
+	void GetKnotRefinementCore(int degree, const std::vector<double>& knotVector, const std::vector<double>& insertKnotElements, int a, int b, LN_KnotRefinement& refinement)
+	{
+		int n = knotVector.size() - degree - 2;
+		int m = n + degree + 1;
+		int r = insertKnotElements.size() - 1;
+
+		refinement.Degree = degree;
+		refinement.SpanStart = a;
+		refinement.SpanEnd = b;
+		refinement.Copies.resize(r + 1);
+		refinement.Alphas.resize((r + 1) * degree);
+
+		std::vector<double>& insertedKnotVector = refinement.KnotVector;
+		insertedKnotVector.resize(m + r + 2);
+		for (int j = 0; j <= a; j++)
+		{
+			insertedKnotVector[j] = knotVector[j];
+		}
+		for (int j = b + degree; j <= m; j++)
+		{
+			insertedKnotVector[j + r + 1] = knotVector[j];
+		}
+
+		int i = b + degree - 1;
+		int k = b + degree + r;
+		for (int j = r, step = 0; j >= 0; j--, step++)
+		{
+			int copies = 0;
+			while (insertKnotElements[j] <= knotVector[i] && i > a)
+			{
+				insertedKnotVector[k] = knotVector[i];
+				k--;
+				i--;
+				copies++;
+			}
+			refinement.Copies[step] = copies;
+
+			for (int l = 1; l <= degree; l++)
+			{
+				double alpha = insertedKnotVector[k + l] - insertKnotElements[j];
+				if (MathUtils::IsAlmostEqualTo(std::abs(alpha), 0.0))
+				{
+					alpha = 0.0;
+				}
+				else
+				{
+					alpha = alpha / (insertedKnotVector[k + l] - knotVector[i - degree + l]);
+				}
+				refinement.Alphas[step * degree + l - 1] = alpha;
+			}
+			insertedKnotVector[k] = insertKnotElements[j];
+			k--;
+		}
+	}
 }
 
 int LNLib::KnotVectorUtils::GetContinuity(int degree, const std::vector<double>& knotVector, double knot)
@@ -54,6 +113,74 @@ int LNLib::KnotVectorUtils::GetContinuity(int degree, const std::vector<double>&
 	return degree - multi;
 }
 
+void LNLib::KnotVectorUtils::CreateKnotStructure(int degree, const std::vector<double>& knotVector, LN_KnotStructure& structure)
+{
+	VALIDATE_ARGUMENT(degree >= 0, "degree", "Degree must be greater than or equal zero.");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
+
+	structure.Degree = degree;
+	structure.Knots.clear();
+	structure.Multiplicities.clear();
+	structure.SpanStarts.clear();
+	structure.Continuities.clear();
+
+	int size = static_cast<int>(knotVector.size());
+	for (int i = 0; i < size; i++)
+	{
+		if (structure.Knots.empty() || !MathUtils::IsAlmostEqualTo(structure.Knots.back(), knotVector[i]))
+		{
+			structure.Knots.emplace_back(knotVector[i]);
+			structure.Multiplicities.emplace_back(0);
+			structure.SpanStarts.emplace_back(i);
+		}
+		structure.Multiplicities.back()++;
+		structure.SpanStarts.back() = i;
+	}
+
+	structure.Continuities.resize(structure.Knots.size());
+	for (int i = 0; i < structure.Knots.size(); i++)
+	{
+		structure.Continuities[i] = degree - structure.Multiplicities[i];
+	}
+}
+
+int LNLib::KnotVectorUtils::GetKnotIndex(const LN_KnotStructure& structure, double knot)
+{
+	const std::vector<double>& knots = structure.Knots;
+	auto it = std::partition_point(knots.begin(), knots.end(), [knot](double k) { return k < knot && !MathUtils::IsAlmostEqualTo(k, knot); });
+	if (it == knots.end() || !MathUtils::IsAlmostEqualTo(*it, knot))
+	{
+		return -1;
+	}
+	return static_cast<int>(it - knots.begin());
+}
+
+int LNLib::KnotVectorUtils::GetKnotMultiplicity(const LN_KnotStructure& structure, double knot)
+{
+	int index = GetKnotIndex(structure, knot);
+	return index < 0 ? 0 : structure.Multiplicities[index];
+}
+
+int LNLib::KnotVectorUtils::GetContinuity(const LN_KnotStructure& structure, double knot)
+{
+	return structure.Degree - GetKnotMultiplicity(structure, knot);
+}
+
+int LNLib::KnotVectorUtils::GetKnotSpanIndex(const LN_KnotStructure& structure, double knot)
+{
+	const std::vector<double>& knots = structure.Knots;
+	auto it = std::partition_point(knots.begin(), knots.end(), [knot](double k) { return k < knot || MathUtils::IsAlmostEqualTo(k, knot); });
+	int index = static_cast<int>(it - knots.begin()) - 1;
+
+	int degree = structure.Degree;
+	int n = structure.SpanStarts.back() - degree - 1;
+	if (index < 0)
+	{
+		return degree;
+	}
+	return std::max(degree, std::min(structure.SpanStarts[index], n));
+}
+
 std::vector<double> LNLib::KnotVectorUtils::Rescale(const std::vector<double>& knotVector, double min, double max)
 {
 	double origintMin = knotVector[0];
@@ -64,7 +191,7 @@ std::vector<double> LNLib::KnotVectorUtils::Rescale(const std::vector<double>& k
 	std::vector<double> result(size);
 	for (int i = 0; i < size; i++)
 	{
-		result[i] = (k * knotVector[i] - origintMin) + min;
+		result[i] = k * (knotVector[i] - origintMin) + min;
 	}
 	return result;
 }
@@ -99,17 +226,13 @@ std::vector<double> LNLib::KnotVectorUtils::GetInsertedKnotElement(int degree, c
 
 std::map<double, int> LNLib::KnotVectorUtils::GetKnotMultiplicityMap(const std::vector<double>& knotVector)
 {
-	std::map<double, int> result;
+	LN_KnotStructure structure;
+	CreateKnotStructure(0, knotVector, structure);
 
-	for (int i = 0; i < knotVector.size(); i++)
+	std::map<double, int> result;
+	for (int i = 0; i < structure.Knots.size(); i++)
 	{
-		double knot = knotVector[i];
-		auto got = result.find(knot);
-		if (got == result.end())
-		{
-			int multi = Polynomials::GetKnotMultiplicity(knotVector, knotVector[i]);
-			result.insert(std::make_pair(knotVector[i], multi));
-		}
+		result.emplace_hint(result.end(), structure.Knots[i], structure.Multiplicities[i]);
 	}
 	return result;
 }
@@ -128,61 +251,43 @@ std::map<double, int> LNLib::KnotVectorUtils::GetInternalKnotMultiplicityMap(con
 
 void LNLib::KnotVectorUtils::GetInsertedKnotElement(const std::vector<double>& knotVector0, const std::vector<double>& knotVector1, std::vector<double>& insertElements0, std::vector<double>& insertElements1)
 {
-	std::map<double, int> map0 = GetKnotMultiplicityMap(knotVector0);
-	std::map<double, int> map1 = GetKnotMultiplicityMap(knotVector1);
+	LN_KnotStructure structure0;
+	CreateKnotStructure(0, knotVector0, structure0);
+	LN_KnotStructure structure1;
+	CreateKnotStructure(0, knotVector1, structure1);
 
-	for (auto it = map0.begin(); it != map0.end(); ++it)
+	const std::vector<double>& knots0 = structure0.Knots;
+	const std::vector<double>& knots1 = structure1.Knots;
+	int i = 0;
+	int j = 0;
+	while (i < knots0.size() || j < knots1.size())
 	{
-		double key0 = it->first;
-		int count0 = it->second;
-
-		auto got = map1.find(key0);
-		if (got == map1.end())
+		if (j == knots1.size() || (i < knots0.size() && knots0[i] < knots1[j] && !MathUtils::IsAlmostEqualTo(knots0[i], knots1[j])))
 		{
-			for (int i = 0; i < count0; i++)
-			{
-				insertElements1.emplace_back(key0);
-			}
+			insertElements1.insert(insertElements1.end(), structure0.Multiplicities[i], knots0[i]);
+			i++;
+		}
+		else if (i == knots0.size() || !MathUtils::IsAlmostEqualTo(knots0[i], knots1[j]))
+		{
+			insertElements0.insert(insertElements0.end(), structure1.Multiplicities[j], knots1[j]);
+			j++;
 		}
 		else
 		{
-			int count1 = got->second;
+			int count0 = structure0.Multiplicities[i];
+			int count1 = structure1.Multiplicities[j];
 			if (count0 > count1)
 			{
-				int times = count0 - count1;
-				for (int j = 0; j < times; j++)
-				{
-					insertElements1.emplace_back(key0);
-				}
+				insertElements1.insert(insertElements1.end(), count0 - count1, knots0[i]);
 			}
 			else
 			{
-				int times = count1 - count0;
-				for (int j = 0; j < times; j++)
-				{
-					insertElements0.emplace_back(key0);
-				}
-			}
-		}
-	}
-
-	for (auto it = map1.begin(); it != map1.end(); ++it)
-	{
-		double key1 = it->first;
-		int count1 = it->second;
-
-		auto got = map0.find(key1);
-		if (got == map0.end())
-		{
-			for (int i = 0; i < count1; i++)
-			{
-				insertElements0.emplace_back(key1);
+				insertElements0.insert(insertElements0.end(), count1 - count0, knots0[i]);
 			}
+			i++;
+			j++;
 		}
 	}
-
-	std::sort(insertElements0.begin(), insertElements0.end());
-	std::sort(insertElements1.begin(), insertElements1.end());
 }
 
 std::vector<std::vector<double>> LNLib::KnotVectorUtils::GetInsertedKnotElements(const std::vector<std::vector<double>>& knotVectors)
@@ -260,49 +365,105 @@ std::vector<double> LNLib::KnotVectorUtils::GetInsertedKnotElements(int insertKn
 
 bool LNLib::KnotVectorUtils::IsUniform(const std::vector<double>& knotVector)
 {
-	auto map = GetKnotMultiplicityMap(knotVector);
-	if (map.empty())
+	LN_KnotStructure structure;
+	CreateKnotStructure(0, knotVector, structure);
+
+	const std::vector<double>& knots = structure.Knots;
+	const std::vector<int>& multiplicities = structure.Multiplicities;
+	int size = static_cast<int>(knots.size());
+	if (size < 2)
 	{
 		return false;
 	}
-	std::vector<double> knots;
-	for (auto it = map.begin(); it != map.end(); ++it)
-	{
-		double key = it->first;
-		knots.emplace_back(key);
-	}
-	std::sort(knots.begin(), knots.end());
-	if (map[knots[0]] != map[knots[knots.size() - 1]])
+	if (multiplicities[0] != multiplicities[size - 1])
 	{
 		return false;
 	}
 	double standard = knots[1] - knots[0];
-	for (int i = 1; i < knots.size() - 1; i++)
+	for (int i = 1; i < size - 1; i++)
 	{
-		double current = knots[i];
-		double next = knots[i + 1];
-
-		double gap = next - current;
+		double gap = knots[i + 1] - knots[i];
 		if (!MathUtils::IsAlmostEqualTo(gap, standard))
 		{
 			return false;
 		}
-		int currentCounts = map[current];
-		int nextCounts = map[next];
-		if (currentCounts != nextCounts)
+		if (multiplicities[i] != multiplicities[i + 1] && i + 1 != size - 1)
 		{
-			if (i + 1 == knots.size() - 1)
-			{
-				continue;
-			}
-			else
-			{
-				return false;
-			}
+			return false;
 		}
 	}
 	return true;
 }
 
+std::vector<double> LNLib::KnotVectorUtils::GetElevatedKnotVector(const std::vector<double>& knotVector, int times)
+{
+	int size = knotVector.size();
+	std::vector<double> elevatedKnotVector;
+	for (int i = 0; i < size; i++)
+	{
+		elevatedKnotVector.emplace_back(knotVector[i]);
+		if (i + 1 == size || knotVector[i + 1] != knotVector[i])
+		{
+			elevatedKnotVector.insert(elevatedKnotVector.end(), times, knotVector[i]);
+		}
+	}
+	return elevatedKnotVector;
+}
+
+void LNLib::KnotVectorUtils::GetKnotRefinement(int degree, const std::vector<double>& knotVector, const std::vector<double>& insertKnotElements, LN_KnotRefinement& refinement)
+{
+	VALIDATE_ARGUMENT(insertKnotElements.size() > 0, "insertKnotElements", "insertKnotElements size must be greater than zero.");
+
+	int a = Polynomials::GetKnotSpanIndex(degree, knotVector, insertKnotElements.front());
+	int b = Polynomials::GetKnotSpanIndex(degree, knotVector, insertKnotElements.back()) + 1;
+	GetKnotRefinementCore(degree, knotVector, insertKnotElements, a, b, refinement);
+}
+
+void LNLib::KnotVectorUtils::GetKnotRefinement(const LN_KnotStructure& structure, const std::vector<double>& knotVector, const std::vector<double>& insertKnotElements, LN_KnotRefinement& refinement)
+{
+	VALIDATE_ARGUMENT(insertKnotElements.size() > 0, "insertKnotElements", "insertKnotElements size must be greater than zero.");
+
+	int a = GetKnotSpanIndex(structure, insertKnotElements.front());
+	int b = GetKnotSpanIndex(structure, insertKnotElements.back()) + 1;
+	GetKnotRefinementCore(structure.Degree, knotVector, insertKnotElements, a, b, refinement);
+}
+
+void LNLib::KnotVectorUtils::GetNeighborhoodRange(int degree, const std::vector<double>& knotVector, double knot, double& startParam, double& endParam)
+{
+	int n = static_cast<int>(knotVector.size()) - degree - 2;
+	int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, knot);
+
+	int low = spanIndex;
+	while (low > degree && MathUtils::IsAlmostEqualTo(knotVector[low - 1], knotVector[low]))
+	{
+		low--;
+	}
+	if (low > degree)
+	{
+		low--;
+	}
+
+	int high = spanIndex + 1;
+	if (high <= n)
+	{
+		high++;
+		while (high <= n && MathUtils::IsAlmostEqualTo(knotVector[high - 1], knotVector[high]))
+		{
+			high++;
+		}
+	}
+
+	startParam = knotVector[low];
+	endParam = knotVector[high];
+}
+
+bool LNLib::KnotVectorUtils::IsOnInteriorBound(int degree, const std::vector<double>& knotVector, double param, double startParam, double endParam)
+{
+	int n = static_cast<int>(knotVector.size()) - degree - 2;
+	bool isOnStart = MathUtils::IsAlmostEqualTo(param, startParam) && !MathUtils::IsAlmostEqualTo(startParam, knotVector[degree]);
+	bool isOnEnd = MathUtils::IsAlmostEqualTo(param, endParam) && !MathUtils::IsAlmostEqualTo(endParam, knotVector[n + 1]);
+	return isOnStart || isOnEnd;
+}
+
 
 
@@ -108,18 +108,9 @@ int LNLib::Polynomials::GetKnotMultiplicity(const std::vector<double>& knotVecto
 	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
 	VALIDATE_ARGUMENT_RANGE(knot, knotVector[0], knotVector[knotVector.size() - 1]);
 	
-	int size = knotVector.size();
-	int multi = 0;
-
-	for (int index = 0; index < size; index++)
-	{
-		if (MathUtils::IsAlmostEqualTo(knot, knotVector[index]))
-		{
-			multi++;
-		}
-	}
-
-	return multi;
+	auto first = std::partition_point(knotVector.begin(), knotVector.end(), [knot](double k) { return k < knot && !MathUtils::IsAlmostEqualTo(k, knot); });
+	auto last = std::partition_point(first, knotVector.end(), [knot](double k) { return k <= knot || MathUtils::IsAlmostEqualTo(k, knot); });
+	return static_cast<int>(last - first);
 }
 
 int LNLib::Polynomials::GetKnotSpanIndex(int degree, const std::vector<double>& knotVector, double paramT)
@@ -164,7 +155,7 @@ void LNLib::Polynomials::BasisFunctions(int spanIndex, int degree, const std::ve
 	VALIDATE_ARGUMENT(spanIndex >= 0, "spanIndex", "SpanIndex must be greater than or equal zero.");
 	VALIDATE_ARGUMENT(degree >= 0 && degree <= Constants::NURBSMaxDegree, "degree", "Degree must be greater than or equal zero and not exceed the maximun degree.");
 	VALIDATE_ARGUMENT(knotVector.size() > 0, "knotVector", "KnotVector size must be greater than zero.");
-	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector, spanIndex, degree), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
 	VALIDATE_ARGUMENT_RANGE(paramT, knotVector[0], knotVector[knotVector.size() - 1]);
 
 	basisFunctions[0] = 1.0;
@@ -197,7 +188,7 @@ std::vector<std::vector<double>> LNLib::Polynomials::BasisFunctionsDerivatives(i
 	VALIDATE_ARGUMENT(degree >= 0 && degree <= Constants::NURBSMaxDegree, "degree", "Degree must be greater than or equal zero and not exceed the maximun degree.");
 	VALIDATE_ARGUMENT(derivative <= degree, "derivative", "Derivative must not be greater than degree.");
 	VALIDATE_ARGUMENT(knotVector.size() > 0, "knotVector", "KnotVector size must be greater than zero.");
-	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector, spanIndex, degree), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
 	VALIDATE_ARGUMENT_RANGE(paramT, knotVector[0], knotVector[knotVector.size() - 1]);
 
 	std::vector<std::vector<double>> derivatives(derivative + 1, std::vector<double>(degree + 1));
@@ -301,7 +292,7 @@ void LNLib::Polynomials::BasisFunctionsFirstOrderDerivative(int spanIndex, int d
 	VALIDATE_ARGUMENT(degree >= 0 && degree <= Constants::NURBSMaxDegree, "degree", "Degree must be greater than or equal zero and not exceed the maximun degree.");
 	VALIDATE_ARGUMENT(1 <= degree, "derivative", "Derivative must not be greater than degree.");
 	VALIDATE_ARGUMENT(knotVector.size() > 0, "knotVector", "KnotVector size must be greater than zero.");
-	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector, spanIndex, degree), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
 	VALIDATE_ARGUMENT_RANGE(paramT, knotVector[0], knotVector[knotVector.size() - 1]);
 
 	double ndu[Constants::NURBSMaxDegree + 1][Constants::NURBSMaxDegree + 1];
@@ -635,3 +626,29 @@ std::vector<std::vector<double>> LNLib::Polynomials::PowerToBezierMatrix(int deg
 	}
 	return inverseMatrix;
 }
+
+std::vector<std::vector<double>> LNLib::Polynomials::GetDegreeElevationCoefficients(int degree, int times)
+{
+	int ph = degree + times;
+	int ph2 = ph / 2;
+	std::vector<std::vector<double>> bezalfs(ph + 1, std::vector<double>(degree + 1));
+	bezalfs[0][0] = bezalfs[ph][degree] = 1.0;
+	for (int i = 1; i <= ph2; i++)
+	{
+		double inv = 1.0 / MathUtils::Binomial(ph, i);
+		int mpi = std::min(degree, i);
+		for (int j = std::max(0, i - times); j <= mpi; j++)
+		{
+			bezalfs[i][j] = inv * MathUtils::Binomial(degree, j) * MathUtils::Binomial(times, i - j);
+		}
+	}
+	for (int i = ph2 + 1; i <= ph - 1; i++)
+	{
+		int mpi = std::min(degree, i);
+		for (int j = std::max(0, i - times); j <= mpi; j++)
+		{
+			bezalfs[i][j] = bezalfs[ph - i][degree - j];
+		}
+	}
+	return bezalfs;
+}
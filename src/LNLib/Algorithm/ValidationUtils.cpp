@@ -25,6 +25,14 @@ bool LNLib::ValidationUtils::IsValidKnotVector(const std::vector<double>& knotVe
 	return std::is_sorted(knotVector.begin(), knotVector.end());
 }
 
+bool LNLib::ValidationUtils::IsValidKnotVector(const std::vector<double>& knotVector, int spanIndex, int degree)
+{
+	int last = spanIndex + degree;
+	if (last >= knotVector.size()) return false;
+	int first = std::max(0, spanIndex - degree + 1);
+	return std::is_sorted(knotVector.begin() + first, knotVector.begin() + last + 1);
+}
+
 bool LNLib::ValidationUtils::IsValidBspline(int degree, int knotVectorCount, int controlPointsCount)
 {
 	return (knotVectorCount - 1) == (controlPointsCount - 1) + degree + 1;
@@ -24,25 +24,331 @@
 #include "ControlPointsUtils.h"
 #include "Interpolation.h"
 #include "Integrator.h"
+#include "ThreadUtils.h"
 #include "LNLibExceptions.h"
 #include "LNObject.h"
 
 #include <vector>
 #include <set>
+#include <queue>
+#include <tuple>
 #include <random>
 #include <algorithm>
 #include <cmath>
 
 namespace LNLib
 {
-	class FirstDerivativeLengthFunction : public IntegrationFunction
+	/// <summary>
+	/// Solve matrix * result = right, where row i of matrix holds values[i] starting at column firstColumns[i].
+	/// </summary>
+	bool SolveBandedRows(const std::vector<int>& firstColumns, const std::vector<std::vector<double>>& values, const MatrixXd& right, MatrixXd& result)
 	{
-		double operator()(double parameter, void* customData)
+		int size = static_cast<int>(firstColumns.size());
+		int lower = 0;
+		int upper = 0;
+		for (int i = 0; i < size; i++)
 		{
-			LN_NurbsCurve* curve = (LN_NurbsCurve*)customData;
-			return NurbsCurve::ComputeRationalCurveDerivatives(*curve, 1, parameter)[1].Length();
+			lower = std::max(lower, i - firstColumns[i]);
+			upper = std::max(upper, firstColumns[i] + static_cast<int>(values[i].size()) - 1 - i);
 		}
-	};
+
+		MatrixXd band(size, lower + upper + 1);
+		for (int i = 0; i < size; i++)
+		{
+			for (int j = 0; j < values[i].size(); j++)
+			{
+				band(i, firstColumns[i] + j - i + lower) = values[i][j];
+			}
+		}
+		return MathUtils::SolveBandedLinearSystem(band, lower, upper, right, result);
+	}
+
+	/// <summary>
+	/// Knot span index of paramT, searched forward from spanIndex.
+	/// Used for increasing parameters to avoid a full search and validation per parameter,
+	/// falls back to a binary search when paramT lies before spanIndex.
+	/// </summary>
+	int GetNextKnotSpanIndex(int degree, const std::vector<double>& knotVector, double paramT, int spanIndex)
+	{
+		int n = static_cast<int>(knotVector.size()) - degree - 2;
+		if (paramT < knotVector[spanIndex])
+		{
+			auto it = std::upper_bound(knotVector.begin() + degree + 1, knotVector.begin() + n + 1, paramT);
+			return static_cast<int>(it - knotVector.begin()) - 1;
+		}
+		while (spanIndex < n && paramT >= knotVector[spanIndex + 1])
+		{
+			spanIndex++;
+		}
+		return spanIndex;
+	}
+
+	/// <summary>
+	/// Least squares control points of a curve with fixed knotVector through the first and last point,
+	/// approximating throughPoints at params uk.
+	/// </summary>
+	bool LeastSquaresControlPoints(int degree, const std::vector<XYZ>& throughPoints, const std::vector<double>& knotVector, const std::vector<double>& uk, int n, std::vector<XYZW>& controlPoints)
+	{
+		int m = throughPoints.size();
+
+		// Accumulate the lower half of NsT * Ns and R = NT * rk point by point,
+		// without forming the m x n matrix N.
+		int interior = n - 2;
+		controlPoints.resize(n);
+		std::vector<XYZ> R(n, XYZ());
+		MatrixXd NsTNs(std::max(interior, 0), degree + 1);
+		int spanIndex = degree;
+		for (int i = 0; i < m; i++)
+		{
+			spanIndex = GetNextKnotSpanIndex(degree, knotVector, uk[i], spanIndex);
+			double basis[Constants::NURBSMaxDegree + 1];
+			Polynomials::BasisFunctions(spanIndex, degree, knotVector, uk[i], basis);
+
+			int first = spanIndex - degree;
+			double n0 = first == 0 ? basis[0] : 0.0;
+			double nn = spanIndex == n - 1 ? basis[degree] : 0.0;
+			XYZ rk = throughPoints[i] - n0 * throughPoints[0] - nn * throughPoints[m - 1];
+			for (int j = 0; j <= degree; j++)
+			{
+				int row = first + j;
+				R[row] += basis[j] * rk;
+				if (row < 1 || row > interior) continue;
+				for (int k = 0; k <= j; k++)
+				{
+					int column = first + k;
+					if (column < 1) continue;
+					NsTNs(row - 1, column - row + degree) += basis[j] * basis[k];
+				}
+			}
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			if (R[i].IsAlmostEqualTo(XYZ()))
+			{
+				return false;
+			}
+		}
+
+		if (interior > 0)
+		{
+			MatrixXd X(interior, 3);
+			for (int i = 0; i < interior; i++)
+			{
+				for (int j = 0; j < 3; j++)
+				{
+					X(i, j) = R[i + 1][j];
+				}
+			}
+			if (!MathUtils::BandedCholeskyDecomposition(NsTNs, degree))
+			{
+				return false;
+			}
+			MathUtils::BandedCholeskySolve(NsTNs, degree, X);
+
+			for (int i = 0; i < interior; i++)
+			{
+				controlPoints[i + 1] = XYZW(XYZ(X(i, 0), X(i, 1), X(i, 2)), 1);
+			}
+		}
+		controlPoints[0] = XYZW(throughPoints[0], 1);
+		controlPoints[n - 1] = XYZW(throughPoints[m - 1], 1);
+		return true;
+	}
+
+	/// <summary>
+	/// The NURBS Book 2nd Edition Page428
+	/// Algorithm A9.8 on the last occurrence r of a knot with multiplicity s,
+	/// reading only the control points and knots around r.
+	/// </summary>
+	double GetRemoveKnotErrorBound(int degree, const std::vector<double>& knotVector, const std::vector<XYZW>& controlPoints, int r, int s)
+	{
+		int ord = degree + 1;
+		double u = knotVector[r];
+		int last = r - s;
+		int first = r - degree;
+		int off = first - 1;
+
+		XYZW temp[Constants::NURBSMaxDegree + 3];
+		temp[0] = controlPoints[off];
+		temp[last + 1 - off] = controlPoints[last + 1];
+
+		int i = first, j = last;
+		int ii = 1, jj = last - off;
+		while (j - i > 0)
+		{
+			double alfi = (u - knotVector[i]) / (knotVector[i + ord] - knotVector[i]);
+			double alfj = (u - knotVector[j]) / (knotVector[j + ord] - knotVector[j]);
+			temp[ii] = (controlPoints[i] - (1.0 - alfi) * temp[ii - 1]) / alfi;
+			temp[jj] = (controlPoints[j] - alfj * temp[jj + 1]) / (1.0 - alfj);
+			i++;
+			ii++;
+			j--;
+			jj--;
+		}
+		if (j - i < 0)
+		{
+			return temp[ii - 1].Distance(temp[jj + 1]);
+		}
+		double alfi = (u - knotVector[i]) / (knotVector[i + ord] - knotVector[i]);
+		return controlPoints[i].Distance(alfi * temp[ii + 1] + (1.0 - alfi) * temp[ii - 1]);
+	}
+
+	/// <summary>
+	/// The NURBS Book 2nd Edition Page185
+	/// Algorithm A5.8 removing the last occurrence r of a knot with multiplicity s once, without the tolerance check.
+	/// </summary>
+	void RemoveKnotOnce(int degree, std::vector<double>& knotVector, std::vector<XYZW>& controlPoints, int r, int s)
+	{
+		int ord = degree + 1;
+		double u = knotVector[r];
+		int last = r - s;
+		int first = r - degree;
+		int off = first - 1;
+
+		XYZW temp[Constants::NURBSMaxDegree + 3];
+		temp[0] = controlPoints[off];
+		temp[last + 1 - off] = controlPoints[last + 1];
+
+		int i = first, j = last;
+		int ii = 1, jj = last - off;
+		while (j - i > 0)
+		{
+			double alfi = (u - knotVector[i]) / (knotVector[i + ord] - knotVector[i]);
+			double alfj = (u - knotVector[j]) / (knotVector[j + ord] - knotVector[j]);
+			temp[ii] = (controlPoints[i] - (1.0 - alfi) * temp[ii - 1]) / alfi;
+			temp[jj] = (controlPoints[j] - alfj * temp[jj + 1]) / (1.0 - alfj);
+			i++;
+			ii++;
+			j--;
+			jj--;
+		}
+
+		i = first;
+		j = last;
+		while (j - i > 0)
+		{
+			controlPoints[i] = temp[i - off];
+			controlPoints[j] = temp[j - off];
+			i++;
+			j--;
+		}
+
+		// With an odd count both middle values are saved, keep the one from the left
+		// so that the change of the curve matches the bound used by A9.9.
+		int middle = (2 * r - s - degree) / 2;
+		if ((degree + s) % 2)
+		{
+			middle++;
+		}
+		controlPoints.erase(controlPoints.begin() + middle);
+		knotVector.erase(knotVector.begin() + r);
+	}
+
+	/// <summary>
+	/// Algorithm A5.1 once the span and multiplicity of insertKnot are known.
+	/// </summary>
+	int InsertKnotAtSpan(const LN_NurbsCurve& curve, int knotSpanIndex, int originMultiplicity, double insertKnot, int times, LN_NurbsCurve& result)
+	{
+		int degree = curve.Degree;
+		const std::vector<double>& knotVector = curve.KnotVector;
+		const std::vector<XYZW>& controlPoints = curve.ControlPoints;
+
+		if (originMultiplicity + times > degree + 1)
+		{
+			times = degree - 1 - originMultiplicity;
+		}
+		if (times <= 0)
+		{
+			return 0;
+		}
+		
+		std::vector<double> insertedKnotVector(knotVector.size() + times);
+		for (int i = 0; i <= knotSpanIndex; i++)
+		{
+			insertedKnotVector[i] = knotVector[i];
+		}
+		for (int i = 1; i <= times; i++)
+		{
+			insertedKnotVector[knotSpanIndex + i] = insertKnot;
+		}
+		for (int i = knotSpanIndex + 1; i < knotVector.size(); i++)
+		{
+			insertedKnotVector[i + times] = knotVector[i];
+		}
+
+		std::vector<XYZW> updatedControlPoints(controlPoints.size() + times);
+		for (int i = 0; i <= knotSpanIndex - degree; i++)
+		{
+			updatedControlPoints[i] = controlPoints[i];
+		}
+		for (int i = knotSpanIndex - originMultiplicity; i < controlPoints.size(); i++)
+		{
+			updatedControlPoints[i + times] = controlPoints[i];
+		}
+
+		std::vector<XYZW> temp(degree - originMultiplicity + 1);
+		for (int i = 0; i <= degree - originMultiplicity; i++)
+		{
+			temp[i] = controlPoints[knotSpanIndex - degree + i];
+		}
+
+		int L = 0;
+		for (int j = 1; j <= times; j++)
+		{
+			L = knotSpanIndex - degree + j;
+			for (int i = 0; i <= degree - j - originMultiplicity; i++)
+			{
+				double alpha = (insertKnot - knotVector[L + i]) / (knotVector[i + knotSpanIndex + 1] - knotVector[L + i]);
+				temp[i] = alpha * temp[i + 1] + (1.0 - alpha) * temp[i];
+			}
+			updatedControlPoints[L] = temp[0];
+			if (degree - j - originMultiplicity > 0)
+			{
+				updatedControlPoints[knotSpanIndex + times - j - originMultiplicity] = temp[degree - j - originMultiplicity];
+			}
+		}
+
+		for (int i = L + 1; i < knotSpanIndex - originMultiplicity; i++)
+		{
+			updatedControlPoints[i] = temp[i - L];
+		}
+
+		std::sort(insertedKnotVector.begin(), insertedKnotVector.end());
+		result.Degree = degree;
+		result.KnotVector = insertedKnotVector;
+		result.ControlPoints = updatedControlPoints;
+
+		return times;
+	}
+
+	/// <summary>
+	/// Replays a knot refinement of the curve on its control points.
+	/// </summary>
+	void RefineCurveControlPoints(const LN_NurbsCurve& curve, LN_KnotRefinement& refinement, LN_NurbsCurve& result)
+	{
+		const std::vector<XYZW>& controlPoints = curve.ControlPoints;
+
+		int n = controlPoints.size() - 1;
+		int r = static_cast<int>(refinement.KnotVector.size() - curve.KnotVector.size()) - 1;
+		std::vector<XYZW> updatedControlPoints(n + r + 2);
+		ControlPointsUtils::RefineControlPoints(refinement, n, 1,
+			[&](int i, int) -> const XYZW& { return controlPoints[i]; },
+			[&](int i, int) -> XYZW& { return updatedControlPoints[i]; });
+
+		result.Degree = curve.Degree;
+		result.KnotVector = std::move(refinement.KnotVector);
+		result.ControlPoints = std::move(updatedControlPoints);
+	}
+
+	void CreateTransformedCore(const LN_NurbsCurve& curve, const Matrix4d& matrix, bool isParallel, LN_NurbsCurve& result)
+	{
+		int size = curve.ControlPoints.size();
+		result.Degree = curve.Degree;
+		result.KnotVector = curve.KnotVector;
+		result.ControlPoints.resize(size);
+		matrix.OfWeightedPoints(curve.ControlPoints.data(), size, result.ControlPoints.data(), isParallel);
+	}
 
 	double GetNode(int degree, const std::vector<double>& knotVector, int lastIndex)
 	{
@@ -59,50 +365,234 @@ namespace LNLib
 		return t;
 	}
 
-	double CalculateLengthBySimpson(FirstDerivativeLengthFunction function, const LN_NurbsCurve& curve, double start, double end, double simpson, double tolearance)
+	double GetFirstDerivativeLength(const LN_NurbsCurve& curve, double paramT)
 	{
-		double length = 0.0;
-		double m = (start + end) / 2.0;
-		double left = Integrator::Simpson(function, (void*)& curve, start, m);
-		double right = Integrator::Simpson(function, (void*)& curve, m, end);
+		double length = NurbsCurve::ComputeRationalCurveDerivatives(curve, 1, paramT)[1].Length();
+		return std::isnan(length) ? 0.0 : length;
+	}
+
+	double GetLengthByGaussLegendre(const LN_NurbsCurve& curve, double start, double end)
+	{
+		return Integrator::GaussLegendre([&curve](double t) { return GetFirstDerivativeLength(curve, t); }, start, end);
+	}
+
+	double GetSpanLength(const LN_NurbsCurve& curve, double start, double end, IntegratorType type)
+	{
+		auto function = [&curve](double t) { return GetFirstDerivativeLength(curve, t); };
+		switch (type)
+		{
+			case IntegratorType::Simpson:
+			{
+				return Integrator::AdaptiveSimpson(function, start, end);
+			}
+			case IntegratorType::Chebyshev:
+			{
+				return Integrator::ClenshawCurtis(function, start, end, Integrator::GetChebyshevSeries());
+			}
+			case IntegratorType::GaussKronrod:
+			{
+				double error = 0.0;
+				return Integrator::GaussKronrod(function, start, end, Constants::DistanceEpsilon, error);
+			}
+			case IntegratorType::GaussLegendre:
+			default:
+				return GetLengthByGaussLegendre(curve, start, end);
+		}
+	}
 
-		double differ = left + right - simpson;
-		if (MathUtils::IsAlmostEqualTo(differ, 0.0) || 
-			MathUtils::IsLessThan(abs(differ) / 10.0, tolearance))
+	double GetParamByLength(const LN_ArcLengthTable& table, int spanIndex, double givenLength)
+	{
+		const LN_NurbsCurve& curve = table.Curve;
+		double a = table.Params[spanIndex];
+		double b = table.Params[spanIndex + 1];
+		double target = givenLength - table.Lengths[spanIndex];
+		double spanLength = table.Lengths[spanIndex + 1] - table.Lengths[spanIndex];
+		if (target <= 0.0)
 		{
-			length = left + right + differ / 10.0;
+			return a;
 		}
-		else
+		if (target >= spanLength)
+		{
+			return b;
+		}
+
+		double tolerance = Constants::DoubleEpsilon * Constants::DistanceEpsilon * std::max(1.0, spanLength);
+		double low = a;
+		double high = b;
+		double paramT = a + (b - a) * target / spanLength;
+
+		int maxIterations = 50;
+		for (int i = 0; i < maxIterations; i++)
 		{
-			length = CalculateLengthBySimpson(function, curve, start, m, left, tolearance / 2.0) + CalculateLengthBySimpson(function, curve, m, end, right, tolearance / 2.0);
+			double difference = GetLengthByGaussLegendre(curve, a, paramT) - target;
+			if (std::abs(difference) < tolerance)
+			{
+				break;
+			}
+
+			if (difference > 0)
+			{
+				high = paramT;
+			}
+			else
+			{
+				low = paramT;
+			}
+
+			double derLength = NurbsCurve::ComputeRationalCurveDerivatives(curve, 1, paramT)[1].Length();
+			double next = paramT - difference / derLength;
+			if (std::isnan(next) || next <= low || next >= high)
+			{
+				next = (low + high) / 2.0;
+			}
+			if (MathUtils::IsAlmostEqualTo(next, paramT, Constants::DoubleEpsilon * Constants::DoubleEpsilon))
+			{
+				paramT = next;
+				break;
+			}
+			paramT = next;
 		}
-		return length;
+		return paramT;
 	}
 
-	double GetParamByLength(const LN_NurbsCurve& curve, double start, double end, double givenLength, IntegratorType type)
+	bool GetParamByNewtonIteration(const LN_NurbsCurve& curve, const XYZ& givenPoint, double a, double b, bool isClosed, double& paramT)
 	{
-		double middle = (start + end) / 2.0;
+		int maxIterations = 10;
+		int counters = 0;
+		while (counters < maxIterations)
+		{
+			std::vector<XYZ> derivatives = NurbsCurve::ComputeRationalCurveDerivatives(curve, 2, paramT);
+			XYZ difference = derivatives[0] - givenPoint;
+			double f = derivatives[1].DotProduct(difference);
 
-		LN_NurbsCurve left;
-		LN_NurbsCurve right;
-		bool isSplited = NurbsCurve::SplitAt(curve, middle, left, right);
-		if (!isSplited) return start;
-		double length = NurbsCurve::ApproximateLength(left, type);
-		if (MathUtils::IsAlmostEqualTo(length, givenLength, Constants::DistanceEpsilon))
+			double condition1 = difference.Length();
+			double condition2 = std::abs(f / (derivatives[1].Length() * condition1));
+
+			if (condition1 < Constants::DistanceEpsilon &&
+				condition2 < Constants::DistanceEpsilon)
+			{
+				return true;
+			}
+
+			double df = derivatives[2].DotProduct(difference) + derivatives[1] * derivatives[1];
+			double temp = paramT - f / df;
+
+			if (!isClosed)
+			{
+				if (temp < a)
+				{
+					temp = a;
+				}
+				if (temp > b)
+				{
+					temp = b;
+				}
+			}
+			else
+			{
+				if (temp < a)
+				{
+					temp = b - (a - temp);
+				}
+				if (temp > b)
+				{
+					temp = a + (temp - b);
+				}
+			}
+
+			double condition4 = ((temp - paramT) * derivatives[1]).Length();
+			if (condition4 < Constants::DistanceEpsilon)
+			{
+				return true;
+			}
+
+			paramT = temp;
+			counters++;
+		}
+		return false;
+	}
+
+	// Whether a converged Newton result is the projection. Results off the domain ends always are.
+	// Newton iteration also stops when its step is clamped at an end of the domain,
+	// so a result there is the projection only if the curve is open and the point lies beyond that end.
+	bool IsAcceptedProjection(const LN_NurbsCurve& curve, const XYZ& givenPoint, double paramT)
+	{
+		const std::vector<double>& knotVector = curve.KnotVector;
+		int n = static_cast<int>(curve.ControlPoints.size()) - 1;
+		bool isOnStart = MathUtils::IsAlmostEqualTo(paramT, knotVector[curve.Degree]);
+		bool isOnEnd = MathUtils::IsAlmostEqualTo(paramT, knotVector[n + 1]);
+		if (!isOnStart && !isOnEnd) return true;
+
+		std::vector<XYZ> derivatives = NurbsCurve::ComputeRationalCurveDerivatives(curve, 1, paramT);
+		XYZ difference = givenPoint - derivatives[0];
+		double distance = difference.Length();
+		if (distance < Constants::DistanceEpsilon) return true;
+		if (NurbsCurve::IsClosed(curve)) return false;
+
+		double cosine = derivatives[1].DotProduct(difference) / (derivatives[1].Length() * distance);
+		return isOnStart ? cosine < Constants::DistanceEpsilon : cosine > -Constants::DistanceEpsilon;
+	}
+
+	double DistanceToBox(const XYZ& point, const XYZ& minPoint, const XYZ& maxPoint)
+	{
+		double sum = 0.0;
+		for (int i = 0; i < 3; i++)
 		{
-			return middle;
+			double d = std::max(0.0, std::max(minPoint[i] - point[i], point[i] - maxPoint[i]));
+			sum += d * d;
 		}
-		else if (MathUtils::IsGreaterThan(length, givenLength, Constants::DistanceEpsilon))
+		return std::sqrt(sum);
+	}
+
+	double GetParamOnSegments(const LN_CurveProjection& projection, const XYZ& givenPoint, double& distance)
+	{
+		const std::vector<LN_BezierSegment>& segments = projection.Segments;
+		int size = segments.size();
+
+		std::vector<std::pair<double, int>> candidates(size);
+		for (int i = 0; i < size; i++)
 		{
-			end = middle;
-			return GetParamByLength(curve, start, end, givenLength, type);
+			candidates[i] = std::make_pair(DistanceToBox(givenPoint, segments[i].MinPoint, segments[i].MaxPoint), i);
 		}
-		else if (MathUtils::IsLessThan(length, givenLength, Constants::DistanceEpsilon))
+		std::sort(candidates.begin(), candidates.end());
+
+		double minDistance = Constants::MaxDistance;
+		double paramT = segments[0].StartParameter;
+		for (int i = 0; i < size; i++)
 		{
-			start = middle;
-			return GetParamByLength(curve, start, end, givenLength, type);
+			if (candidates[i].first > minDistance) break;
+
+			const LN_BezierSegment& segment = segments[candidates[i].second];
+			double range = segment.EndParameter - segment.StartParameter;
+
+			int nearest = 0;
+			double sampleDistance = Constants::MaxDistance;
+			for (int j = 0; j < segment.SamplePoints.size(); j++)
+			{
+				double d = givenPoint.Distance(segment.SamplePoints[j]);
+				if (d < sampleDistance)
+				{
+					sampleDistance = d;
+					nearest = j;
+				}
+			}
+			if (sampleDistance < minDistance)
+			{
+				minDistance = sampleDistance;
+				paramT = segment.StartParameter + range * segment.SampleParams[nearest];
+			}
+
+			double s = segment.SampleParams[nearest];
+			GetParamByNewtonIteration(segment.Segment, givenPoint, 0.0, 1.0, false, s);
+			double d = givenPoint.Distance(NurbsCurve::GetPointOnCurve(segment.Segment, s));
+			if (d < minDistance)
+			{
+				minDistance = d;
+				paramT = segment.StartParameter + range * s;
+			}
 		}
-		return middle;
+		distance = minDistance;
+		return paramT;
 	}
 
 	void TessellateCore(const LN_NurbsCurve& curve, double start, double end, std::vector<double>& parameters)
@@ -156,6 +646,150 @@ namespace LNLib
 			}
 		}
 	}
+
+	/// <summary>
+	/// Unit normal of the plane of a curve by Newell's method on its closed control polygon,
+	/// so that it points to the side from which the curve runs counterclockwise.
+	/// </summary>
+	XYZ GetCurvePlaneNormal(const LN_NurbsCurve& curve)
+	{
+		const std::vector<XYZW>& controlPoints = curve.ControlPoints;
+		int size = controlPoints.size();
+		XYZ normal;
+		for (int i = 0; i < size; i++)
+		{
+			XYZ current = controlPoints[i].ToXYZ(true);
+			XYZ next = controlPoints[(i + 1) % size].ToXYZ(true);
+			normal += XYZ((current.GetY() - next.GetY()) * (current.GetZ() + next.GetZ()),
+				(current.GetZ() - next.GetZ()) * (current.GetX() + next.GetX()),
+				(current.GetX() - next.GetX()) * (current.GetY() + next.GetY()));
+		}
+		if (!normal.IsZero())
+		{
+			return normal.Normalize();
+		}
+
+		// Straight curve, any normal of its direction will do.
+		XYZ direction = controlPoints[size - 1].ToXYZ(true) - controlPoints[0].ToXYZ(true);
+		XYZ axis = std::abs(direction.GetZ()) < std::abs(direction.GetX()) && std::abs(direction.GetZ()) < std::abs(direction.GetY()) ? XYZ(0, 0, 1) : XYZ(1, 0, 0);
+		return direction.CrossProduct(axis).Normalize();
+	}
+
+	/// <summary>
+	/// Point of the offset curve at paramT, together with the speed factor 1 - offset * curvature
+	/// relating the offset derivative to the curve derivative. The factor changes sign at cusps.
+	/// </summary>
+	XYZ GetOffsetPoint(const LN_NurbsCurve& curve, const XYZ& planeNormal, double offset, double paramT, double& speedFactor)
+	{
+		std::vector<XYZ> derivatives = NurbsCurve::ComputeRationalCurveDerivatives(curve, 2, paramT);
+		XYZ tangent = derivatives[1];
+		double length = tangent.Length();
+		speedFactor = 1.0;
+		if (MathUtils::IsAlmostEqualTo(length, 0.0))
+		{
+			return derivatives[0];
+		}
+		double curvature = planeNormal.DotProduct(tangent.CrossProduct(derivatives[2])) / (length * length * length);
+		speedFactor = 1.0 - offset * curvature;
+		return derivatives[0] + offset * planeNormal.CrossProduct(tangent).Normalize();
+	}
+
+	/// <summary>
+	/// Append to parameters the ends of subintervals of (start, end] over which the curve tangent turns by at most maxAngle.
+	/// </summary>
+	void SampleOffsetSpan(const LN_NurbsCurve& curve, double start, double end, const XYZ& startTangent, double maxAngle, int depth, std::vector<double>& parameters)
+	{
+		XYZ endTangent = NurbsCurve::ComputeRationalCurveDerivatives(curve, 1, end)[1];
+		if (depth == 0 || startTangent.AngleTo(endTangent) <= maxAngle)
+		{
+			parameters.emplace_back(end);
+			return;
+		}
+		double mid = 0.5 * (start + end);
+		XYZ midTangent = NurbsCurve::ComputeRationalCurveDerivatives(curve, 1, mid)[1];
+		SampleOffsetSpan(curve, start, mid, startTangent, maxAngle, depth - 1, parameters);
+		SampleOffsetSpan(curve, mid, end, midTangent, maxAngle, depth - 1, parameters);
+	}
+
+	/// <summary>
+	/// Parameter pairs where the polyline through points crosses itself, params[i] being the parameter of points[i].
+	/// Segments are swept along the longer side of the bounding box in the plane,
+	/// so only segments overlapping along that direction are tested against each other.
+	/// </summary>
+	std::vector<UV> GetPolylineSelfIntersections(const std::vector<double>& params, const std::vector<XYZ>& points, const XYZ& planeNormal)
+	{
+		std::vector<UV> intersections;
+		int count = static_cast<int>(points.size()) - 1;
+		if (count < 3) return intersections;
+
+		XYZ xAxis = (points[count] - points[0]).CrossProduct(planeNormal);
+		if (xAxis.IsZero())
+		{
+			xAxis = (points[count / 2] - points[0]).CrossProduct(planeNormal);
+		}
+		xAxis = xAxis.Normalize();
+		XYZ yAxis = planeNormal.CrossProduct(xAxis);
+		std::vector<UV> coordinates(count + 1);
+		UV minCoordinate(Constants::MaxDistance, Constants::MaxDistance);
+		UV maxCoordinate(-Constants::MaxDistance, -Constants::MaxDistance);
+		for (int i = 0; i <= count; i++)
+		{
+			coordinates[i] = UV(points[i].DotProduct(xAxis), points[i].DotProduct(yAxis));
+			for (int k = 0; k < 2; k++)
+			{
+				minCoordinate[k] = std::min(minCoordinate[k], coordinates[i][k]);
+				maxCoordinate[k] = std::max(maxCoordinate[k], coordinates[i][k]);
+			}
+		}
+		int axis = maxCoordinate[0] - minCoordinate[0] >= maxCoordinate[1] - minCoordinate[1] ? 0 : 1;
+
+		std::vector<int> order(count);
+		for (int i = 0; i < count; i++)
+		{
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b)
+			{
+				return std::min(coordinates[a][axis], coordinates[a + 1][axis]) < std::min(coordinates[b][axis], coordinates[b + 1][axis]);
+			});
+
+		bool isClosed = points[0].IsAlmostEqualTo(points[count]);
+		std::vector<int> active;
+		for (int index : order)
+		{
+			const UV& p = coordinates[index];
+			UV r = coordinates[index + 1] - p;
+			double sweep = std::min(p[axis], coordinates[index + 1][axis]);
+			for (int k = static_cast<int>(active.size()) - 1; k >= 0; k--)
+			{
+				int j = active[k];
+				if (std::max(coordinates[j][axis], coordinates[j + 1][axis]) < sweep)
+				{
+					active[k] = active.back();
+					active.pop_back();
+					continue;
+				}
+				if (std::abs(j - index) <= 1) continue;
+				if (isClosed && std::abs(j - index) == count - 1) continue;
+
+				const UV& q = coordinates[j];
+				UV w = coordinates[j + 1] - q;
+				double denominator = r[0] * w[1] - r[1] * w[0];
+				if (denominator == 0.0) continue;
+				UV d = q - p;
+				double s = (d[0] * w[1] - d[1] * w[0]) / denominator;
+				double t = (d[0] * r[1] - d[1] * r[0]) / denominator;
+				if (s < 0.0 || s >= 1.0 || t < 0.0 || t >= 1.0) continue;
+
+				double param0 = params[index] + s * (params[index + 1] - params[index]);
+				double param1 = params[j] + t * (params[j + 1] - params[j]);
+				intersections.emplace_back(UV(std::min(param0, param1), std::max(param0, param1)));
+			}
+			active.emplace_back(index);
+		}
+		std::sort(intersections.begin(), intersections.end(), [](const UV& a, const UV& b) { return a[0] < b[0]; });
+		return intersections;
+	}
 }
 
 void LNLib::NurbsCurve::Check(const LN_NurbsCurve& curve)
@@ -368,81 +1002,20 @@ double LNLib::NurbsCurve::Torsion(const LN_NurbsCurve& curve, double paramT)
 
 int LNLib::NurbsCurve::InsertKnot(const LN_NurbsCurve& curve, double insertKnot, int times, LN_NurbsCurve& result)
 {
-	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
-
 	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
 
-	int knotSpanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, insertKnot);
-	int originMultiplicity = Polynomials::GetKnotMultiplicity(knotVector, insertKnot);
-
-	if (originMultiplicity + times > degree + 1)
-	{
-		times = degree - 1 - originMultiplicity;
-	}
-	if (times <= 0)
-	{
-		return 0;
-	}
-	
-	std::vector<double> insertedKnotVector(knotVector.size() + times);
-	for (int i = 0; i <= knotSpanIndex; i++)
-	{
-		insertedKnotVector[i] = knotVector[i];
-	}
-	for (int i = 1; i <= times; i++)
-	{
-		insertedKnotVector[knotSpanIndex + i] = insertKnot;
-	}
-	for (int i = knotSpanIndex + 1; i < knotVector.size(); i++)
-	{
-		insertedKnotVector[i + times] = knotVector[i];
-	}
-
-	std::vector<XYZW> updatedControlPoints(controlPoints.size() + times);
-	for (int i = 0; i <= knotSpanIndex - degree; i++)
-	{
-		updatedControlPoints[i] = controlPoints[i];
-	}
-	for (int i = knotSpanIndex - originMultiplicity; i < controlPoints.size(); i++)
-	{
-		updatedControlPoints[i + times] = controlPoints[i];
-	}
-
-	std::vector<XYZW> temp(degree - originMultiplicity + 1);
-	for (int i = 0; i <= degree - originMultiplicity; i++)
-	{
-		temp[i] = controlPoints[knotSpanIndex - degree + i];
-	}
-
-	int L = 0;
-	for (int j = 1; j <= times; j++)
-	{
-		L = knotSpanIndex - degree + j;
-		for (int i = 0; i <= degree - j - originMultiplicity; i++)
-		{
-			double alpha = (insertKnot - knotVector[L + i]) / (knotVector[i + knotSpanIndex + 1] - knotVector[L + i]);
-			temp[i] = alpha * temp[i + 1] + (1.0 - alpha) * temp[i];
-		}
-		updatedControlPoints[L] = temp[0];
-		if (degree - j - originMultiplicity > 0)
-		{
-			updatedControlPoints[knotSpanIndex + times - j - originMultiplicity] = temp[degree - j - originMultiplicity];
-		}
-	}
-
-	for (int i = L + 1; i < knotSpanIndex - originMultiplicity; i++)
-	{
-		updatedControlPoints[i] = temp[i - L];
-	}
+	int knotSpanIndex = Polynomials::GetKnotSpanIndex(curve.Degree, curve.KnotVector, insertKnot);
+	int originMultiplicity = Polynomials::GetKnotMultiplicity(curve.KnotVector, insertKnot);
+	return InsertKnotAtSpan(curve, knotSpanIndex, originMultiplicity, insertKnot, times, result);
+}
 
-	std::sort(insertedKnotVector.begin(), insertedKnotVector.end());
-	result.Degree = degree;
-	result.KnotVector = insertedKnotVector;
-	result.ControlPoints = updatedControlPoints;
+int LNLib::NurbsCurve::InsertKnot(const LN_NurbsCurve& curve, const LN_KnotStructure& structure, double insertKnot, int times, LN_NurbsCurve& result)
+{
+	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
 
-	return times;
+	int knotSpanIndex = KnotVectorUtils::GetKnotSpanIndex(structure, insertKnot);
+	int originMultiplicity = KnotVectorUtils::GetKnotMultiplicity(structure, insertKnot);
+	return InsertKnotAtSpan(curve, knotSpanIndex, originMultiplicity, insertKnot, times, result);
 }
 
 LNLib::XYZ LNLib::NurbsCurve::GetPointOnCurveByCornerCut(const LN_NurbsCurve& curve, double paramT)
@@ -485,72 +1058,16 @@ LNLib::XYZ LNLib::NurbsCurve::GetPointOnCurveByCornerCut(const LN_NurbsCurve& cu
 
 void LNLib::NurbsCurve::RefineKnotVector(const LN_NurbsCurve& curve, std::vector<double>& insertKnotElements, LN_NurbsCurve& result)
 {
-	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
-
-	VALIDATE_ARGUMENT(insertKnotElements.size() > 0, "insertKnotElements", "insertKnotElements size must be greater than zero.");
-
-	int n = controlPoints.size() - 1;
-	int m = n + degree + 1;
-	int r = insertKnotElements.size() - 1;
-
-	int a = Polynomials::GetKnotSpanIndex(degree, knotVector, insertKnotElements[0]);
-	int b = Polynomials::GetKnotSpanIndex(degree, knotVector, insertKnotElements[r]) + 1;
-
-	std::vector<double> insertedKnotVector(m + r + 2);
-	for (int j = 0; j <= a; j++)
-	{
-		insertedKnotVector[j] = knotVector[j];
-	}
-	for (int j = b + degree; j <= m; j++)
-	{
-		insertedKnotVector[j + r + 1] = knotVector[j];
-	}
-
-	std::vector<XYZW> updatedControlPoints(n + r + 2);
-	for (int j = 0; j <= a - degree; j++)
-	{
-		updatedControlPoints[j] = controlPoints[j];
-	}
-	for (int j = b - 1; j <= n; j++)
-	{
-		updatedControlPoints[j + r + 1] = controlPoints[j];
-	}
-
-	int i = b + degree - 1;
-	int k = b + degree + r;
-	for (int j = r; j >= 0; j--)
-	{
-		while (insertKnotElements[j] <= knotVector[i] && i > a)
-		{
-			updatedControlPoints[k - degree - 1] = controlPoints[i - degree - 1];
-			insertedKnotVector[k] = knotVector[i];
-			k = k - 1;
-			i = i - 1;
-		}
+	LN_KnotRefinement refinement;
+	KnotVectorUtils::GetKnotRefinement(curve.Degree, curve.KnotVector, insertKnotElements, refinement);
+	RefineCurveControlPoints(curve, refinement, result);
+}
 
-		updatedControlPoints[k - degree - 1] = updatedControlPoints[k - degree];
-		for (int l = 1; l <= degree; l++)
-		{
-			int ind = k - degree + l;
-			double alpha = insertedKnotVector[k + l] - insertKnotElements[j];
-			if (MathUtils::IsAlmostEqualTo(abs(alpha), 0.0))
-			{
-				updatedControlPoints[ind - 1] = updatedControlPoints[ind];
-			}
-			else
-			{
-				alpha = alpha / (insertedKnotVector[k + l] - knotVector[i - degree + l]);
-				updatedControlPoints[ind - 1] = alpha * updatedControlPoints[ind - 1] + (1.0 - alpha) * updatedControlPoints[ind];
-			}
-		}
-		insertedKnotVector[k] = insertKnotElements[j];
-		k = k - 1;
-	}
-	result.Degree = degree;
-	result.KnotVector = insertedKnotVector;
-	result.ControlPoints = updatedControlPoints;
+void LNLib::NurbsCurve::RefineKnotVector(const LN_NurbsCurve& curve, const LN_KnotStructure& structure, std::vector<double>& insertKnotElements, LN_NurbsCurve& result)
+{
+	LN_KnotRefinement refinement;
+	KnotVectorUtils::GetKnotRefinement(structure, curve.KnotVector, insertKnotElements, refinement);
+	RefineCurveControlPoints(curve, refinement, result);
 }
 
 std::vector<LNLib::LN_NurbsCurve> LNLib::NurbsCurve::DecomposeToBeziers(const LN_NurbsCurve& curve)
@@ -623,20 +1140,21 @@ std::vector<LNLib::LN_NurbsCurve> LNLib::NurbsCurve::DecomposeToBeziers(const LN
 					beziers[nb + 1].ControlPoints[save] = beziers[nb].ControlPoints[degree];
 				}
 			}
+		}
 
-			nb++;
-			if (b < m)
+		nb++;
+		if (b < m)
+		{
+			for (int i = degree - multi; i <= degree; i++)
 			{
-				for (int i = degree - multi; i <= degree; i++)
-				{
-					beziers[nb].ControlPoints[i] = controlPoints[b - degree + i];
-				}
-
-				a = b;
-				b += 1;
+				beziers[nb].ControlPoints[i] = controlPoints[b - degree + i];
 			}
+
+			a = b;
+			b += 1;
 		}
 	}
+	beziers.resize(nb);
 	return beziers;
 }
 
@@ -766,298 +1284,54 @@ bool LNLib::NurbsCurve::RemoveKnot(const LN_NurbsCurve& curve, double removeKnot
 		updatedControlPoints.pop_back();
 	}
 	result.Degree = degree;
-	result.KnotVector = restKnotVector;
-	result.ControlPoints = updatedControlPoints;
-	return true;
-}
-
-void LNLib::NurbsCurve::ElevateDegree(const LN_NurbsCurve& curve, int times, LN_NurbsCurve& result)
-{
-	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
-
-	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
-
-	int n = controlPoints.size() - 1;
-	int m = n + degree + 1;
-	int ph = degree + times;
-	int ph2 = floor(ph / 2);
-
-	std::vector<std::vector<double>> bezalfs(degree + times + 1, std::vector<double>(degree + 1));
-	bezalfs[0][0] = bezalfs[ph][degree] = 1.0;
-
-	for (int i = 1; i <= ph2; i++)
-	{
-		double inv = 1.0 / MathUtils::Binomial(ph, i);
-		int mpi = std::min(degree, i);
-
-		for (int j = std::max(0, i - times); j <= mpi; j++)
-		{
-			bezalfs[i][j] = inv * MathUtils::Binomial(degree, j) * MathUtils::Binomial(times, i - j);
-		}
-	}
-
-	for (int i = ph2 + 1; i <= ph - 1; i++)
-	{
-		int mpi = std::min(degree, i);
-		for (int j = std::max(0, i - times); j <= mpi; j++)
-		{
-			bezalfs[i][j] = bezalfs[ph - i][degree - j];
-		}
-	}
-
-	int mh = ph;
-	int kind = ph + 1;
-	int r = -1;
-	int a = degree;
-	int b = degree + 1;
-	int cind = 1;
-	double ua = knotVector[0];
-
-	int moresize = controlPoints.size() + controlPoints.size() * times;
-	std::vector<XYZW> updatedControlPoints(moresize,XYZW(Constants::MaxDistance, Constants::MaxDistance, Constants::MaxDistance,1));
-	updatedControlPoints[0] = controlPoints[0];
-
-	std::vector<double> updatedKnotVector(moresize + ph + 1,Constants::MaxDistance);
-	for (int i = 0; i <= ph; i++)
-	{
-		updatedKnotVector[i] = ua;
-	}
-
-	std::vector<XYZW> bpts(degree + 1);
-	for (int i = 0; i <= degree; i++)
-	{
-		bpts[i] = controlPoints[i];
-	}
-
-	std::vector<XYZW> nextbpts(degree - 1);
-
-	while (b < m)
-	{
-		int i = b;
-		while (b < m && MathUtils::IsAlmostEqualTo(knotVector[b], knotVector[b + 1]))
-		{
-			b = b + 1;
-		}
-		int mul = b - i + 1;
-		mh += mul + times;
-		double ub = knotVector[b];
-
-		int oldr = r;
-		r = degree - mul;
-
-		int lbz = oldr > 0 ? floor((oldr + 2) / 2) : 1;
-		int rbz = r > 0 ? floor(ph - (r + 1) / 2) : ph;
-
-		if (r > 0)
-		{
-			double numer = ub - ua;
-			std::vector<double> alfs(degree - 1);
-			for (int k = degree; k > mul; k--)
-			{
-				alfs[k - mul - 1] = numer / (knotVector[a + k] - ua);
-			}
-			for (int j = 1; j <= r; j++)
-			{
-				int save = r - j;
-				int s = mul + j;
-
-				for (int k = degree; k >= s; k--)
-				{
-					bpts[k] = alfs[k - s] * bpts[k] + (1.0 - alfs[k - s]) * bpts[k - 1];
-				}
-				nextbpts[save] = bpts[degree];
-			}
-		}
-
-		std::vector<XYZW> ebpts(degree + times + 1);
-		for (int i = lbz; i <= ph; i++)
-		{
-			ebpts[i] = XYZW(0.0, 0.0, 0.0, 0.0);
-			int mpi = std::min(degree, i);
-			for (int j = std::max(0, i - times); j <= mpi; j++)
-			{
-				ebpts[i] += bezalfs[i][j] * bpts[j];
-			}
-		}
-
-		if (oldr > 1)
-		{
-			int first = kind - 2;
-			int last = kind;
-			double den = ub - ua;
-			double bet = (ub - updatedKnotVector[kind - 1]) / den;
-
-			for (int tr = 1; tr < oldr; tr++)
-			{
-				int i = first;
-				int j = last;
-				int kj = j - kind + 1;
-
-				while (j - i > tr)
-				{
-					if (i < cind)
-					{
-						double alf = (ub - updatedKnotVector[i]) / (ua - updatedKnotVector[i]);
-						updatedControlPoints[i] = alf * updatedControlPoints[i] + (1.0 - alf) * updatedControlPoints[i - 1];
-					}
-
-					if (j >= lbz)
-					{
-						if (j - tr <= kind - ph + oldr)
-						{
-							double gam = (ub - updatedKnotVector[j - tr]) / den;
-							ebpts[kj] = gam * ebpts[kj] + (1.0 - gam) * ebpts[kj + 1];
-						}
-						else
-						{
-							ebpts[kj] = bet * ebpts[kj] + (1.0 - bet) * ebpts[kj + 1];
-						}
-					}
-
-					i = i + 1;
-					j = j - 1;
-					kj = kj - 1;
-				}
-
-				first -= 1;
-				last += 1;
-			}
-		}
-
-		if (a != degree)
-		{
-			for (int i = 0; i < ph - oldr; i++)
-			{
-				updatedKnotVector[kind++] = ua;
-			}
-		}
-
-		for (int j = lbz; j <= rbz; j++)
-		{
-			updatedControlPoints[cind++] = ebpts[j];
-		}
-
-		if (b < m)
-		{
-			for (int j = 0; j < r; j++)
-			{
-				bpts[j] = nextbpts[j];
-			}
-			for (int j = r; j <= degree; j++)
-			{
-				bpts[j] = controlPoints[b - degree + j];
-			}
-
-			a = b;
-			b = b + 1;
-			ua = ub;
-		}
-		else
-		{
-			for (int i = 0; i <= ph; i++)
-			{
-				updatedKnotVector[kind + i] = ub;
-			}
-		}
-	}
-
-	for (int i = updatedControlPoints.size() - 1; i > 0; i--)
-	{
-		if (MathUtils::IsAlmostEqualTo(updatedControlPoints[i][0], Constants::MaxDistance) &&
-			MathUtils::IsAlmostEqualTo(updatedControlPoints[i][1], Constants::MaxDistance) &&
-			MathUtils::IsAlmostEqualTo(updatedControlPoints[i][2], Constants::MaxDistance))
-		{
-			updatedControlPoints.pop_back();
-			continue;
-		}
-		break;
-	}
-	for (int i = updatedKnotVector.size() -1 ; i >0; i--)
-	{
-		if (MathUtils::IsAlmostEqualTo(updatedKnotVector[i], Constants::MaxDistance))
-		{
-			updatedKnotVector.pop_back();
-			continue;
-		}
-		break;
-	}
-	result.Degree = ph;
-	result.KnotVector = updatedKnotVector;
+	result.KnotVector = restKnotVector;
 	result.ControlPoints = updatedControlPoints;
+	return true;
 }
 
-bool LNLib::NurbsCurve::ReduceDegree(const LN_NurbsCurve& curve, LN_NurbsCurve& result)
+void LNLib::NurbsCurve::ElevateDegree(const LN_NurbsCurve& curve, int times, LN_NurbsCurve& result)
 {
 	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	const std::vector<XYZW>& controlPoints = curve.ControlPoints;
 
-	double tol = ValidationUtils::ComputeCurveModifyTolerance(controlPoints);
+	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
+
+	std::vector<std::vector<double>> bezalfs = Polynomials::GetDegreeElevationCoefficients(degree, times);
+	std::vector<double> elevatedKnotVector = KnotVectorUtils::GetElevatedKnotVector(knotVector, times);
+	std::vector<XYZW> updatedControlPoints(elevatedKnotVector.size() - degree - times - 1);
+	ControlPointsUtils::ElevateControlPoints(degree, knotVector, times, bezalfs, elevatedKnotVector, 1,
+		[&](int i, int) -> const XYZW& { return controlPoints[i]; },
+		[&](int i, int) -> XYZW& { return updatedControlPoints[i]; });
+
+	result.Degree = degree + times;
+	result.KnotVector = std::move(elevatedKnotVector);
+	result.ControlPoints = std::move(updatedControlPoints);
+}
+
+bool LNLib::NurbsCurve::ReduceDegree(const LN_NurbsCurve& curve, LN_NurbsCurve& result)
+{
+	int degree = curve.Degree;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	const std::vector<XYZW>& controlPoints = curve.ControlPoints;
 
 	int size = controlPoints.size();
 	bool isBezier = ValidationUtils::IsValidBezier(degree, size);
 	if (!isBezier) return false;
 
-	int r = floor((degree - 1) / 2);
-	std::vector<XYZW> updatedControlPoints(degree);
-	updatedControlPoints[0] = controlPoints[0];
-	updatedControlPoints[degree - 1] = controlPoints[degree];
-
-	std::vector<double> alpha(degree);
-	for (int i = 0; i < degree; i++)
-	{
-		alpha[i] = double(i) / double(degree);
-	}
-	double error = 0.0;
-	if (degree % 2 == 0)
-	{
-		for (int i = 1; i < r + 1; i++)
-		{
-			updatedControlPoints[i] = (controlPoints[i] - alpha[i] * updatedControlPoints[i - 1]) / (1 - alpha[i]);
-		}
-		for (int i = degree - 2; i > r; i--)
-		{
-			updatedControlPoints[i] = (controlPoints[i + 1] - (1 - alpha[i+1]) * updatedControlPoints[i + 1]) / alpha[i + 1];
-		}
-		error = (controlPoints[r + 1].Distance(0.5 * (updatedControlPoints[r] + updatedControlPoints[r + 1])));
-		double c = MathUtils::Binomial(degree, r + 1);
-		error = error * (c * pow(0.5, r + 1) * pow(1 - 0.5, degree - r - 1));
-	}
-	else
-	{
-		for (int i = 1; i < r; i++)
-		{
-			updatedControlPoints[i] = (controlPoints[i] - alpha[i] * updatedControlPoints[i - 1]) / (1 - alpha[i]);
-		}
-		for (int i = degree - 2; i > r; i--)
-		{
-			updatedControlPoints[i] = (controlPoints[i + 1] - (1 - alpha[i + 1]) * updatedControlPoints[i + 1]) / alpha[i + 1];
-		}
-		XYZW PLr = (controlPoints[r] - alpha[r] * updatedControlPoints[r - 1]) / (1 - alpha[r]);
-		XYZW PRr = (controlPoints[r + 1] - (1 - alpha[r + 1]) * updatedControlPoints[r + 1]) / alpha[r + 1];
-		updatedControlPoints[r] = 0.5 * (PLr + PRr);
-		error = PLr.Distance(PRr);
-		double maxU = (degree - std::sqrt(degree)) / (2 * degree);
-		error = error * 0.5 * (1 - alpha[r]) * (MathUtils::Binomial(degree, r) * pow(maxU, r) * pow(1 - maxU, r + 1) * (1 - 2 * maxU));
-	}
-	if (error > tol) return false;
+	std::vector<XYZW> updatedControlPoints;
+	if (!ControlPointsUtils::ReduceBezierDegree(degree, controlPoints, updatedControlPoints)) return false;
 
-	auto map = KnotVectorUtils::GetKnotMultiplicityMap(knotVector);
+	LN_KnotStructure structure;
+	KnotVectorUtils::CreateKnotStructure(degree, knotVector, structure);
 	std::vector<double> updatedKnotVector;
-	for (auto it = map.begin(); it != map.end(); ++it)
+	for (int i = 0; i < structure.Knots.size(); i++)
 	{
-		double u = it->first;
-		int count = it->second - 1;
-		for (int i = 0; i < count; i++)
-		{
-			updatedKnotVector.emplace_back(u);
-		}
+		updatedKnotVector.insert(updatedKnotVector.end(), structure.Multiplicities[i] - 1, structure.Knots[i]);
 	}
 	result.Degree = degree - 1;
-	result.KnotVector = updatedKnotVector;
-	result.ControlPoints = updatedControlPoints;
+	result.KnotVector = std::move(updatedKnotVector);
+	result.ControlPoints = std::move(updatedControlPoints);
 	return true;
 }
 
@@ -1138,7 +1412,6 @@ double LNLib::NurbsCurve::GetParamOnCurve(const LN_NurbsCurve& curve, const XYZ&
 
 	double minValue = Constants::MaxDistance;
 
-	int maxIterations = 10;
 	double paramT = Constants::DoubleEpsilon;
 	double minParam = knotVector[0];
 	double maxParam = knotVector[knotVector.size() - 1];
@@ -1186,80 +1459,116 @@ double LNLib::NurbsCurve::GetParamOnCurve(const LN_NurbsCurve& curve, const XYZ&
 	}
 
 	bool isClosed = IsClosed(curve);
-	double a = minParam;
-	double b = maxParam;
+	GetParamByNewtonIteration(curve, givenPoint, minParam, maxParam, isClosed, paramT);
+	return paramT;
+}
+
+double LNLib::NurbsCurve::GetParamOnCurve(const LN_NurbsCurve& curve, const XYZ& givenPoint, double initialParam)
+{
+	const std::vector<double>& knotVector = curve.KnotVector;
+	VALIDATE_ARGUMENT_RANGE(initialParam, knotVector[0], knotVector[knotVector.size() - 1]);
+
+	double startParam, endParam;
+	KnotVectorUtils::GetNeighborhoodRange(curve.Degree, knotVector, initialParam, startParam, endParam);
+
+	double paramT = initialParam;
+	bool isConverged = GetParamByNewtonIteration(curve, givenPoint, startParam, endParam, false, paramT);
+	if (isConverged &&
+		!KnotVectorUtils::IsOnInteriorBound(curve.Degree, knotVector, paramT, startParam, endParam) &&
+		IsAcceptedProjection(curve, givenPoint, paramT))
+	{
+		return paramT;
+	}
+	return GetParamOnCurve(curve, givenPoint);
+}
 
-	int counters = 0;
-	while (counters < maxIterations)
+void LNLib::NurbsCurve::CreateProjection(const LN_NurbsCurve& curve, LN_CurveProjection& projection)
+{
+	LN_NurbsCurve clampedCurve = curve;
+	if (!IsClamp(curve))
 	{
-		std::vector<XYZ> derivatives = ComputeRationalCurveDerivatives(curve, 2, paramT);
-		XYZ difference = derivatives[0] - givenPoint;
-		double f = derivatives[1].DotProduct(difference);
+		ToClampCurve(curve, clampedCurve);
+	}
 
-		double condition1 = difference.Length();
-		double condition2 = std::abs(f / (derivatives[1].Length() * condition1));
+	int degree = clampedCurve.Degree;
+	const std::vector<double>& knotVector = clampedCurve.KnotVector;
+	int n = clampedCurve.ControlPoints.size() - 1;
 
-		if (condition1 < Constants::DistanceEpsilon &&
-			condition2 < Constants::DistanceEpsilon)
-		{
-			return paramT;
-		}
+	std::vector<LN_NurbsCurve> beziers = DecomposeToBeziers(clampedCurve);
+	int sampleCount = 2 * (degree + 1);
 
-		double df = derivatives[2].DotProduct(difference) + derivatives[1] * derivatives[1];
-		double temp = paramT - f / df;
+	projection.Segments.clear();
+	projection.Segments.reserve(beziers.size());
+	int index = 0;
+	for (int i = degree; i <= n && index < beziers.size(); i++)
+	{
+		if (MathUtils::IsAlmostEqualTo(knotVector[i], knotVector[i + 1])) continue;
 
-		if (!isClosed)
-		{
-			if (temp < a)
-			{
-				temp = a;
-			}
-			if (temp > b)
-			{
-				temp = b;
-			}
-		}
-		else
+		LN_BezierSegment segment;
+		segment.StartParameter = knotVector[i];
+		segment.EndParameter = knotVector[i + 1];
+		segment.Segment = beziers[index++];
+
+		const std::vector<XYZW>& controlPoints = segment.Segment.ControlPoints;
+		segment.MinPoint = controlPoints[0].ToXYZ(true);
+		segment.MaxPoint = segment.MinPoint;
+		for (int j = 1; j < controlPoints.size(); j++)
 		{
-			if (temp < a)
-			{
-				temp = b - (a - temp);
-			}
-			if (temp > b)
+			XYZ point = controlPoints[j].ToXYZ(true);
+			for (int k = 0; k < 3; k++)
 			{
-				temp = a + (temp - b);
+				segment.MinPoint[k] = std::min(segment.MinPoint[k], point[k]);
+				segment.MaxPoint[k] = std::max(segment.MaxPoint[k], point[k]);
 			}
 		}
 
-		double condition4 = ((temp - paramT) * derivatives[1]).Length();
-		if (condition4 < Constants::DistanceEpsilon) 
+		segment.SampleParams.resize(sampleCount);
+		segment.SamplePoints.resize(sampleCount);
+		for (int j = 0; j < sampleCount; j++)
 		{
-			return paramT;
+			double s = j / (double)(sampleCount - 1);
+			segment.SampleParams[j] = s;
+			segment.SamplePoints[j] = GetPointOnCurve(segment.Segment, s);
 		}
-
-		paramT = temp;
-		counters++;
+		projection.Segments.emplace_back(segment);
 	}
-	return paramT;
 }
 
-void LNLib::NurbsCurve::CreateTransformed(const LN_NurbsCurve& curve, const Matrix4d& matrix, LN_NurbsCurve& result)
+double LNLib::NurbsCurve::GetParamOnCurve(const LN_CurveProjection& projection, const XYZ& givenPoint)
 {
-	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
+	VALIDATE_ARGUMENT(projection.Segments.size() > 0, "projection", "Projection must contain one segment at least.");
 
-	int size = controlPoints.size();
-	std::vector<XYZW> transformedControlPoints(size);
+	double distance = 0.0;
+	return GetParamOnSegments(projection, givenPoint, distance);
+}
 
-	Matrix4d tempMatrix = matrix;
-	for (int i = 0; i < size; i++)
-	{
-		XYZW temp = controlPoints[i];
-		transformedControlPoints[i] = tempMatrix.OfWeightedPoint(temp);
-	}
-	result = curve;
-	result.ControlPoints = transformedControlPoints;
+void LNLib::NurbsCurve::GetParamsOnCurve(const LN_CurveProjection& projection, const std::vector<XYZ>& givenPoints, std::vector<double>& params, std::vector<double>& distances)
+{
+	VALIDATE_ARGUMENT(projection.Segments.size() > 0, "projection", "Projection must contain one segment at least.");
+
+	int size = givenPoints.size();
+	params.resize(size);
+	distances.resize(size);
+
+	ThreadUtils::ParallelFor(0, size, [&](int i)
+		{
+			params[i] = GetParamOnSegments(projection, givenPoints[i], distances[i]);
+		}, 64);
+}
+
+void LNLib::NurbsCurve::CreateTransformed(const LN_NurbsCurve& curve, const Matrix4d& matrix, LN_NurbsCurve& result)
+{
+	CreateTransformedCore(curve, matrix, true, result);
+}
+
+void LNLib::NurbsCurve::CreateTransformed(const std::vector<LN_NurbsCurve>& curves, const Matrix4d& matrix, std::vector<LN_NurbsCurve>& result)
+{
+	int count = curves.size();
+	result.resize(count);
+	ThreadUtils::ParallelFor(0, count, [&](int i)
+		{
+			CreateTransformedCore(curves[i], matrix, false, result[i]);
+		}, 16);
 }
 
 void LNLib::NurbsCurve::Reparametrize(const LN_NurbsCurve& curve, double alpha, double beta, double gamma, double delta, LN_NurbsCurve& result)
@@ -1285,7 +1594,7 @@ void LNLib::NurbsCurve::Reparametrize(const LN_NurbsCurve& curve, double alpha,
 			double lambda = updatedKnotVector[i + j] * gamma - alpha;
 			temp = temp * lambda;
 		}
-		double newW = abs(controlPoints[i].GetW() * temp);
+		double newW = std::abs(controlPoints[i].GetW() * temp);
 		updatedControlPoints[i] = XYZW(const_cast<XYZW&>(controlPoints[i]).ToXYZ(true), newW);
 	}
 
@@ -1296,7 +1605,7 @@ void LNLib::NurbsCurve::Reparametrize(const LN_NurbsCurve& curve, double alpha,
 
 void LNLib::NurbsCurve::Reparametrize(const LN_NurbsCurve& curve, double min, double max, LN_NurbsCurve& result)
 {
-	std::vector<double> knotVector = curve.KnotVector;
+	const std::vector<double>& knotVector = curve.KnotVector;
 
 	if (MathUtils::IsAlmostEqualTo(min, knotVector[0]) && MathUtils::IsAlmostEqualTo(max, knotVector[knotVector.size() - 1]))
 	{
@@ -1305,8 +1614,39 @@ void LNLib::NurbsCurve::Reparametrize(const LN_NurbsCurve& curve, double min, do
 	}
 
 	std::vector<double> newKnotVector = KnotVectorUtils::Rescale(knotVector, min, max);
-	result = curve;
-	result.KnotVector = newKnotVector;
+	result.Degree = curve.Degree;
+	result.ControlPoints = curve.ControlPoints;
+	result.KnotVector = std::move(newKnotVector);
+}
+
+void LNLib::NurbsCurve::Reparametrize(const LN_NurbsCurve& curve, double min, double max, LN_CurveView& view)
+{
+	VALIDATE_ARGUMENT(max > min, "max", "Max must be greater than min.");
+
+	const std::vector<double>& knotVector = curve.KnotVector;
+	double start = knotVector[0];
+	double end = knotVector[knotVector.size() - 1];
+
+	view.Curve = &curve;
+	view.Map.Scale = (end - start) / (max - min);
+	view.Map.Offset = start - view.Map.Scale * min;
+}
+
+LNLib::XYZ LNLib::NurbsCurve::GetPointOnCurve(const LN_CurveView& view, double paramT)
+{
+	return GetPointOnCurve(*view.Curve, view.Map.Scale * paramT + view.Map.Offset);
+}
+
+std::vector<LNLib::XYZ> LNLib::NurbsCurve::ComputeRationalCurveDerivatives(const LN_CurveView& view, int derivative, double paramT)
+{
+	std::vector<XYZ> derivatives = ComputeRationalCurveDerivatives(*view.Curve, derivative, view.Map.Scale * paramT + view.Map.Offset);
+	double factor = 1.0;
+	for (int k = 1; k <= derivative; k++)
+	{
+		factor *= view.Map.Scale;
+		derivatives[k] *= factor;
+	}
+	return derivatives;
 }
 
 void LNLib::NurbsCurve::Reverse(const LN_NurbsCurve& curve, LN_NurbsCurve& result)
@@ -1464,8 +1804,8 @@ bool LNLib::NurbsCurve::Merge(const LN_NurbsCurve& left, const LN_NurbsCurve& ri
 		ElevateDegree(right, times, tempR);
 	}
 
-	int l = Polynomials::GetKnotMultiplicity(tempL.KnotVector, tempL.KnotVector[tempL.KnotVector.size() - 1]);
-	int r = Polynomials::GetKnotMultiplicity(tempR.KnotVector, tempR.KnotVector[0]);
+	int l = Polynomials::GetKnotMultiplicity(tempL.KnotVector, tempL.KnotVector.back());
+	int r = Polynomials::GetKnotMultiplicity(tempR.KnotVector, tempR.KnotVector.front());
 
 	if (l != degree + 1 || r != degree + 1)
 	{
@@ -1500,12 +1840,14 @@ bool LNLib::NurbsCurve::Merge(const LN_NurbsCurve& left, const LN_NurbsCurve& ri
 		knotVector[i] = kl;
 	}
 
-	auto map = KnotVectorUtils::GetInternalKnotMultiplicityMap(tempR.KnotVector);
-	for (auto it = map.begin(); it != map.end(); it++)
+	LN_KnotStructure structureR;
+	KnotVectorUtils::CreateKnotStructure(degree, tempR.KnotVector, structureR);
+	const std::vector<double>& knotsR = structureR.Knots;
+	for (int k = 1; k < static_cast<int>(knotsR.size()) - 1; k++)
 	{
 		for (int j = 0; j < degree; j++, i++)
 		{
-			knotVector[i] = kl + it->first;
+			knotVector[i] = kl + knotsR[k];
 		}
 	}	
 
@@ -1515,12 +1857,113 @@ bool LNLib::NurbsCurve::Merge(const LN_NurbsCurve& left, const LN_NurbsCurve& ri
 	return true;
 }
 
-void LNLib::NurbsCurve::Offset(const LN_NurbsCurve& curve, double offset, LN_NurbsCurve& result)
+void LNLib::NurbsCurve::MakeCompatible(const std::vector<LN_NurbsCurve>& curves, std::vector<LN_NurbsCurve>& result)
 {
-	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
+	VALIDATE_ARGUMENT(curves.size() > 0, "curves", "Curves size must be greater than zero.");
+
+	int size = static_cast<int>(curves.size());
+	int degree = 0;
+	for (int i = 0; i < size; i++)
+	{
+		const LN_NurbsCurve& curve = curves[i];
+		VALIDATE_ARGUMENT(curve.Degree > 0, "curves", "Degree must be greater than zero.");
+		VALIDATE_ARGUMENT(ValidationUtils::IsValidNurbs(curve.Degree, curve.KnotVector.size(), curve.ControlPoints.size()), "curves", "Arguments must be fit: m = n + p + 1");
+		degree = std::max(degree, curve.Degree);
+	}
+
+	double first = curves[0].KnotVector.front();
+	double last = curves[0].KnotVector.back();
+
+	// Distinct knots of every curve mapped onto [first, last], with the multiplicities degree elevation gives them.
+	std::vector<LN_KnotStructure> structures(size);
+	std::vector<std::pair<double, int>> knots;
+	for (int i = 0; i < size; i++)
+	{
+		const LN_NurbsCurve& curve = curves[i];
+		LN_KnotStructure& structure = structures[i];
+		KnotVectorUtils::CreateKnotStructure(curve.Degree, curve.KnotVector, structure);
+
+		double start = curve.KnotVector.front();
+		double end = curve.KnotVector.back();
+		VALIDATE_ARGUMENT(end > start, "curves", "Curve parameter range must not be empty.");
+		double scale = (last - first) / (end - start);
+
+		int count = static_cast<int>(structure.Knots.size());
+		for (int k = 0; k < count; k++)
+		{
+			structure.Knots[k] = k == count - 1 ? last : first + (structure.Knots[k] - start) * scale;
+			structure.Multiplicities[k] += degree - curve.Degree;
+			knots.emplace_back(structure.Knots[k], structure.Multiplicities[k]);
+		}
+	}
+	std::sort(knots.begin(), knots.end());
+
+	std::vector<double> knotVector;
+	for (int i = 0; i < knots.size();)
+	{
+		double knot = knots[i].first;
+		int multiplicity = 0;
+		for (; i < knots.size() && MathUtils::IsAlmostEqualTo(knots[i].first, knot); i++)
+		{
+			multiplicity = std::max(multiplicity, knots[i].second);
+		}
+		knotVector.insert(knotVector.end(), multiplicity, knot);
+	}
+	LN_KnotStructure common;
+	KnotVectorUtils::CreateKnotStructure(degree, knotVector, common);
+
+	result.resize(size);
+	ThreadUtils::ParallelFor(0, size, [&](int i)
+		{
+			const LN_NurbsCurve& curve = curves[i];
+			const LN_KnotStructure& structure = structures[i];
+
+			std::vector<double> insertKnotElements;
+			for (int k = 0; k < common.Knots.size(); k++)
+			{
+				int times = common.Multiplicities[k] - KnotVectorUtils::GetKnotMultiplicity(structure, common.Knots[k]);
+				insertKnotElements.insert(insertKnotElements.end(), std::max(times, 0), common.Knots[k]);
+			}
+
+			LN_NurbsCurve compatible;
+			if (curve.Degree < degree)
+			{
+				ElevateDegree(curve, degree - curve.Degree, compatible);
+			}
+			else
+			{
+				compatible = curve;
+			}
+
+			double start = curve.KnotVector.front();
+			double end = curve.KnotVector.back();
+			if (start != first || end != last)
+			{
+				double scale = (last - first) / (end - start);
+				for (int k = 0; k < compatible.KnotVector.size(); k++)
+				{
+					compatible.KnotVector[k] = first + (compatible.KnotVector[k] - start) * scale;
+				}
+			}
+
+			if (insertKnotElements.size() > 0)
+			{
+				LN_NurbsCurve refined;
+				RefineKnotVector(compatible, insertKnotElements, refined);
+				compatible = std::move(refined);
+			}
+
+			// Knots merged within tolerance differ in the last digits, so share the one vector exactly.
+			if (compatible.KnotVector.size() == knotVector.size())
+			{
+				compatible.KnotVector = knotVector;
+			}
+			result[i] = std::move(compatible);
+		});
+}
 
+void LNLib::NurbsCurve::Offset(const LN_NurbsCurve& curve, double offset, LN_NurbsCurve& result)
+{
 	if (MathUtils::IsAlmostEqualTo(offset, 0.0))
 	{
 		result = curve;
@@ -1531,16 +1974,217 @@ void LNLib::NurbsCurve::Offset(const LN_NurbsCurve& curve, double offset, LN_Nur
 	std::vector<double> correspondingKnots;
 	EquallyTessellate(curve, tessellatedPoints, correspondingKnots);
 
-	std::vector<XYZ> newPoints(tessellatedPoints.size());
+	// Tessellation repeats the points at span boundaries, which interpolation cannot take twice.
+	std::vector<XYZ> newPoints;
+	newPoints.reserve(tessellatedPoints.size());
 	for (int i = 0; i < tessellatedPoints.size(); i++)
 	{
+		if (i > 0 && correspondingKnots[i] == correspondingKnots[i - 1]) continue;
 		XYZ newPoint = tessellatedPoints[i] + offset * Normal(curve, CurveNormal::Normal, correspondingKnots[i]);
-		newPoints[i] = newPoint;
+		newPoints.emplace_back(newPoint);
 	}
 
 	GlobalInterpolation(3, newPoints, result);
 }
 
+void LNLib::NurbsCurve::Offset(const LN_NurbsCurve& curve, double offset, double tolerance, LN_NurbsCurve& result, LN_OffsetReport& report)
+{
+	VALIDATE_ARGUMENT(tolerance > 0.0, "tolerance", "Tolerance must be greater than zero.");
+
+	report.CuspParameters.clear();
+	report.SelfIntersections.clear();
+	if (MathUtils::IsAlmostEqualTo(offset, 0.0))
+	{
+		result = curve;
+		return;
+	}
+
+	int degree = curve.Degree;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	int size = knotVector.size();
+	XYZ planeNormal = GetCurvePlaneNormal(curve);
+
+	// The offset loses one order of continuity at every knot of the curve.
+	// A cubic fit therefore gets each distinct interior knot with multiplicity m + 4 - degree.
+	const int fitDegree = 3;
+	std::vector<double> breakpoints;
+	std::vector<int> multiplicities;
+	for (int i = degree; i <= size - degree - 1; i++)
+	{
+		if (i > degree && knotVector[i] == knotVector[i - 1]) continue;
+		int m = std::count(knotVector.begin(), knotVector.end(), knotVector[i]);
+		breakpoints.emplace_back(knotVector[i]);
+		multiplicities.emplace_back(std::max(1, std::min(fitDegree, m + fitDegree + 1 - degree)));
+	}
+	int spans = breakpoints.size() - 1;
+
+	// Sample span by span, splitting where the tangent turns fast, with at least fitDegree + 1 samples per span.
+	const double maxAngle = 0.2;
+	const int maxDepth = 12;
+	std::vector<std::vector<double>> spanParams(spans);
+	ThreadUtils::ParallelFor(0, spans, [&](int i)
+		{
+			double step = (breakpoints[i + 1] - breakpoints[i]) / (fitDegree + 1);
+			for (int k = 0; k <= fitDegree; k++)
+			{
+				double start = breakpoints[i] + k * step;
+				double end = k == fitDegree ? breakpoints[i + 1] : start + step;
+				XYZ startTangent = ComputeRationalCurveDerivatives(curve, 1, start)[1];
+				SampleOffsetSpan(curve, start, end, startTangent, maxAngle, maxDepth, spanParams[i]);
+			}
+		});
+	std::vector<double> params(1, breakpoints[0]);
+	for (int i = 0; i < spans; i++)
+	{
+		params.insert(params.end(), spanParams[i].begin(), spanParams[i].end());
+	}
+
+	int count = params.size();
+	std::vector<XYZ> points(count);
+	std::vector<double> factors(count);
+	ThreadUtils::ParallelFor(0, count, [&](int i)
+		{
+			points[i] = GetOffsetPoint(curve, planeNormal, offset, params[i], factors[i]);
+		}, 64);
+
+	// Cusps lie where the speed factor changes sign.
+	for (int i = 0; i < count - 1; i++)
+	{
+		if ((factors[i] > 0.0) == (factors[i + 1] > 0.0)) continue;
+		double a = params[i];
+		double b = params[i + 1];
+		double fa = factors[i];
+		while (b - a > Constants::DoubleEpsilon * (breakpoints[spans] - breakpoints[0]) * 1e-3)
+		{
+			double mid = 0.5 * (a + b);
+			double fm = 0.0;
+			GetOffsetPoint(curve, planeNormal, offset, mid, fm);
+			if ((fm > 0.0) == (fa > 0.0))
+			{
+				a = mid;
+				fa = fm;
+			}
+			else
+			{
+				b = mid;
+			}
+		}
+		report.CuspParameters.emplace_back(0.5 * (a + b));
+	}
+
+	std::vector<double> fitKnots(fitDegree + 1, breakpoints[0]);
+	for (int i = 1; i < spans; i++)
+	{
+		fitKnots.insert(fitKnots.end(), multiplicities[i], breakpoints[i]);
+	}
+	fitKnots.insert(fitKnots.end(), fitDegree + 1, breakpoints[spans]);
+
+	// Fit with banded least squares and check the exact offset halfway between samples.
+	// Knot spans that miss the tolerance are split at their middle sample and get twice the samples.
+	const int maxIterations = 20;
+	LN_NurbsCurve fitted;
+	fitted.Degree = fitDegree;
+	for (int iteration = 0; ; iteration++)
+	{
+		std::vector<XYZW> controlPoints;
+		int n = fitKnots.size() - fitDegree - 1;
+		if (!LeastSquaresControlPoints(fitDegree, points, fitKnots, params, n, controlPoints))
+		{
+			VALIDATE_ARGUMENT(iteration > 0, "curve", "Curve offset could not be fitted.");
+			break;
+		}
+		fitted.KnotVector = fitKnots;
+		fitted.ControlPoints = controlPoints;
+		if (iteration == maxIterations) break;
+
+		int intervals = params.size() - 1;
+		std::vector<double> middles(intervals);
+		std::vector<XYZ> middlePoints(intervals);
+		std::vector<char> isFailed(intervals, 0);
+		ThreadUtils::ParallelFor(0, intervals, [&](int i)
+			{
+				double factor = 0.0;
+				middles[i] = 0.5 * (params[i] + params[i + 1]);
+				middlePoints[i] = GetOffsetPoint(curve, planeNormal, offset, middles[i], factor);
+				isFailed[i] = GetPointOnCurve(fitted, middles[i]).Distance(middlePoints[i]) > tolerance ||
+					GetPointOnCurve(fitted, params[i]).Distance(points[i]) > tolerance;
+			}, 64);
+
+		std::vector<char> isSplit(fitKnots.size(), 0);
+		bool hasFailed = false;
+		int spanIndex = fitDegree;
+		std::vector<int> intervalSpans(intervals);
+		for (int i = 0; i < intervals; i++)
+		{
+			spanIndex = GetNextKnotSpanIndex(fitDegree, fitKnots, middles[i], spanIndex);
+			intervalSpans[i] = spanIndex;
+			if (isFailed[i])
+			{
+				isSplit[spanIndex] = 1;
+				hasFailed = true;
+			}
+		}
+		if (!hasFailed) break;
+
+		std::vector<double> newParams;
+		std::vector<XYZ> newPoints;
+		newParams.reserve(2 * params.size());
+		newPoints.reserve(2 * params.size());
+		for (int i = 0, first = 0; i < intervals; i++)
+		{
+			if (i > 0 && intervalSpans[i] != intervalSpans[i - 1])
+			{
+				first = i;
+			}
+			newParams.emplace_back(params[i]);
+			newPoints.emplace_back(points[i]);
+			if (!isSplit[intervalSpans[i]]) continue;
+
+			newParams.emplace_back(middles[i]);
+			newPoints.emplace_back(middlePoints[i]);
+			bool isLast = i + 1 == intervals || intervalSpans[i + 1] != intervalSpans[i];
+			if (isLast && i > first)
+			{
+				// Samples never straddle knots, so the middle sample lies inside the span.
+				fitKnots.emplace_back(params[(first + i + 1) / 2]);
+			}
+		}
+		newParams.emplace_back(params.back());
+		newPoints.emplace_back(points.back());
+		std::sort(fitKnots.begin(), fitKnots.end());
+		params = std::move(newParams);
+		points = std::move(newPoints);
+	}
+
+	// Crossings of the sample polyline, moved onto the fitted offset by Newton iteration in the plane.
+	std::vector<UV> crossings = GetPolylineSelfIntersections(params, points, planeNormal);
+	double first = breakpoints[0];
+	double last = breakpoints[spans];
+	for (const UV& crossing : crossings)
+	{
+		double s = crossing[0];
+		double t = crossing[1];
+		for (int iteration = 0; iteration < 10; iteration++)
+		{
+			std::vector<XYZ> ders0 = ComputeRationalCurveDerivatives(fitted, 1, s);
+			std::vector<XYZ> ders1 = ComputeRationalCurveDerivatives(fitted, 1, t);
+			XYZ difference = ders0[0] - ders1[0];
+			if (difference.Length() <= Constants::DoubleEpsilon) break;
+
+			// Solve ders0[1] * ds - ders1[1] * dt = -difference within the plane.
+			double determinant = planeNormal.DotProduct(ders0[1].CrossProduct(-ders1[1]));
+			if (MathUtils::IsAlmostEqualTo(determinant, 0.0)) break;
+			double ds = planeNormal.DotProduct((-difference).CrossProduct(-ders1[1])) / determinant;
+			double dt = planeNormal.DotProduct(ders0[1].CrossProduct(-difference)) / determinant;
+			s = std::max(first, std::min(last, s + ds));
+			t = std::max(first, std::min(last, t + dt));
+		}
+		bool isConverged = GetPointOnCurve(fitted, s).Distance(GetPointOnCurve(fitted, t)) <= tolerance && s < t;
+		report.SelfIntersections.emplace_back(isConverged ? UV(s, t) : crossing);
+	}
+	result = fitted;
+}
+
 void LNLib::NurbsCurve::CreateLine(const XYZ& start, const XYZ& end, LN_NurbsCurve& result)
 {
 	VALIDATE_ARGUMENT(!start.IsAlmostEqualTo(end), "end", "start must not be equal to end.");
@@ -1879,7 +2523,6 @@ void LNLib::NurbsCurve::GlobalInterpolation(int degree, const std::vector<XYZ>&
 	VALIDATE_ARGUMENT(degree >= 0 && degree <= Constants::NURBSMaxDegree, "degree", "Degree must be greater than or equal zero and not exceed the maximun degree.");
 	VALIDATE_ARGUMENT(throughPoints.size() > degree, "throughPoints", "ThroughPoints size must be greater than degree.");
 	int size = throughPoints.size();
-	int n = size - 1;
 
 	std::vector<double> uk(size);
 	if (params.size() == 0)
@@ -1889,42 +2532,35 @@ void LNLib::NurbsCurve::GlobalInterpolation(int degree, const std::vector<XYZ>&
 	else
 	{
 		VALIDATE_ARGUMENT(params.size() == size , "params", "Params size must be equal to throughPoints size.");
+		VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(params), "params", "Params must be a nondecreasing sequence of real numbers.");
 		uk = params;
 	}
 	std::vector<double> knotVector = Interpolation::AverageKnotVector(degree, uk);
 
-	std::vector<std::vector<double>> A(size, std::vector<double>(size));
-	for (int i = 1; i < n; i++)
-	{
-		int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, uk[i]);
-		double basis[Constants::NURBSMaxDegree + 1];
-		Polynomials::BasisFunctions(spanIndex, degree, knotVector, uk[i], basis);
-
-		for (int j = 0; j <= degree; j++)
-		{
-			A[i][spanIndex - degree + j] = basis[j];
-		}
-	}
-	A[0][0] = 1.0;
-	A[n][n] = 1.0;
+	MatrixXd A;
+	int lower = 0;
+	int upper = 0;
+	Interpolation::ComputeInterpolationMatrix(degree, knotVector, uk, A, lower, upper);
 
-	std::vector<std::vector<double>> right(size, std::vector<double>(3));
+	MatrixXd right(size, 3);
 	for (int i = 0; i < size; i++)
 	{
 		for (int j = 0; j < 3; j++)
 		{
-			right[i][j] = throughPoints[i][j];
+			right(i, j) = throughPoints[i][j];
 		}
 	}
 
 	std::vector<XYZW> controlPoints(size);
-	std::vector<std::vector<double>> result = MathUtils::SolveLinearSystem(A, right);
-	for (int i = 0; i < result.size(); i++)
+	MatrixXd result;
+	bool solved = MathUtils::SolveBandedLinearSystem(A, lower, upper, right, result);
+	VALIDATE_ARGUMENT(solved, "throughPoints", "ThroughPoints must have distinct parameters.");
+	for (int i = 0; i < result.GetRowCount(); i++)
 	{
 		XYZ temp = XYZ(0, 0, 0);
 		for (int j = 0; j < 3; j++)
 		{
-			temp[j] = result[i][j];
+			temp[j] = result(i, j);
 		}
 		controlPoints[i] = XYZW(temp, 1.0);
 	}
@@ -1977,13 +2613,13 @@ void LNLib::NurbsCurve::GlobalInterpolation(int degree, const std::vector<XYZ>&
 			knotVector[i] = 0.0;
 			knotVector[knotVector.size() - 1 - i] = 1.0;
 		}
-		for (int i = 1; i < size - 1; i++)
+		for (int i = 1; i < size - 2; i++)
 		{
 			knotVector[degree + 2 * i] = (2 * uk[i] + uk[i + 1]) / 3.0;
 			knotVector[degree + 2 * i + 1] = (uk[i] + 2 * uk[i + 1]) / 3.0;
 		}
 		knotVector[4] = uk[1] / 2.0;
-		knotVector[knotVector.size() - degree - 2] = (uk[size - 1] + 1.0) / 2.0;
+		knotVector[knotVector.size() - degree - 2] = (uk[size - 2] + 1.0) / 2.0;
 		break;
 	}
 	default:
@@ -1999,33 +2635,34 @@ void LNLib::NurbsCurve::GlobalInterpolation(int degree, const std::vector<XYZ>&
 	}
 	}
 
-	std::vector<std::vector<double>> A(n, std::vector<double>(n));
+	std::vector<int> firstColumns(n, 0);
+	std::vector<std::vector<double>> A(n);
+	int spanIndex = degree;
 	for (int i = 1; i < size - 1; i++)
 	{
-		int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, uk[i]);
+		spanIndex = GetNextKnotSpanIndex(degree, knotVector, uk[i], spanIndex);
 		double basis[Constants::NURBSMaxDegree + 1];
 		Polynomials::BasisFunctions(spanIndex, degree, knotVector, uk[i], basis);
 		std::vector<std::vector<double>> derBasis = Polynomials::BasisFunctionsDerivatives(spanIndex, degree, 1, knotVector, uk[i]);
-		for (int j = 0; j <= degree; j++)
-		{
-			A[2 * i][spanIndex - degree + j] = basis[j];
-			A[2 * i + 1][spanIndex - degree + j] = derBasis[1][j];
-		}
+
+		firstColumns[2 * i] = firstColumns[2 * i + 1] = spanIndex - degree;
+		A[2 * i].assign(basis, basis + degree + 1);
+		A[2 * i + 1] = derBasis[1];
 	}
-	A[0][0] = 1.0;
-	A[1][0] = -1.0;
-	A[1][1] = 1.0;
-	A[A.size() - 2][A[0].size() - 2] = -1.0;
-	A[A.size() - 2][A[0].size() - 1] = 1.0;
-	A[A.size() - 1][A[0].size() - 1] = 1.0;
+	A[0] = { 1.0 };
+	A[1] = { -1.0, 1.0 };
+	firstColumns[n - 2] = n - 2;
+	A[n - 2] = { -1.0, 1.0 };
+	firstColumns[n - 1] = n - 1;
+	A[n - 1] = { 1.0 };
 
-	std::vector<std::vector<double>> right(n, std::vector<double>(3));
+	MatrixXd right(n, 3);
 	for (int i = 0; i < size; i++)
 	{
 		for (int j = 0; j < 3; j++)
 		{
-			right[2 * i][j] = throughPoints[i][j];
-			right[2 * i + 1][j] = unitTangents[i][j] * d;
+			right(2 * i, j) = throughPoints[i][j];
+			right(2 * i + 1, j) = unitTangents[i][j] * d;
 		}
 	}
 
@@ -2037,18 +2674,20 @@ void LNLib::NurbsCurve::GlobalInterpolation(int degree, const std::vector<XYZ>&
 	XYZ qpn = throughPoints[size - 1];
 	for (int j = 0; j < 3; j++)
 	{
-		right[1][j] = d0 * dp0[j] * d;
-		right[A[0].size() - 2][j] = dn * dpn[j] * d;
-		right[A[0].size() - 1][j] = qpn[j];
+		right(1, j) = d0 * dp0[j] * d;
+		right(n - 2, j) = dn * dpn[j] * d;
+		right(n - 1, j) = qpn[j];
 	}
 
-	std::vector<std::vector<double>> result = MathUtils::SolveLinearSystem(A, right);
-	for (int i = 0; i < result.size(); i++)
+	MatrixXd result;
+	bool solved = SolveBandedRows(firstColumns, A, right, result);
+	VALIDATE_ARGUMENT(solved, "throughPoints", "ThroughPoints must have distinct parameters.");
+	for (int i = 0; i < result.GetRowCount(); i++)
 	{
 		XYZ temp = XYZ(0, 0, 0);
 		for (int j = 0; j < 3; j++)
 		{
-			temp[j] = result[i][j];
+			temp[j] = result(i, j);
 		}
 		controlPoints[i] = XYZW(temp, 1.0);
 	}
@@ -2151,80 +2790,91 @@ bool LNLib::NurbsCurve::LeastSquaresApproximation(int degree, const std::vector<
 		knotVector[degree + j] /= degree;
 	}
 
-	std::vector<XYZW> controlPoints(n);
-	std::vector<XYZ> R(n);
-	std::vector<XYZ> rk(m);
-	std::vector<double> funs(degree + 1);
-	std::vector<std::vector<double>> N(m, std::vector<double>(n));
-	R[0] = throughPoints[0];
-	R[n - 1] = throughPoints[m - 1];
-	N[0][0] = 1.0;
-	N[m - 1][n - 1] = 1.0;
-
-	for (int i = 0; i < m; i++)
-	{
-		int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, uk[i]);
-		double basis[Constants::NURBSMaxDegree + 1];
-		Polynomials::BasisFunctions(spanIndex, degree, knotVector, uk[i], basis);
-		for (int j = 0; j <= degree; j++)
-		{
-			N[i][spanIndex - degree + j] = basis[j];
-		}
-		rk[i] = throughPoints[i] - N[i][0] * throughPoints[0] - N[i][n - 1] * throughPoints[m - 1];
+	std::vector<XYZW> controlPoints;
+	if (!LeastSquaresControlPoints(degree, throughPoints, knotVector, uk, n, controlPoints))
+	{
+		return false;
 	}
+	curve.Degree = degree;
+	curve.KnotVector = knotVector;
+	curve.ControlPoints = controlPoints;
+	return true;
+}
+
+bool LNLib::NurbsCurve::LeastSquaresApproximation(int degree, const std::vector<XYZ>& throughPoints, const std::vector<double>& params, const std::vector<double>& knotVector, LN_NurbsCurve& curve)
+{
+	VALIDATE_ARGUMENT(degree >= 0 && degree <= Constants::NURBSMaxDegree, "degree", "Degree must be greater than or equal zero and not exceed the maximun degree.");
+	VALIDATE_ARGUMENT(params.size() == throughPoints.size(), "params", "Params size must be equal to throughPoints size.");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(knotVector), "knotVector", "KnotVector must be a nondecreasing sequence of real numbers.");
+
+	int controlPointsCount = static_cast<int>(knotVector.size()) - degree - 1;
+	VALIDATE_ARGUMENT(controlPointsCount > 0, "knotVector", "KnotVector size must be greater than degree + 1.");
 
-	for (int i = 0; i < n; i++) 
+	std::vector<XYZW> controlPoints;
+	if (!LeastSquaresControlPoints(degree, throughPoints, knotVector, params, controlPointsCount, controlPoints))
 	{
-		R[i] = XYZ();
-		for (int j = 0; j < m; j++)
-		{
-			R[i] += N[j][i] * rk[j];
-		}
-			
-		if (R[i].IsAlmostEqualTo(XYZ()))
-		{
-			return false;
-		}
+		return false;
 	}
-	
-	if (n - 2 > 0) 
+	curve.Degree = degree;
+	curve.KnotVector = knotVector;
+	curve.ControlPoints = std::move(controlPoints);
+	return true;
+}
+
+bool LNLib::NurbsCurve::LeastSquaresApproximation(int degree, const std::vector<XYZ>& throughPoints, int controlPointsCount, int maxIterations, double tolerance, LN_NurbsCurve& curve, LN_FittingReport& report)
+{
+	VALIDATE_ARGUMENT(maxIterations >= 0, "maxIterations", "MaxIterations must be greater than or equal zero.");
+	VALIDATE_ARGUMENT(tolerance >= 0.0, "tolerance", "Tolerance must not be negative.");
+
+	if (!LeastSquaresApproximation(degree, throughPoints, controlPointsCount, curve))
 	{
-		std::vector<std::vector<double>> X(n - 2, std::vector<double>(3));
-		std::vector<std::vector<double>> B(n - 2, std::vector<double>(3));
-		std::vector<std::vector<double>> Ns(m - 2, std::vector<double>(n-2));
-		for (int i = 0; i < n - 2; i++) 
-		{
-			for (int j = 0; j < 3; j++)
+		return false;
+	}
+
+	int m = throughPoints.size();
+	std::vector<double> uk = Interpolation::GetChordParameterization(throughPoints);
+	std::vector<double> distances(m);
+	report.MaxErrors.clear();
+	report.RmsErrors.clear();
+	std::vector<XYZW> bestControlPoints = curve.ControlPoints;
+	double bestMaxError = Constants::MaxDistance;
+	for (int iteration = 0; ; iteration++)
+	{
+		// End points stay at the curve ends, the others move to their projections.
+		ThreadUtils::ParallelFor(0, m, [&](int i)
 			{
-				B[i][j] = R[i + 1][j];
-			}	
-		}
-		for (int i = 1; i <= m - 2; i++)
+				if (i > 0 && i < m - 1)
+				{
+					uk[i] = GetParamOnCurve(curve, throughPoints[i], uk[i]);
+				}
+				distances[i] = GetPointOnCurve(curve, uk[i]).Distance(throughPoints[i]);
+			}, 256);
+
+		double maxError = 0.0;
+		double squareSum = 0.0;
+		for (int i = 0; i < m; i++)
 		{
-			for (int j = 1; j <= n - 2; j++)
-			{
-				Ns[i - 1][j - 1] = N[i][j];
-			}
+			maxError = std::max(maxError, distances[i]);
+			squareSum += distances[i] * distances[i];
 		}
-		std::vector<std::vector<double>> NsT;
-		MathUtils::Transpose(Ns, NsT);
-		auto NsTNs = MathUtils::MatrixMultiply(NsT, Ns);
-		X = MathUtils::SolveLinearSystem(NsTNs, B);
+		report.MaxErrors.emplace_back(maxError);
+		report.RmsErrors.emplace_back(std::sqrt(squareSum / m));
 
-		for (int i = 0; i < n - 2; i++)
+		// A refit may increase the error, so only the best fit so far is kept.
+		if (maxError < bestMaxError)
 		{
-			double x = X[i][0];
-			double y = X[i][1];
-			double z = X[i][2];
-			controlPoints[i+1] = XYZW(XYZ(x,y,z),1);
+			bestMaxError = maxError;
+			bestControlPoints = curve.ControlPoints;
 		}
-	}
-	controlPoints[0] = XYZW(throughPoints[0],1);
-	controlPoints[n - 1] = XYZW(throughPoints[m - 1],1);
 
-	curve.Degree = degree;
-	curve.KnotVector = knotVector;
-	curve.ControlPoints = controlPoints;
+		if (iteration == maxIterations) break;
+		if (iteration > 0 && report.MaxErrors[iteration - 1] - maxError < tolerance) break;
+
+		std::vector<XYZW> controlPoints;
+		if (!LeastSquaresControlPoints(degree, throughPoints, curve.KnotVector, uk, controlPointsCount, controlPoints)) break;
+		curve.ControlPoints = std::move(controlPoints);
+	}
+	curve.ControlPoints = std::move(bestControlPoints);
 	return true;
 }
 
@@ -2277,165 +2927,124 @@ bool LNLib::NurbsCurve::WeightedAndContrainedLeastSquaresApproximation(int degre
 	std::vector<double> knotVector = Interpolation::ComputeKnotVector(degree, size, controlPointsCount, uk);
 	std::vector<XYZW> controlPoints(controlPointsCount);
 
-	int j = 0;
-	int mu2 = 0;
-	int mc2 = 0;
-
-	std::vector<std::vector<double>> N(mu + 1, std::vector<double>(n + 1));
-	std::vector<std::vector<double>> M(mc + 1, std::vector<double>(n + 1));
-	std::vector<XYZ> S(mu + 1);
-	std::vector<XYZ> T(mc + 1);
+	// Accumulate the lower half of NT * W * N and NT * W * S row by row,
+	// keeping constraint rows of M with their first column.
+	MatrixXd tNWN(n + 1, degree + 1);
+	MatrixXd Y(n + 1, 3);
+	std::vector<int> constraintColumns;
+	std::vector<std::vector<double>> M;
+	std::vector<XYZ> T;
 
-	std::vector<double> W(mu + 1);
-	std::vector<std::vector<double>> funs(2, std::vector<double>(degree + 1));
-
-	for (int i = 0; i <= r; i++)
+	int spanIndex = degree;
+	auto addRow = [&](const double* funs, double weight, const XYZ& value)
 	{
-		int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, uk[i]);
-		
-		bool dflag = false;
-		if (j <= s)
+		int first = spanIndex - degree;
+		if (MathUtils::IsGreaterThan(weight, 0.0))
 		{
-			if (i == tangentIndices[j])
+			for (int a = 0; a <= degree; a++)
 			{
-				dflag = true;
+				for (int b = 0; b <= a; b++)
+				{
+					tNWN(first + a, b - a + degree) += weight * funs[a] * funs[b];
+				}
+				for (int c = 0; c < 3; c++)
+				{
+					Y(first + a, c) += weight * funs[a] * value[c];
+				}
 			}
 		}
-		if (!dflag)
-		{
-			std::vector<double> temp(degree + 1);
-			Polynomials::BasisFunctions(spanIndex, degree, knotVector, uk[i], temp.data());
-			funs[0] = temp;
-		}
 		else
 		{
-			funs = Polynomials::BasisFunctionsDerivatives(spanIndex, degree, 1, knotVector, uk[i]);
+			constraintColumns.emplace_back(first);
+			M.emplace_back(funs, funs + degree + 1);
+			T.emplace_back(value);
 		}
-		if (MathUtils::IsGreaterThan(throughPointWeights[i], 0.0))
+	};
+
+	int j = 0;
+	for (int i = 0; i <= r; i++)
+	{
+		spanIndex = GetNextKnotSpanIndex(degree, knotVector, uk[i], spanIndex);
+		bool dflag = j <= s && i == tangentIndices[j];
+
+		double funs[2][Constants::NURBSMaxDegree + 1];
+		if (!dflag)
 		{
-			W[mu2] = throughPointWeights[i];
-			//
-			// My question: 
-			// 
-			// N is (mu + 1) rows, (n + 1) columns;
-			// funs is 2 rows, (degree + 1) columns;
-			// How to match column data? Is controlPointsCount must equal degree + 1?
-			//
-			for (int z = 0; z < funs[0].size(); z++)
-			{
-				N[mu2][z] = funs[0][z];
-			}
-			S[mu2] = W[mu2] * throughPoints[i];
-			mu2++;
+			Polynomials::BasisFunctions(spanIndex, degree, knotVector, uk[i], funs[0]);
 		}
 		else
 		{
-			for (int z = 0; z < funs[0].size(); z++)
-			{
-				M[mc2][z] = funs[0][z];
-			}
-			T[mc2] = throughPoints[i];
-			mc2++;
+			Polynomials::BasisFunctionsFirstOrderDerivative(spanIndex, degree, knotVector, uk[i], funs);
 		}
+		addRow(funs[0], throughPointWeights[i], throughPoints[i]);
 		if (dflag)
 		{
-			if (MathUtils::IsGreaterThan(tangentWeights[j], 0.0))
-			{
-				W[mu2] = tangentWeights[j];
-				for (int z = 0; z < funs[1].size(); z++)
-				{
-					N[mu2][z] = funs[1][z];
-				}
-				S[mu2] = W[mu2] * tangents[j];
-				mu2++;
-			}
-			else
-			{
-				for (int z = 0; z < funs[1].size(); z++)
-				{
-					M[mc2][z] = funs[1][z];
-				}
-				T[mc2] = tangents[j];
-				mc2++;
-			}
+			addRow(funs[1], tangentWeights[j], tangents[j]);
 			j++;
 		}
 	}
-	
-	std::vector<std::vector<double>> tN;
-	MathUtils::Transpose(N, tN);
 
-	std::vector<std::vector<double>> W_ = MathUtils::MakeDiagonal(W.size());
-	std::vector<std::vector<double>> tNW = MathUtils::MatrixMultiply(tN, W_);
-	std::vector<std::vector<double>> tNWN = MathUtils::MatrixMultiply(tNW, N);
-
-	std::vector<std::vector<double>> S_(S.size(), std::vector<double>(3));
-	for (int i = 0; i < S.size(); i++)
+	if (!MathUtils::BandedCholeskyDecomposition(tNWN, degree))
 	{
-		for (int j = 0; j < 3; j++)
-		{
-			S_[i][j] = S[i][j];
-		}
+		return false;
 	}
-	std::vector<std::vector<double>> tNWS = MathUtils::MatrixMultiply(tNW, S_);
-	
-	if (mc < 0)
+	MathUtils::BandedCholeskySolve(tNWN, degree, Y);
+
+	int constraints = M.size();
+	if (constraints > 0)
 	{
-		std::vector<std::vector<double>> result = MathUtils::SolveLinearSystem(tNWN, tNWS);
-		for (int i = 0; i < result.size(); i++)
+		// Lagrange multipliers A solve (M * inv(tNWN) * tM) * A = M * Y - T,
+		// with inv(tNWN) applied by the Cholesky factor.
+		MatrixXd X(n + 1, constraints);
+		for (int k = 0; k < constraints; k++)
 		{
-			XYZ temp = XYZ(0, 0, 0);
-			for (int j = 0; j < 3; j++)
+			for (int a = 0; a <= degree; a++)
 			{
-				temp[j] = result[i][j];
+				X(constraintColumns[k] + a, k) = M[k][a];
 			}
-			controlPoints[i] = XYZW(temp, 1.0);
 		}
-	}
-	else
-	{
-		std::vector<std::vector<double>> inv_tNWN;
-		bool canInverse = MathUtils::MakeInverse(tNWN, inv_tNWN);
-		if (!canInverse) return false;
+		MathUtils::BandedCholeskySolve(tNWN, degree, X);
 
-		std::vector<std::vector<double>> tM;
-		MathUtils::Transpose(M, tM);
-
-		std::vector<std::vector<double>> Minv_tNWN = MathUtils::MatrixMultiply(M, inv_tNWN);
-		std::vector<std::vector<double>> Minv_tNWN_tM = MathUtils::MatrixMultiply(Minv_tNWN, tM);
-
-		std::vector<std::vector<double>> Minv_tNWN_tNWS = MathUtils::MatrixMultiply(Minv_tNWN, tNWS);
-		std::vector<std::vector<double>> Minv_tNWN_tNWS_T(T.size(), std::vector<double>(3));
-		for (int i = 0; i < T.size(); i++)
+		MatrixXd MX(constraints, constraints);
+		MatrixXd MY_T(constraints, 3);
+		for (int k = 0; k < constraints; k++)
 		{
-			for (int j = 0; j < 3; j++)
+			for (int a = 0; a <= degree; a++)
 			{
-				Minv_tNWN_tNWS_T[i][j] = Minv_tNWN_tNWS[i][j] - T[i][j];
+				int column = constraintColumns[k] + a;
+				for (int l = 0; l < constraints; l++)
+				{
+					MX(k, l) += M[k][a] * X(column, l);
+				}
+				for (int c = 0; c < 3; c++)
+				{
+					MY_T(k, c) += M[k][a] * Y(column, c);
+				}
 			}
-		}
-
-		std::vector<std::vector<double>> A = MathUtils::SolveLinearSystem(Minv_tNWN_tM, Minv_tNWN_tNWS_T);
-		std::vector<std::vector<double>> tMA = MathUtils::MatrixMultiply(tM, A);
-		std::vector<std::vector<double>> tNWS_tMA(tNWS.size(), std::vector<double>(3));
-		for (int i = 0; i < tNWS.size(); i++)
-		{
-			for (int j = 0; j < 3; j++)
+			for (int c = 0; c < 3; c++)
 			{
-				tNWS_tMA[i][j] = tNWS[i][j] - tMA[i][j];
+				MY_T(k, c) -= T[k][c];
 			}
 		}
-		std::vector<std::vector<double>> result = MathUtils::MatrixMultiply(inv_tNWN, tNWS_tMA);
-		for (int i = 0; i < result.size(); i++)
+		MatrixXd A = MathUtils::SolveLinearSystem(MX, MY_T);
+
+		for (int i = 0; i <= n; i++)
 		{
-			XYZ temp = XYZ(0, 0, 0);
-			for (int j = 0; j < 3; j++)
+			for (int c = 0; c < 3; c++)
 			{
-				temp[j] = result[i][j];
+				for (int l = 0; l < constraints; l++)
+				{
+					Y(i, c) -= X(i, l) * A(l, c);
+				}
 			}
-			controlPoints[i] = XYZW(temp, 1.0);
 		}
 	}
 
+	for (int i = 0; i <= n; i++)
+	{
+		controlPoints[i] = XYZW(XYZ(Y(i, 0), Y(i, 1), Y(i, 2)), 1.0);
+	}
+
 	curve.Degree = degree;
 	curve.KnotVector = knotVector;
 	curve.ControlPoints = controlPoints;
@@ -2446,250 +3055,213 @@ bool LNLib::NurbsCurve::WeightedAndContrainedLeastSquaresApproximation(int degre
 double LNLib::NurbsCurve::ComputerRemoveKnotErrorBound(const LN_NurbsCurve& curve, int removalIndex)
 {
 	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	const std::vector<XYZW>& controlPoints = curve.ControlPoints;
 
 	VALIDATE_ARGUMENT_RANGE(removalIndex, 0, knotVector.size()-1);
 
-	int ord = degree + 1;
-	int r = removalIndex;
-	double u = knotVector[r];
-	int s = Polynomials::GetKnotMultiplicity(knotVector, u);
-	int last = r - s;
-	int first = r - degree;
-	int off = first - 1;
-
-	std::vector<XYZW> temp(knotVector.size());
-	temp[0] = controlPoints[off];
-	temp[last + 1 - off] = controlPoints[last + 1];
-
-	int i = first, j = last;
-	int ii = 1, jj = last - off;
-
-	double alfi = 0.0, alfj = 0.0;
-
-	while (j - i > 0)
-	{
-		alfi = (u - knotVector[i]) / (knotVector[i + ord] - knotVector[i]);
-		alfj = (u - knotVector[j]) / (knotVector[j + ord] - knotVector[j]);
-		temp[ii] = (controlPoints[i] - (1.0 - alfi) * temp[ii - 1]) / alfi;
-		temp[jj] = (controlPoints[j] - alfj * temp[jj + 1]) / (1.0 - alfj);
-
-		i += 1;
-		ii += 1;
-		j = j - 1;
-		jj = jj - 1;
-	}
-	if (j - i < 0)
-	{
-		return temp[ii - 1].Distance(temp[jj + 1]);
-	}
-	else
-	{
-		alfi = (u - knotVector[i]) / (knotVector[i + ord] - knotVector[i]);
-		return controlPoints[i].Distance(alfi * temp[ii + 1] + (1.0 - alfi) * temp[ii - 1]);
-	}
+	int s = Polynomials::GetKnotMultiplicity(knotVector, knotVector[removalIndex]);
+	return GetRemoveKnotErrorBound(degree, knotVector, controlPoints, removalIndex, s);
 }
 
 void LNLib::NurbsCurve::RemoveKnotsByGivenBound(const LN_NurbsCurve& curve, const std::vector<double> params, std::vector<double>& errors, double maxError, LN_NurbsCurve& result)
 {
 	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	std::vector<XYZW> controlPoints = curve.ControlPoints;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	const std::vector<XYZW>& controlPoints = curve.ControlPoints;
 
 	VALIDATE_ARGUMENT(params.size() > 0, "params", "Params size must be greater than zero.");
 	VALIDATE_ARGUMENT(params.size() == errors.size(), "errors", "Errors size must be equal to params size.");
 	VALIDATE_ARGUMENT(MathUtils::IsGreaterThan(maxError,0.0), "maxError", "Maxerror must be greater than zero.");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(params), "params", "Params must be a nondecreasing sequence of real numbers.");
 
-	int knotSize = knotVector.size();
-	std::vector<double> Br(knotSize, Constants::MaxDistance);
-	std::vector<int> S(knotSize, 0);
-	std::vector<int> Nl(knotSize);
-	std::vector<int> Nr(knotSize, params.size() - 1);
-
-	std::vector<double> uk = params;
+	const std::vector<double>& uk = params;
 	int ukSize = uk.size();
-	std::vector<double> NewError(ukSize);
-	std::vector<double> temp(ukSize);
-
-	int i, BrMinIndex = 0;
-	int r, s, Rstart, Rend, k;
-	double BrMin, u;
+	int size = knotVector.size();
+	double startKnot = knotVector[0];
+	double endKnot = knotVector[size - 1];
+
+	// Knots are kept in a linked list so that a removal only touches its neighborhood.
+	// Node i holds knot i and, from degree + 1 on, control point i - degree - 1.
+	std::vector<double> knots = knotVector;
+	std::vector<XYZW> points(size);
+	std::copy(controlPoints.begin(), controlPoints.end(), points.begin() + degree + 1);
+	std::vector<int> previous(size);
+	std::vector<int> next(size);
+	for (int i = 0; i < size; i++)
+	{
+		previous[i] = i - 1;
+		next[i] = i + 1 < size ? i + 1 : -1;
+	}
+	int controlPointsCount = controlPoints.size();
 
-	int controlPointsSize = controlPoints.size();
-	int n = controlPointsSize - 1;
-	s = 1;
-	for (int i = degree + 1; i < controlPointsSize; i++)
+	// A candidate is the last occurrence of an interior knot.
+	auto isCandidate = [&](int node)
+	{
+		return knots[node] > startKnot && knots[node] < endKnot && knots[next[node]] > knots[node];
+	};
+	auto getMultiplicity = [&](int node)
 	{
-		if (MathUtils::IsLessThan(knotVector[i],knotVector[i + 1]))
+		int s = 1;
+		for (int k = previous[node]; k != -1 && knots[k] == knots[node]; k = previous[k])
 		{
-			Br[i] = ComputerRemoveKnotErrorBound(curve, i);
-			S[i] = Polynomials::GetKnotMultiplicity(knotVector, knotVector[i]);
-			s = 1;
-		}
-		else {
-			Br[i] = Constants::MaxDistance;
-			S[i] = 1;
 			s++;
 		}
-	}
-
-	Nl[0] = 0;
-	for (int i = 0; i < ukSize; i++)
+		return s;
+	};
+	// Copy the knots and control points read by A5.8 and A9.8 around node into local vectors,
+	// both indexed from the node start, and return the local index of node.
+	auto gather = [&](int node, int s, int& start, std::vector<double>& localKnots, std::vector<XYZW>& localPoints)
 	{
-		int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, uk[i]);
-		if (!Nl[spanIndex])
+		int r = 0;
+		start = node;
+		while (r < 2 * degree + 1 && previous[start] != -1)
 		{
-			Nl[spanIndex] = i;
+			start = previous[start];
+			r++;
 		}
-		if (i + 1 < ukSize)
+		localKnots.clear();
+		for (int k = start, i = 0; k != -1 && i <= r + 2 * degree; k = next[k], i++)
 		{
-			Nr[spanIndex] = i + 1;
+			localKnots.emplace_back(knots[k]);
 		}
-	}
-
-	std::vector<double> tempU = knotVector;
-	std::vector<XYZW> tempCP = controlPoints;
-
-	std::vector<double> updatedKnotVector;
-	std::vector<XYZW> updatedControlPoints;
+		localPoints.clear();
+		int k = start;
+		for (int i = 0; i <= degree; i++)
+		{
+			k = next[k];
+		}
+		for (int i = 0; i <= r - s + 1; i++, k = next[k])
+		{
+			localPoints.emplace_back(points[k]);
+		}
+		return r;
+	};
 
-	while (1)
+	// Candidates are popped by smallest bound. A queued entry is stale once the stamp of its node has changed.
+	typedef std::tuple<double, int, int> Candidate;
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+	std::vector<int> stamps(size, 0);
 	{
-		double minStandard = Constants::MaxDistance;
-		for (int i = 0; i < Br.size(); i++)
+		std::vector<double> bounds(size, Constants::MaxDistance);
+		ThreadUtils::ParallelFor(degree + 1, size - degree - 1, [&](int i)
+			{
+				if (isCandidate(i))
+				{
+					bounds[i] = GetRemoveKnotErrorBound(degree, knotVector, controlPoints, i, getMultiplicity(i));
+				}
+			}, 256);
+		for (int i = degree + 1; i < size - degree - 1; i++)
 		{
-			if (MathUtils::IsLessThan(Br[i],minStandard))
+			if (isCandidate(i))
 			{
-				BrMinIndex = i;
-				minStandard = Br[i];
+				queue.emplace(bounds[i], i, 0);
 			}
 		}
-		BrMin = Br[BrMinIndex];
+	}
+
+	std::vector<double> localKnots;
+	std::vector<XYZW> localPoints;
+	std::vector<double> temp(ukSize);
+	while (!queue.empty() && controlPointsCount > degree + 1)
+	{
+		double Br = std::get<0>(queue.top());
+		int node = std::get<1>(queue.top());
+		int stamp = std::get<2>(queue.top());
+		queue.pop();
+		if (stamp != stamps[node]) continue;
+		stamps[node]++;
+
+		int s = getMultiplicity(node);
+		int start = 0;
+		int r = gather(node, s, start, localKnots, localPoints);
 
-		if (BrMin == Constants::MaxDistance)
+		// Removal changes the curve by a multiple of one basis function, only points in its support are affected.
+		int basisIndex;
+		double factor;
+		if ((degree + s) % 2)
 		{
-			updatedKnotVector = tempU;
-			updatedControlPoints = tempCP;
-			break;
+			int k = (degree + s + 1) / 2;
+			double a = (localKnots[r] - localKnots[r - k + 1]) / (localKnots[r - k + degree + 2] - localKnots[r - k + 1]);
+			basisIndex = r - k + 1;
+			factor = (1.0 - a) * Br;
 		}
-		r = BrMinIndex;
-		s = S[BrMinIndex];
-
-		Rstart = std::max(r - degree, degree + 1);
-		Rend = std::min(r + degree - S[r + degree] + 1, n);
-		Rstart = Nl[Rstart];
-		Rend = Nr[Rend];
+		else
+		{
+			basisIndex = r - (degree + s) / 2;
+			factor = Br;
+		}
+		auto supportStart = localKnots.begin() + basisIndex;
+		int first = std::lower_bound(uk.begin(), uk.end(), *supportStart) - uk.begin();
+		int last = std::upper_bound(uk.begin(), uk.end(), *(supportStart + degree + 1)) - uk.begin();
 
+		// The support holds only a few points, so a serial loop beats starting threads per candidate.
 		bool removable = true;
-		for (i = Rstart; i <= Rend; i++)
+		for (int i = first; i < last; i++)
 		{
-			double a;
-			s = S[r];
-			if ((degree + s) % 2)
-			{
-				u = uk[i];
-				k = (degree + s + 1) / 2;
-				a = tempU[r] - tempU[r - k + 1];
-				a /= tempU[r - k + degree + 2] - tempU[r - k + 1];
-				NewError[i] = (1.0 - a) * Br[r] * Polynomials::OneBasisFunction(r - k + 1, degree, tempU, u);
-			}
-			else
+			// Interior knots keep the basis function continuous, so it is evaluated from the left
+			// and vanishes at the start of its support.
+			int spanIndex = static_cast<int>(std::lower_bound(supportStart, supportStart + degree + 2, uk[i]) - localKnots.begin()) - 1;
+			temp[i] = errors[i];
+			if (spanIndex >= basisIndex)
 			{
-				u = uk[i];
-				k = (degree + s) / 2;
-				NewError[i] = Br[r] * Polynomials::OneBasisFunction(r - k, degree, tempU, u);
+				double N[Constants::NURBSMaxDegree + 1];
+				Polynomials::BasisFunctions(spanIndex, degree, localKnots, uk[i], N);
+				temp[i] += factor * N[basisIndex - spanIndex + degree];
 			}
-			temp[i] = NewError[i] + errors[i];
-			if (MathUtils::IsGreaterThan(temp[i],maxError))
+			if (temp[i] > maxError)
 			{
 				removable = false;
-				Br[r] = Constants::MaxDistance;
-				updatedKnotVector = tempU;
-				updatedControlPoints = tempCP;
 				break;
 			}
 		}
+		if (!removable) continue;
 
-		if (removable)
-		{
-			LN_NurbsCurve tc;
-			tc.Degree = degree;
-			tc.KnotVector = tempU;
-			tc.ControlPoints = tempCP;
-
-			LN_NurbsCurve newtc;
-			RemoveKnot(tc, tempU[r], 1, newtc);
-			std::vector<double> tempNewU = newtc.KnotVector;
-			std::vector<XYZW> tempNewCP = newtc.ControlPoints;
+		std::copy(temp.begin() + first, temp.begin() + last, errors.begin() + first);
+		RemoveKnotOnce(degree, localKnots, localPoints, r, s);
 
-			controlPointsSize = tempNewCP.size();
-			for (int i = Rstart; i <= Rend; i++)
-			{
-				errors[i] = temp[i];
-			}
-
-			if (controlPointsSize <= degree + 1)
-			{
-				updatedKnotVector = tempU;
-				updatedControlPoints = tempCP;
-				break;
-			}
-
-			Rstart = Nl[r - degree - 1];
-			Rend = Nr[r - S[r]];
-			int spanIndex = 0;
-			int oldspanIndex = -1;
-			for (int k = Rstart; k <= Rend; k++)
-			{
-				spanIndex = Polynomials::GetKnotSpanIndex(degree, tempNewU, uk[k]);
-				if (spanIndex != oldspanIndex)
-				{
-					Nl[spanIndex] = k;
-				}
-				if (k + 1 < ukSize)
-				{
-					Nr[spanIndex] = k + 1;
-				}
-				oldspanIndex = spanIndex;
-			}
-			for (int k = r - S[r] + 1; k < Nl.size() - 1; k++) {
-				Nl[k] = Nl[k + 1];
-				Nr[k] = Nr[k + 1];
-			}
-			Nl.resize(Nl.size() - 1);
-			Nr.resize(Nr.size() - 1);
+		int before = previous[node];
+		int after = next[node];
+		next[before] = after;
+		previous[after] = before;
+		controlPointsCount--;
 
-			Rstart = std::max(r - degree, degree + 1);
-			Rend = std::min(r + degree - S[r] + 1, controlPointsSize);
-			s = S[Rstart];
-			for (i = Rstart; i <= Rend; i++)
-			{
-				if (MathUtils::IsLessThan(tempNewU[i],tempNewU[i + 1]))
-				{
-					Br[i] = ComputerRemoveKnotErrorBound(newtc, i);
-					S[i] = s;
-					s = 1;
-				}
-				else {
-					Br[i] = Constants::MaxDistance;
-					S[i] = 1;
-					s++;
-				}
-			}
-			for (int i = Rend + 1; i < Br.size() - 1; i++)
-			{
-				Br[i] = Br[i + 1];
-				S[i] = S[i + 1];
-			}
-			Br.resize(Br.size() - 1);
+		int k = start;
+		for (int i = 0; i <= degree; i++)
+		{
+			k = next[k];
+		}
+		for (const XYZW& point : localPoints)
+		{
+			points[k] = point;
+			k = next[k];
+		}
 
-			tempU = tempNewU;
-			tempCP = tempNewCP;
+		// Only knots whose removal reads the changed control points get new bounds.
+		k = before;
+		for (int i = 0; i < degree && previous[k] != -1; i++)
+		{
+			k = previous[k];
 		}
-		else
+		for (int i = 0; i < 2 * degree + 3 && k != -1; i++, k = next[k])
+		{
+			if (!isCandidate(k)) continue;
+			int ks = getMultiplicity(k);
+			int kStart = 0;
+			int kr = gather(k, ks, kStart, localKnots, localPoints);
+			stamps[k]++;
+			queue.emplace(GetRemoveKnotErrorBound(degree, localKnots, localPoints, kr, ks), k, stamps[k]);
+		}
+	}
+
+	std::vector<double> updatedKnotVector;
+	std::vector<XYZW> updatedControlPoints;
+	for (int k = 0, i = 0; k != -1; k = next[k], i++)
+	{
+		updatedKnotVector.emplace_back(knots[k]);
+		if (i > degree)
 		{
-			Br[r] = Constants::MaxDistance;
+			updatedControlPoints.emplace_back(points[k]);
 		}
 	}
 
@@ -2729,8 +3301,11 @@ void LNLib::NurbsCurve::GlobalApproximationByErrorBound(int degree, const std::v
 	tc.KnotVector = knotVector;
 	tc.ControlPoints = controlPoints;
 
-	LN_NurbsCurve newtc;
-	ElevateDegree(tc, degree - 1, newtc);
+	LN_NurbsCurve newtc = tc;
+	if (degree > 1)
+	{
+		ElevateDegree(tc, degree - 1, newtc);
+	}
 	RemoveKnotsByGivenBound(newtc, uk, errors, maxError, result);
 }
 
@@ -3112,8 +3687,8 @@ bool LNLib::NurbsCurve::NeighborWeightsModification(const LN_NurbsCurve& curve,
 	double abk = D.Distance(movePoint2) / controlLegLength;
 	double abk1 = C.Distance(movePoint1) / controlLegLength;
 
-	if (MathUtils::IsLessThan(abs(ak), 0.0) || MathUtils::IsLessThan(abs(ak1), 0.0) ||
-		MathUtils::IsLessThan(abs(abk), 0.0) || MathUtils::IsLessThan(abs(abk1), 0.0))
+	if (MathUtils::IsLessThan(std::abs(ak), 0.0) || MathUtils::IsLessThan(std::abs(ak1), 0.0) ||
+		MathUtils::IsLessThan(std::abs(abk), 0.0) || MathUtils::IsLessThan(std::abs(abk1), 0.0))
 	{
 		return false;
 	}
@@ -3157,7 +3732,7 @@ void LNLib::NurbsCurve::Warping(const LN_NurbsCurve& curve, const std::vector<do
 	{
 		double weight = temp[i].GetW();
 		XYZ currentPoint = temp[i].ToXYZ(true);
-		XYZ newPoint = currentPoint + warpShape[i] * abs(warpDistance) * W.Normalize();
+		XYZ newPoint = currentPoint + warpShape[i] * std::abs(warpDistance) * W.Normalize();
 		resultControlPoints.emplace_back(XYZW(newPoint, weight));
 	}
 	
@@ -3265,14 +3840,14 @@ void LNLib::NurbsCurve::ConstraintBasedModification(const LN_NurbsCurve& curve,
 	std::vector<int> Dk = appliedDegree;
 
 	int size = controlPoints.size();
-	std::vector<std::vector<double>> B(D.size(), std::vector<double>(size));
+	MatrixXd B(D.size(), size);
 	for (int i = 0; i < D.size(); i++)
 	{
 		int spanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, ur[Dr[i]]);
 		std::vector<std::vector<double>> ders = Polynomials::BasisFunctionsDerivatives(spanIndex, degree, Dk[i], knotVector, ur[Dr[i]]);
 		for (int j = 0; j <= degree; j++)
 		{
-			B[i][spanIndex - degree + j] = ders[Dk[i]][j];
+			B(i, spanIndex - degree + j) = ders[Dk[i]][j];
 		}
 	}
 
@@ -3283,7 +3858,7 @@ void LNLib::NurbsCurve::ConstraintBasedModification(const LN_NurbsCurve& curve,
 	{
 		for (int i = 0; i < D.size(); i++)
 		{
-			if (MathUtils::IsGreaterThan(B[i][j] * B[i][j], 0.0))
+			if (MathUtils::IsGreaterThan(B(i, j) * B(i, j), 0.0))
 			{
 				remove[j] = 0;
 				break;
@@ -3308,40 +3883,36 @@ void LNLib::NurbsCurve::ConstraintBasedModification(const LN_NurbsCurve& curve,
 
 	map.resize(n);
 
-	std::vector<std::vector<double>> Bopt(D.size(), std::vector<double>(n));
+	MatrixXd Bopt(D.size(), n);
 	for (int j = 0; j < n; j++)
 	{
-		for (int i = 0; i < B.size(); i++)
+		for (int i = 0; i < B.GetRowCount(); i++)
 		{
-			Bopt[i][j] = B[i][map[j]];
+			Bopt(i, j) = B(i, map[j]);
 		}
 	}
 
-	std::vector<std::vector<double>> Bt;
-	MathUtils::Transpose(Bopt, Bt);
-	std::vector<std::vector<double>> BoptBt = MathUtils::MatrixMultiply(Bopt, Bt);
-	std::vector<std::vector<double>> BBt;
-	MathUtils::MakeInverse(BoptBt, BBt);
-
-	auto A = MathUtils::MatrixMultiply(Bt, BBt);
-	std::vector<std::vector<double>> dD(D.size(), std::vector<double>(3));
+	MatrixXd dD(D.size(), 3);
 	for (int i = 0; i < D.size(); i++)
 	{
 		for (int j = 0; j < 3; j++)
 		{
-			dD[i][j] = D[i][j];
+			dD(i, j) = D[i][j];
 		}
 	}
 
-	auto dP = MathUtils::MatrixMultiply(A, dD);
+	// dP = Bt * inv(Bopt * Bt) * dD, solving instead of inverting.
+	MatrixXd Bt = Bopt.GetTranspose();
+	MatrixXd BoptBt = MathUtils::MatrixMultiply(Bopt, Bt);
+	MatrixXd dP = MathUtils::MatrixMultiply(Bt, MathUtils::SolveLinearSystem(BoptBt, dD));
 	std::vector<XYZW> updatedControlPoints = controlPoints;
 	for (int i = 0; i < map.size(); i++)
 	{
 		double weight = updatedControlPoints[map[i]].GetW();
 
-		double x = dP[i][0];
-		double y = dP[i][1];
-		double z = dP[i][2];
+		double x = dP(i, 0);
+		double y = dP(i, 1);
+		double z = dP(i, 2);
 
 		double wx = updatedControlPoints[map[i]].GetWX();
 		double wy = updatedControlPoints[map[i]].GetWY();
@@ -3507,12 +4078,10 @@ void LNLib::NurbsCurve::ToUnclampCurve(const LN_NurbsCurve& curve, LN_NurbsCurve
 bool LNLib::NurbsCurve::IsClamp(const LN_NurbsCurve& curve)
 {
 	int degree = curve.Degree;
-	std::vector<double> knotVector = curve.KnotVector;
-	double first = knotVector[0];
-	double end = knotVector[knotVector.size() - 1];
 
-	int f = Polynomials::GetKnotMultiplicity(knotVector, first);
-	int e = Polynomials::GetKnotMultiplicity(knotVector, end);
+	const std::vector<double>& knotVector = curve.KnotVector;
+	int f = Polynomials::GetKnotMultiplicity(knotVector, knotVector.front());
+	int e = Polynomials::GetKnotMultiplicity(knotVector, knotVector.back());
 	if (f == degree + 1 && e == degree + 1)
 	{
 		return true;
@@ -3544,10 +4113,11 @@ bool LNLib::NurbsCurve::IsLinear(const LN_NurbsCurve& curve)
 		}
 	}
 
-	auto map = KnotVectorUtils::GetInternalKnotMultiplicityMap(knotVector);
-	for (auto it = map.begin(); it != map.end(); it++)
+	LN_KnotStructure structure;
+	KnotVectorUtils::CreateKnotStructure(degree, knotVector, structure);
+	for (int i = 1; i < static_cast<int>(structure.Knots.size()) - 1; i++)
 	{
-		double u = it->first;
+		double u = structure.Knots[i];
 		XYZ cp = GetPointOnCurve(curve, u);
 		XYZ cp2s = (cp - start).Normalize();
 		XYZ cp2e = (cp - end).Normalize();
@@ -3613,18 +4183,15 @@ double LNLib::NurbsCurve::ApproximateLength(const LN_NurbsCurve& curve, Integrat
 {
 	if (IsLinear(curve))
 	{
-		std::vector<XYZW> controlPoints = curve.ControlPoints;
+		const std::vector<XYZW>& controlPoints = curve.ControlPoints;
 		XYZ startPoint = controlPoints[0].ToXYZ(true);
 		XYZ endPoint = controlPoints[controlPoints.size() - 1].ToXYZ(true);
 		return startPoint.Distance(endPoint);
 	}
 
-	LN_NurbsCurve reCurve;
-	Reparametrize(curve, 0.0, 1.0, reCurve);
-
-	int degree = reCurve.Degree;
-	std::vector<double> knotVector = reCurve.KnotVector;
-	std::vector<XYZW> controlPoints = reCurve.ControlPoints;
+	int degree = curve.Degree;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	int n = static_cast<int>(curve.ControlPoints.size()) - 1;
 
 	double length = 0.0;
 	switch (type)
@@ -3633,9 +4200,7 @@ double LNLib::NurbsCurve::ApproximateLength(const LN_NurbsCurve& curve, Integrat
 		{
 			double start = knotVector[0];
 			double end = knotVector[knotVector.size() - 1];
-			FirstDerivativeLengthFunction function;
-			double simpson = Integrator::Simpson(function, (void*)&reCurve, start, end);
-			length = CalculateLengthBySimpson(function, reCurve, start, end, simpson, Constants::DistanceEpsilon);
+			length = Integrator::AdaptiveSimpson([&curve](double t) { return GetFirstDerivativeLength(curve, t); }, start, end);
 			break;
 		}
 		case IntegratorType::GaussLegendre:
@@ -3643,101 +4208,151 @@ double LNLib::NurbsCurve::ApproximateLength(const LN_NurbsCurve& curve, Integrat
 			// Strongly recommend read this blog:
 			// https://raphlinus.github.io/curves/2018/12/28/bezier-arclength.html
 
-			std::vector<LN_NurbsCurve> bezierCurves =  DecomposeToBeziers(reCurve);
+			std::vector<LN_NurbsCurve> bezierCurves =  DecomposeToBeziers(curve);
 			for (int i = 0; i < bezierCurves.size(); i++)
 			{
-				LN_NurbsCurve bezierCurve = bezierCurves[i];
-
-				std::vector<double> bKnots = bezierCurve.KnotVector;
-				double a = bKnots[0];
-				double b = bKnots[bKnots.size() - 1];
-				double coefficient = (b - a) / 2.0;
-
-				double bLength = 0.0;
-				std::vector<double> abscissae = Integrator::GaussLegendreAbscissae;
-				int size = abscissae.size();
-				for (int i = 0; i < size; i++)
-				{
-					double t = coefficient * abscissae[i] + (a + b)/2.0;
-					double derLength = ComputeRationalCurveDerivatives(bezierCurve, 1, t)[1].Length();
-					if (std::isnan(derLength))
-						derLength = 0.0;
-					bLength += Integrator::GaussLegendreWeights[i] * derLength;
-				}
-				bLength = coefficient * bLength;
-				length += bLength;
+				const LN_NurbsCurve& bezierCurve = bezierCurves[i];
+				const std::vector<double>& bKnots = bezierCurve.KnotVector;
+				length += GetLengthByGaussLegendre(bezierCurve, bKnots[0], bKnots[bKnots.size() - 1]);
 			}
 			break;
 		}
 		case IntegratorType::Chebyshev:
 		{
-			std::vector<double> series = Integrator::ChebyshevSeries();
-			for (int i = degree; i < controlPoints.size(); i++) 
+			const std::vector<double>& series = Integrator::GetChebyshevSeries();
+			auto function = [&curve](double t) { return GetFirstDerivativeLength(curve, t); };
+			for (int i = degree; i <= n; i++) 
 			{
-				double a = knotVector[i];
-				double b = knotVector[i + 1];
-				FirstDerivativeLengthFunction function;
-				length += Integrator::ClenshawCurtisQuadrature(function, (void*)&reCurve, a, b, series);
+				length += Integrator::ClenshawCurtis(function, knotVector[i], knotVector[i + 1], series);
 			}
 			break;
 		}
+		case IntegratorType::GaussKronrod:
+		{
+			double error = 0.0;
+			length = ApproximateLength(curve, Constants::DistanceEpsilon, error);
+			break;
+		}
 		default:
 			 break;
 	}
 	return length;
 }
 
-double LNLib::NurbsCurve::GetParamOnCurve(const LN_NurbsCurve& curve, double givenLength, IntegratorType type)
+double LNLib::NurbsCurve::ApproximateLength(const LN_CurveView& view, IntegratorType type)
 {
-	std::vector<double> knotVector = curve.KnotVector;
-	double start = knotVector[0];
-	double end = knotVector[knotVector.size() - 1];
+	return ApproximateLength(*view.Curve, type);
+}
+
+double LNLib::NurbsCurve::ApproximateLength(const LN_NurbsCurve& curve, double tolerance, double& error)
+{
+	VALIDATE_ARGUMENT(tolerance > 0.0, "tolerance", "Tolerance must be greater than zero.");
 
-	double totalLength = ApproximateLength(curve, type);
-	if (MathUtils::IsLessThan(totalLength, givenLength, Constants::DistanceEpsilon))
+	error = 0.0;
+	if (IsLinear(curve))
 	{
-		return end;
+		const std::vector<XYZW>& controlPoints = curve.ControlPoints;
+		return controlPoints[0].ToXYZ(true).Distance(controlPoints[controlPoints.size() - 1].ToXYZ(true));
 	}
 
-	for (int i = 0; i < knotVector.size(); i++)
+	std::vector<LN_NurbsCurve> bezierCurves = DecomposeToBeziers(curve);
+	double segmentTolerance = tolerance / bezierCurves.size();
+
+	double length = 0.0;
+	for (int i = 0; i < bezierCurves.size(); i++)
 	{
-		LN_NurbsCurve left;
-		LN_NurbsCurve right;
-		double knot = knotVector[i];
-		bool isSplited = SplitAt(curve, knot, left, right);
-		if (!isSplited) continue;
-		double length = ApproximateLength(left, type);
-		if (MathUtils::IsAlmostEqualTo(length, givenLength))
-		{
-			return knot;
-		}
-		if (MathUtils::IsGreaterThan(length, givenLength))
-		{
-			end = knot;
-			break;
-		}
+		const LN_NurbsCurve& bezierCurve = bezierCurves[i];
+		const std::vector<double>& bKnots = bezierCurve.KnotVector;
+
+		double segmentError = 0.0;
+		length += Integrator::GaussKronrod([&bezierCurve](double t) { return GetFirstDerivativeLength(bezierCurve, t); }, bKnots[0], bKnots[bKnots.size() - 1], segmentTolerance, segmentError);
+		error += segmentError;
 	}
-	double param = GetParamByLength(curve, start, end, givenLength, type);
-	return param;
+	return length;
+}
+
+double LNLib::NurbsCurve::GetParamOnCurve(const LN_NurbsCurve& curve, double givenLength, IntegratorType type)
+{
+	LN_ArcLengthTable table;
+	CreateArcLengthTable(curve, table, type);
+	return GetParamOnCurve(table, givenLength);
 }
 
 std::vector<double> LNLib::NurbsCurve::GetParamsOnCurve(const LN_NurbsCurve& curve, double givenLength, IntegratorType type)
 {
-	std::vector<double> result;
+	LN_ArcLengthTable table;
+	CreateArcLengthTable(curve, table, type);
+	return GetParamsOnCurve(table, givenLength);
+}
 
-	std::vector<double> knotVector = curve.KnotVector;
-	double end = knotVector[knotVector.size() - 1];
-	
-	double param = GetParamOnCurve(curve, givenLength, type);
-	while (!MathUtils::IsAlmostEqualTo(param, end))
+void LNLib::NurbsCurve::CreateArcLengthTable(const LN_NurbsCurve& curve, LN_ArcLengthTable& table, IntegratorType type)
+{
+	int degree = curve.Degree;
+	const std::vector<double>& knotVector = curve.KnotVector;
+	int n = static_cast<int>(curve.ControlPoints.size()) - 1;
+
+	table.Curve = curve;
+	table.Params.clear();
+	table.Lengths.clear();
+	table.Params.emplace_back(knotVector[degree]);
+	table.Lengths.emplace_back(0.0);
+
+	double length = 0.0;
+	for (int i = degree; i <= n; i++)
 	{
-		result.emplace_back(param);
+		double a = knotVector[i];
+		double b = knotVector[i + 1];
+		if (MathUtils::IsAlmostEqualTo(a, b)) continue;
 
-		LN_NurbsCurve left;
-		LN_NurbsCurve right;
-		bool isSplited = SplitAt(curve, param, left, right);
-		if (!isSplited) continue;
-		param = GetParamOnCurve(right, givenLength, type);
+		length += GetSpanLength(curve, a, b, type);
+		table.Params.emplace_back(b);
+		table.Lengths.emplace_back(length);
+	}
+}
+
+double LNLib::NurbsCurve::GetParamOnCurve(const LN_ArcLengthTable& table, double givenLength)
+{
+	VALIDATE_ARGUMENT(table.Params.size() > 1, "table", "Table must be created by CreateArcLengthTable.");
+
+	const std::vector<double>& lengths = table.Lengths;
+	if (MathUtils::IsLessThanOrEqual(givenLength, 0.0))
+	{
+		return table.Params[0];
+	}
+	if (MathUtils::IsLessThan(lengths.back(), givenLength, Constants::DistanceEpsilon))
+	{
+		return table.Params.back();
+	}
+
+	int spanIndex = static_cast<int>(std::upper_bound(lengths.begin(), lengths.end(), givenLength) - lengths.begin()) - 1;
+	spanIndex = std::max(0, std::min(spanIndex, static_cast<int>(lengths.size()) - 2));
+	return GetParamByLength(table, spanIndex, givenLength);
+}
+
+std::vector<double> LNLib::NurbsCurve::GetParamsOnCurve(const LN_ArcLengthTable& table, double givenLength)
+{
+	VALIDATE_ARGUMENT(table.Params.size() > 1, "table", "Table must be created by CreateArcLengthTable.");
+	VALIDATE_ARGUMENT(givenLength > 0.0, "givenLength", "Given length must be greater than zero.");
+
+	std::vector<double> result;
+
+	const std::vector<double>& lengths = table.Lengths;
+	double totalLength = lengths.back();
+	int lastSpan = static_cast<int>(lengths.size()) - 2;
+
+	int spanIndex = 0;
+	for (int i = 1; ; i++)
+	{
+		double length = i * givenLength;
+		if (!MathUtils::IsLessThan(length, totalLength, Constants::DistanceEpsilon))
+		{
+			break;
+		}
+		while (spanIndex < lastSpan && lengths[spanIndex + 1] < length)
+		{
+			spanIndex++;
+		}
+		result.emplace_back(GetParamByLength(table, spanIndex, length));
 	}
 	return result;
 }
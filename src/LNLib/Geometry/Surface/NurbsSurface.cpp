@@ -25,55 +25,457 @@
 #include "ControlPointsUtils.h"
 #include "Voronoi.h"
 #include "Integrator.h"
+#include "ThreadUtils.h"
 #include "LNLibExceptions.h"
 #include "LNObject.h"
 
 #include <random>
+#include <atomic>
 #include <algorithm>
 #include <cmath>
 
 namespace LNLib
 {
-	struct AreaData
-	{
-		const LN_NurbsSurface& Surface;
-		double ParameterV;
-		double CurrentKnotU;
-		double NextKnotU;
-		double CurrentKnotV;
-		double NextKnotV;
-		const std::vector<double>& Series;
-
-		AreaData(const LN_NurbsSurface& surface, const std::vector<double>& series) :
-			Surface(surface), Series(series), ParameterV(0.0), CurrentKnotU(0.0), NextKnotU(1.0) {}
-	};
-	class AreaCoreFunction : public IntegrationFunction
+	double GetAreaElement(const LN_NurbsSurface& surface, double u, double v)
+	{
+		XYZ S, Su, Sv;
+		NurbsSurface::ComputeRationalSurfaceFirstOrderDerivative(surface, UV(u, v), S, Su, Sv);
+		double E = Su.DotProduct(Su);
+		double F = Su.DotProduct(Sv);
+		double G = Sv.DotProduct(Sv);
+		return std::sqrt(E * G - F * F);
+	}
+
+	/// <summary>
+	/// Bernstein basis of degree at paramT in [0, 1] and its derivatives, computed on the stack.
+	/// </summary>
+	void GetBernsteinAndDerivatives(int degree, double paramT, double* basis, double* derivatives)
 	{
-		double operator()(double parameter, void* customData)
+		if (degree == 0)
 		{
-			AreaData* data = (AreaData*)customData;
-			std::vector<std::vector<XYZ>> derivatives = NurbsSurface::ComputeRationalSurfaceDerivatives(data->Surface, 1, UV(parameter, data->ParameterV));
-			XYZ Su = derivatives[1][0];
-			XYZ Sv = derivatives[0][1];
-			double E = Su.DotProduct(Su);
-			double F = Su.DotProduct(Sv);
-			double G = Sv.DotProduct(Sv);
-			double ds = std::sqrt(E * G - F * F);
-			return ds;
+			basis[0] = 1.0;
+			derivatives[0] = 0.0;
+			return;
 		}
-	};
-	class AreaWrapperFunction : public IntegrationFunction
+
+		// Basis of degree - 1 by A1.3, then raised one degree while differentiating.
+		double lower[Constants::NURBSMaxDegree + 1];
+		lower[0] = 1.0;
+		double t1 = 1.0 - paramT;
+		for (int j = 1; j < degree; j++)
+		{
+			double saved = 0.0;
+			for (int k = 0; k < j; k++)
+			{
+				double temp = lower[k];
+				lower[k] = saved + t1 * temp;
+				saved = paramT * temp;
+			}
+			lower[j] = saved;
+		}
+		for (int i = 0; i <= degree; i++)
+		{
+			double left = i > 0 ? lower[i - 1] : 0.0;
+			double right = i < degree ? lower[i] : 0.0;
+			basis[i] = paramT * left + t1 * right;
+			derivatives[i] = degree * (left - right);
+		}
+	}
+
+	/// <summary>
+	/// Point and first partial derivatives of patch (i, j) of patches at (u, v) inside [ParamsU[i], ParamsU[i + 1]] x [ParamsV[j], ParamsV[j + 1]],
+	/// evaluated straight from the flat control point buffer.
+	/// </summary>
+	void ComputeBezierPatchFirstOrderDerivative(const LN_BezierPatches& patches, int i, int j, double u, double v, XYZ& S, XYZ& Su, XYZ& Sv)
 	{
-		double operator()(double parameter, void* customData)
+		int degreeU = patches.DegreeU;
+		int degreeV = patches.DegreeV;
+		double lengthU = patches.ParamsU[i + 1] - patches.ParamsU[i];
+		double lengthV = patches.ParamsV[j + 1] - patches.ParamsV[j];
+
+		double Nu[Constants::NURBSMaxDegree + 1];
+		double dNu[Constants::NURBSMaxDegree + 1];
+		double Nv[Constants::NURBSMaxDegree + 1];
+		double dNv[Constants::NURBSMaxDegree + 1];
+		GetBernsteinAndDerivatives(degreeU, (u - patches.ParamsU[i]) / lengthU, Nu, dNu);
+		GetBernsteinAndDerivatives(degreeV, (v - patches.ParamsV[j]) / lengthV, Nv, dNv);
+
+		int patchSize = (degreeU + 1) * (degreeV + 1);
+		const XYZW* controlPoints = patches.ControlPoints.data() + (i * patches.SpansV.size() + j) * patchSize;
+
+		XYZW Aw, Awu, Awv;
+		for (int k = 0; k <= degreeU; k++)
+		{
+			XYZW row, rowv;
+			for (int l = 0; l <= degreeV; l++)
+			{
+				const XYZW& Pw = controlPoints[k * (degreeV + 1) + l];
+				row += Nv[l] * Pw;
+				rowv += dNv[l] * Pw;
+			}
+			Aw += Nu[k] * row;
+			Awu += dNu[k] * row;
+			Awv += Nu[k] * rowv;
+		}
+		Awu = Awu / lengthU;
+		Awv = Awv / lengthV;
+
+		double w = Aw.GetW();
+		S = Aw.ToXYZ(true);
+		Su = (Awu.ToXYZ(false) - Awu.GetW() * S) / w;
+		Sv = (Awv.ToXYZ(false) - Awv.GetW() * S) / w;
+	}
+
+	double GetBezierPatchAreaElement(const LN_BezierPatches& patches, int i, int j, double u, double v)
+	{
+		XYZ S, Su, Sv;
+		ComputeBezierPatchFirstOrderDerivative(patches, i, j, u, v, S, Su, Sv);
+		double E = Su.DotProduct(Su);
+		double F = Su.DotProduct(Sv);
+		double G = Sv.DotProduct(Sv);
+		return std::sqrt(E * G - F * F);
+	}
+
+	const int MassIntegralsSize = 11;
+
+	/// <summary>
+	/// Surface integrals of one patch giving, by the divergence theorem, the volume integrals
+	/// { area, V, Sx, Sy, Sz, Sxx, Syy, Szz, Sxy, Syz, Szx } of the region bounded by outward oriented patches.
+	/// </summary>
+	std::vector<double> GetMassIntegrals(const LN_BezierPatches& patches, int i, int j)
+	{
+		double a = patches.ParamsU[i];
+		double b = patches.ParamsU[i + 1];
+		double c = patches.ParamsV[j];
+		double d = patches.ParamsV[j + 1];
+		double coefficientU = (b - a) / 2.0;
+		double coefficientV = (d - c) / 2.0;
+
+		std::vector<double> integrals(MassIntegralsSize, 0.0);
+		const std::vector<double>& abscissae = Integrator::GaussLegendreAbscissae;
+		const std::vector<double>& weights = Integrator::GaussLegendreWeights;
+		for (int k = 0; k < abscissae.size(); k++)
 		{
-			static std::vector<double> series;
-			AreaCoreFunction areaCoreFunction;
-			AreaData* data = (AreaData*)customData;
-			data->ParameterV = parameter;
-			return Integrator::ClenshawCurtisQuadrature2(areaCoreFunction, data, data->CurrentKnotU, data->NextKnotU, data->Series);
+			double u = coefficientU * abscissae[k] + (a + b) / 2.0;
+			for (int l = 0; l < abscissae.size(); l++)
+			{
+				double v = coefficientV * abscissae[l] + (c + d) / 2.0;
+				XYZ S, Su, Sv;
+				ComputeBezierPatchFirstOrderDerivative(patches, i, j, u, v, S, Su, Sv);
+				XYZ N = Su.CrossProduct(Sv);
+
+				double x = S.GetX();
+				double y = S.GetY();
+				double z = S.GetZ();
+				double nx = N.GetX();
+				double ny = N.GetY();
+				double nz = N.GetZ();
+
+				double w = weights[k] * weights[l];
+				integrals[0] += w * N.Length();
+				integrals[1] += w * S.DotProduct(N) / 3.0;
+				integrals[2] += w * x * x * nx / 2.0;
+				integrals[3] += w * y * y * ny / 2.0;
+				integrals[4] += w * z * z * nz / 2.0;
+				integrals[5] += w * x * x * x * nx / 3.0;
+				integrals[6] += w * y * y * y * ny / 3.0;
+				integrals[7] += w * z * z * z * nz / 3.0;
+				integrals[8] += w * x * x * y * nx / 2.0;
+				integrals[9] += w * y * y * z * ny / 2.0;
+				integrals[10] += w * z * z * x * nz / 2.0;
+			}
+		}
+
+		double scale = coefficientU * coefficientV;
+		for (int k = 0; k < MassIntegralsSize; k++)
+		{
+			integrals[k] *= scale;
 		}
+		return integrals;
+	}
+
+	/// <summary>
+	/// Banded LU factors of the interpolation matrix at params,
+	/// shared by every set of points interpolated with the same degree, knot vector and params.
+	/// </summary>
+	struct InterpolationFactors
+	{
+		MatrixXd LU;
+		int Lower = 0;
+		int Upper = 0;
+		std::vector<int> Pivots;
 	};
 
+	void FactorInterpolation(int degree, const std::vector<double>& knotVector, const std::vector<double>& params, InterpolationFactors& factors)
+	{
+		VALIDATE_ARGUMENT(params.size() > degree, "throughPoints", "ThroughPoints size must be greater than degree.");
+		VALIDATE_ARGUMENT(ValidationUtils::IsValidKnotVector(params), "params", "Params must be a nondecreasing sequence of real numbers.");
+
+		Interpolation::ComputeInterpolationMatrix(degree, knotVector, params, factors.LU, factors.Lower, factors.Upper);
+		bool factored = MathUtils::BandedLUDecomposition(factors.LU, factors.Lower, factors.Upper, factors.Pivots);
+		VALIDATE_ARGUMENT(factored, "throughPoints", "ThroughPoints must have distinct parameters.");
+	}
+
+	/// <summary>
+	/// Solve for every column of points, where points[k][c] is interpolated at the k-th factored param.
+	/// Columns are solved in blocks across threads.
+	/// </summary>
+	std::vector<std::vector<XYZ>> SolveColumns(const InterpolationFactors& factors, const std::vector<std::vector<XYZ>>& points)
+	{
+		int size = points.size();
+		int columns = points[0].size();
+		VALIDATE_ARGUMENT(factors.LU.GetRowCount() == size, "params", "Params size must be equal to throughPoints size.");
+
+		std::vector<std::vector<XYZ>> result(size, std::vector<XYZ>(columns));
+		int blocks = std::min(columns, ThreadUtils::GetThreadCount());
+		int blockSize = (columns + blocks - 1) / blocks;
+		ThreadUtils::ParallelFor(0, blocks, [&](int b)
+			{
+				int first = b * blockSize;
+				int last = std::min(columns, first + blockSize);
+				if (first >= last) return;
+
+				MatrixXd right(size, 3 * (last - first));
+				for (int k = 0; k < size; k++)
+				{
+					for (int c = first; c < last; c++)
+					{
+						for (int j = 0; j < 3; j++)
+						{
+							right(k, 3 * (c - first) + j) = points[k][c][j];
+						}
+					}
+				}
+				MathUtils::BandedLUSolve(factors.LU, factors.Lower, factors.Upper, factors.Pivots, right);
+				for (int k = 0; k < size; k++)
+				{
+					for (int c = first; c < last; c++)
+					{
+						result[k][c] = XYZ(right(k, 3 * (c - first)), right(k, 3 * (c - first) + 1), right(k, 3 * (c - first) + 2));
+					}
+				}
+			});
+		return result;
+	}
+
+	/// <summary>
+	/// Global interpolation of every column of points, where points[k][c] is interpolated at params[k].
+	/// The coefficient matrix is built and factored once for all columns.
+	/// </summary>
+	std::vector<std::vector<XYZ>> InterpolateColumns(int degree, const std::vector<double>& knotVector, const std::vector<double>& params, const std::vector<std::vector<XYZ>>& points)
+	{
+		VALIDATE_ARGUMENT(params.size() == points.size(), "params", "Params size must be equal to throughPoints size.");
+
+		InterpolationFactors factors;
+		FactorInterpolation(degree, knotVector, params, factors);
+		return SolveColumns(factors, points);
+	}
+
+	/// <summary>
+	/// Least squares control points of a surface with fixed knot vectors approximating points at params,
+	/// plus smoothing times the thin plate energy of the control net.
+	/// </summary>
+	bool FitScatteredPoints(const std::vector<XYZ>& points, const std::vector<UV>& params, int degreeU, int degreeV, const std::vector<double>& knotVectorU, const std::vector<double>& knotVectorV, double smoothing, std::vector<std::vector<XYZW>>& controlPoints)
+	{
+		int count = points.size();
+		int rows = knotVectorU.size() - degreeU - 1;
+		int columns = knotVectorV.size() - degreeV - 1;
+		int size = rows * columns;
+
+		// Normal matrix rows are stored as stencils over neighbouring control points,
+		// entry (di, dj) of row k couples control point k with k + di * columns + dj.
+		bool smooth = MathUtils::IsGreaterThan(smoothing, 0.0);
+		int reachU = smooth ? std::max(degreeU, 2) : degreeU;
+		int reachV = smooth ? std::max(degreeV, 2) : degreeV;
+		int widthV = 2 * reachV + 1;
+		int stencil = (2 * reachU + 1) * widthV;
+		auto entry = [&](int k, int di, int dj) { return k * stencil + (di + reachU) * widthV + dj + reachV; };
+
+		int blocks = std::min(count, ThreadUtils::GetThreadCount());
+		int blockSize = (count + blocks - 1) / blocks;
+		std::vector<std::vector<double>> blockMatrices(blocks);
+		std::vector<std::vector<double>> blockRights(blocks);
+		ThreadUtils::ParallelFor(0, blocks, [&](int b)
+			{
+				std::vector<double>& matrix = blockMatrices[b];
+				std::vector<double>& right = blockRights[b];
+				matrix.assign(size * stencil, 0.0);
+				right.assign(3 * size, 0.0);
+
+				int last = std::min(count, (b + 1) * blockSize);
+				for (int p = b * blockSize; p < last; p++)
+				{
+					const UV& uv = params[p];
+					int spanU = Polynomials::GetKnotSpanIndex(degreeU, knotVectorU, uv.GetU());
+					int spanV = Polynomials::GetKnotSpanIndex(degreeV, knotVectorV, uv.GetV());
+					double Nu[Constants::NURBSMaxDegree + 1];
+					double Nv[Constants::NURBSMaxDegree + 1];
+					Polynomials::BasisFunctions(spanU, degreeU, knotVectorU, uv.GetU(), Nu);
+					Polynomials::BasisFunctions(spanV, degreeV, knotVectorV, uv.GetV(), Nv);
+
+					for (int a = 0; a <= degreeU; a++)
+					{
+						for (int c = 0; c <= degreeV; c++)
+						{
+							int k = (spanU - degreeU + a) * columns + spanV - degreeV + c;
+							double w = Nu[a] * Nv[c];
+							for (int j = 0; j < 3; j++)
+							{
+								right[3 * k + j] += w * points[p][j];
+							}
+							for (int a2 = 0; a2 <= degreeU; a2++)
+							{
+								for (int c2 = 0; c2 <= degreeV; c2++)
+								{
+									matrix[entry(k, a2 - a, c2 - c)] += w * Nu[a2] * Nv[c2];
+								}
+							}
+						}
+					}
+				}
+			});
+
+		std::vector<double> matrix = std::move(blockMatrices[0]);
+		std::vector<double> right = std::move(blockRights[0]);
+		for (int b = 1; b < blocks; b++)
+		{
+			for (int i = 0; i < matrix.size(); i++)
+			{
+				matrix[i] += blockMatrices[b][i];
+			}
+			for (int i = 0; i < right.size(); i++)
+			{
+				right[i] += blockRights[b][i];
+			}
+		}
+
+		if (smooth)
+		{
+			// Thin plate energy of the control net: squared second differences along u and v,
+			// and twice the squared mixed difference.
+			auto addEnergy = [&](const std::vector<int>& di, const std::vector<int>& dj, const std::vector<double>& coefficients, double weight, int i, int j)
+			{
+				for (int s = 0; s < coefficients.size(); s++)
+				{
+					int k = (i + di[s]) * columns + j + dj[s];
+					for (int t = 0; t < coefficients.size(); t++)
+					{
+						matrix[entry(k, di[t] - di[s], dj[t] - dj[s])] += weight * coefficients[s] * coefficients[t];
+					}
+				}
+			};
+			for (int i = 0; i < rows; i++)
+			{
+				for (int j = 0; j < columns; j++)
+				{
+					if (i + 2 < rows) addEnergy({ 0, 1, 2 }, { 0, 0, 0 }, { 1, -2, 1 }, smoothing, i, j);
+					if (j + 2 < columns) addEnergy({ 0, 0, 0 }, { 0, 1, 2 }, { 1, -2, 1 }, smoothing, i, j);
+					if (i + 1 < rows && j + 1 < columns) addEnergy({ 0, 1, 0, 1 }, { 0, 0, 1, 1 }, { 1, -1, -1, 1 }, 2 * smoothing, i, j);
+				}
+			}
+		}
+
+		std::vector<double> diagonal(size);
+		for (int k = 0; k < size; k++)
+		{
+			diagonal[k] = matrix[entry(k, 0, 0)];
+		}
+		// The three coordinates are solved on their own threads, so one mat-vec stays on one thread.
+		auto multiply = [&](const std::vector<double>& x, std::vector<double>& y)
+		{
+			for (int i = 0; i < rows; i++)
+			{
+				for (int j = 0; j < columns; j++)
+				{
+					int k = i * columns + j;
+					double sum = 0.0;
+					for (int di = std::max(-reachU, -i); di <= std::min(reachU, rows - 1 - i); di++)
+					{
+						for (int dj = std::max(-reachV, -j); dj <= std::min(reachV, columns - 1 - j); dj++)
+						{
+							sum += matrix[entry(k, di, dj)] * x[k + di * columns + dj];
+						}
+					}
+					y[k] = sum;
+				}
+			}
+		};
+
+		int maxIterations = 10 * size;
+		controlPoints.assign(rows, std::vector<XYZW>(columns));
+		std::vector<std::vector<double>> solutions(3);
+		std::vector<char> isConverged(3);
+		ThreadUtils::ParallelFor(0, 3, [&](int c)
+			{
+				std::vector<double> b(size);
+				for (int k = 0; k < size; k++)
+				{
+					b[k] = right[3 * k + c];
+				}
+				solutions[c].assign(size, 0.0);
+				int iterations = MathUtils::ConjugateGradient(multiply, diagonal, b, solutions[c], 1e-12, maxIterations);
+				isConverged[c] = iterations < maxIterations;
+			});
+		if (!isConverged[0] || !isConverged[1] || !isConverged[2]) return false;
+		for (int i = 0; i < rows; i++)
+		{
+			for (int j = 0; j < columns; j++)
+			{
+				int k = i * columns + j;
+				controlPoints[i][j] = XYZW(XYZ(solutions[0][k], solutions[1][k], solutions[2][k]), 1.0);
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Bezier control points of the piece over knot span spanIndex by blossoming,
+	/// Bezier point k being the blossom with k arguments at the span end and degree - k at its start.
+	/// source(i) is control point spanIndex - degree + i, target(k) receives Bezier point k.
+	/// </summary>
+	template <typename Source, typename Target>
+	void GetBezierSegment(int degree, const std::vector<double>& knotVector, int spanIndex, Source source, Target target)
+	{
+		double start = knotVector[spanIndex];
+		double end = knotVector[spanIndex + 1];
+		XYZW temp[Constants::NURBSMaxDegree + 1];
+		for (int k = 0; k <= degree; k++)
+		{
+			for (int i = 0; i <= degree; i++)
+			{
+				temp[i] = source(i);
+			}
+			for (int r = 1; r <= degree; r++)
+			{
+				double x = r <= k ? end : start;
+				for (int i = degree; i >= r; i--)
+				{
+					int index = spanIndex - degree + i;
+					double alpha = (x - knotVector[index]) / (knotVector[index + degree + 1 - r] - knotVector[index]);
+					temp[i] = alpha * temp[i] + (1.0 - alpha) * temp[i - 1];
+				}
+			}
+			target(k) = temp[degree];
+		}
+	}
+
+	/// <summary>
+	/// Indices of the nonempty knot spans.
+	/// </summary>
+	std::vector<int> GetNonEmptySpans(int degree, const std::vector<double>& knotVector)
+	{
+		std::vector<int> spans;
+		int n = knotVector.size() - degree - 2;
+		for (int i = degree; i <= n; i++)
+		{
+			if (knotVector[i] < knotVector[i + 1])
+			{
+				spans.emplace_back(i);
+			}
+		}
+		return spans;
+	}
+
 	std::vector<int> GetIndex(int size)
 	{
 		std::vector<int> ind(2 * (size - 1) + 2);
@@ -107,6 +509,332 @@ namespace LNLib
 		double z = localZdir.GetX() * traslation.GetX() + localZdir.GetY() * traslation.GetY() + localZdir.GetZ() * traslation.GetZ();
 		return XYZ(x, y, z);
 	}
+
+	bool GetParamByNewtonIteration(const LN_NurbsSurface& surface, const XYZ& givenPoint, double a, double b, double c, double d, bool isClosedU, bool isClosedV, UV& param)
+	{
+		int maxIterations = 10;
+		int counters = 0;
+		while (counters < maxIterations)
+		{
+			std::vector<std::vector<XYZ>> derivatives = NurbsSurface::ComputeRationalSurfaceDerivatives(surface, 2, param);
+			XYZ difference = derivatives[0][0] - givenPoint;
+			double fa = derivatives[1][0].DotProduct(difference);
+			double fb = derivatives[0][1].DotProduct(difference);
+
+			double condition1 = difference.Length();
+			double condition2a = std::abs(fa / (derivatives[1][0].Length() * condition1));
+			double condition2b = std::abs(fb / (derivatives[0][1].Length() * condition1));
+
+			if (condition1 < Constants::DistanceEpsilon &&
+				condition2a < Constants::DistanceEpsilon &&
+				condition2b < Constants::DistanceEpsilon)
+			{
+				return true;
+			}
+
+			XYZ Su = derivatives[1][0];
+			XYZ Sv = derivatives[0][1];
+
+			XYZ Suu = derivatives[2][0];
+			XYZ Svv = derivatives[0][2];
+
+			XYZ Suv = derivatives[1][1];
+			XYZ Svu = derivatives[1][1];
+
+			double fuv = -Su.DotProduct(difference);
+			double guv = -Sv.DotProduct(difference);
+
+			double fu = Su.DotProduct(Su) + difference.DotProduct(Suu);
+			double fv = Su.DotProduct(Sv) + difference.DotProduct(Suv);
+			double gu = Su.DotProduct(Sv) + difference.DotProduct(Svu);
+			double gv = Sv.DotProduct(Sv) + difference.DotProduct(Svv);
+
+			if (MathUtils::IsAlmostEqualTo(fu * gv, fv * gu))
+			{
+				counters++;
+				continue;
+			}
+
+			double deltaU = (fuv * gv - fv * guv) / (fu * gv - fv * gu);
+			double deltaV = (fu * guv - fuv * gu) / (fu * gv - fv * gu);
+
+			UV temp = param + UV(deltaU, deltaV);
+			if (!isClosedU)
+			{
+				temp = UV(std::max(a, std::min(b, temp[0])), temp[1]);
+			}
+			else
+			{
+				if (temp[0] < a)
+				{
+					temp = UV(b - (a - temp[0]), temp[1]);
+				}
+				if (temp[0] > b)
+				{
+					temp = UV(a + (temp[0] - b), temp[1]);
+				}
+			}
+			if (!isClosedV)
+			{
+				temp = UV(temp[0], std::max(c, std::min(d, temp[1])));
+			}
+			else
+			{
+				if (temp[1] < c)
+				{
+					temp = UV(temp[0], d - (c - temp[1]));
+				}
+				if (temp[1] > d)
+				{
+					temp = UV(temp[0], c + (temp[1] - d));
+				}
+			}
+
+			double condition4a = ((temp[0] - param[0]) * derivatives[1][0]).Length();
+			double condition4b = ((temp[1] - param[1]) * derivatives[0][1]).Length();
+			if (condition4a + condition4b < Constants::DistanceEpsilon)
+			{
+				return true;
+			}
+
+			param = UV(std::max(a, std::min(b, temp[0])), std::max(c, std::min(d, temp[1])));
+			counters++;
+		}
+		return false;
+	}
+
+	// Whether a converged Newton result is the projection. Results off the domain ends always are.
+	// Newton iteration also stops when its step is clamped at an end of the domain,
+	// so a result there is the projection only if the surface is open in that direction and the point lies beyond that end.
+	bool IsAcceptedProjection(const LN_NurbsSurface& surface, const XYZ& givenPoint, const UV& param)
+	{
+		const std::vector<double>& knotVectorU = surface.KnotVectorU;
+		const std::vector<double>& knotVectorV = surface.KnotVectorV;
+		int n = static_cast<int>(surface.ControlPoints.size()) - 1;
+		int m = static_cast<int>(surface.ControlPoints[0].size()) - 1;
+		bool isOnStartU = MathUtils::IsAlmostEqualTo(param.GetU(), knotVectorU[surface.DegreeU]);
+		bool isOnEndU = MathUtils::IsAlmostEqualTo(param.GetU(), knotVectorU[n + 1]);
+		bool isOnStartV = MathUtils::IsAlmostEqualTo(param.GetV(), knotVectorV[surface.DegreeV]);
+		bool isOnEndV = MathUtils::IsAlmostEqualTo(param.GetV(), knotVectorV[m + 1]);
+		if (!isOnStartU && !isOnEndU && !isOnStartV && !isOnEndV) return true;
+
+		XYZ S, Su, Sv;
+		NurbsSurface::ComputeRationalSurfaceFirstOrderDerivative(surface, param, S, Su, Sv);
+		XYZ difference = givenPoint - S;
+		double distance = difference.Length();
+		if (distance < Constants::DistanceEpsilon) return true;
+
+		if (isOnStartU || isOnEndU)
+		{
+			if (NurbsSurface::IsClosed(surface, true)) return false;
+			double cosine = Su.DotProduct(difference) / (Su.Length() * distance);
+			if (isOnStartU ? cosine > Constants::DistanceEpsilon : cosine < -Constants::DistanceEpsilon) return false;
+		}
+		if (isOnStartV || isOnEndV)
+		{
+			if (NurbsSurface::IsClosed(surface, false)) return false;
+			double cosine = Sv.DotProduct(difference) / (Sv.Length() * distance);
+			if (isOnStartV ? cosine > Constants::DistanceEpsilon : cosine < -Constants::DistanceEpsilon) return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Balanced kd-tree over tessellated surface points,
+	/// used to find the start parameter of point inversion for many points at once.
+	/// </summary>
+	class SurfaceSampleTree
+	{
+	public:
+		SurfaceSampleTree(std::vector<XYZ>&& points, std::vector<UV>&& params) :
+			m_points(std::move(points)), m_params(std::move(params)), m_indices(m_points.size()), m_axes(m_points.size())
+		{
+			for (int i = 0; i < m_indices.size(); i++)
+			{
+				m_indices[i] = i;
+			}
+			Build(0, m_indices.size());
+		}
+
+		UV GetNearestParam(const XYZ& point) const
+		{
+			int nearest = -1;
+			double minDistance = Constants::MaxDistance;
+			Search(0, m_indices.size(), point, nearest, minDistance);
+			return m_params[nearest];
+		}
+
+	private:
+		void Build(int start, int end)
+		{
+			if (end - start <= 1) return;
+
+			XYZ min = m_points[m_indices[start]];
+			XYZ max = min;
+			for (int i = start + 1; i < end; i++)
+			{
+				const XYZ& current = m_points[m_indices[i]];
+				for (int k = 0; k < 3; k++)
+				{
+					min[k] = std::min(min[k], current[k]);
+					max[k] = std::max(max[k], current[k]);
+				}
+			}
+			XYZ extent = max - min;
+			int axis = 0;
+			if (extent[1] > extent[axis]) axis = 1;
+			if (extent[2] > extent[axis]) axis = 2;
+
+			int middle = start + (end - start) / 2;
+			std::nth_element(m_indices.begin() + start, m_indices.begin() + middle, m_indices.begin() + end,
+				[&](int left, int right) { return m_points[left][axis] < m_points[right][axis]; });
+			m_axes[middle] = axis;
+
+			Build(start, middle);
+			Build(middle + 1, end);
+		}
+
+		void Search(int start, int end, const XYZ& point, int& nearest, double& minDistance) const
+		{
+			if (start >= end) return;
+
+			int middle = start + (end - start) / 2;
+			const XYZ& current = m_points[m_indices[middle]];
+			double distance = point.Distance(current);
+			if (distance < minDistance)
+			{
+				minDistance = distance;
+				nearest = m_indices[middle];
+			}
+			if (end - start == 1) return;
+
+			int axis = m_axes[middle];
+			double difference = point[axis] - current[axis];
+			if (difference < 0)
+			{
+				Search(start, middle, point, nearest, minDistance);
+				if (-difference < minDistance)
+				{
+					Search(middle + 1, end, point, nearest, minDistance);
+				}
+			}
+			else
+			{
+				Search(middle + 1, end, point, nearest, minDistance);
+				if (difference < minDistance)
+				{
+					Search(start, middle, point, nearest, minDistance);
+				}
+			}
+		}
+
+		std::vector<XYZ> m_points;
+		std::vector<UV> m_params;
+		std::vector<int> m_indices;
+		std::vector<int> m_axes;
+	};
+
+	/// <summary>
+	/// Map the knot vectors of compatible curves onto [0, 1] in place.
+	/// </summary>
+	void NormalizeKnotVectors(std::vector<LN_NurbsCurve>& curves)
+	{
+		for (int i = 0; i < curves.size(); i++)
+		{
+			std::vector<double>& knotVector = curves[i].KnotVector;
+			double first = knotVector.front();
+			double length = knotVector.back() - first;
+			for (int k = 0; k < knotVector.size(); k++)
+			{
+				knotVector[k] = (knotVector[k] - first) / length;
+			}
+			knotVector.back() = 1.0;
+		}
+	}
+
+	/// <summary>
+	/// Degrees and knot vectors of surface copied to result, with one empty row per control point row.
+	/// </summary>
+	void CopyTransformedHeader(const LN_NurbsSurface& surface, LN_NurbsSurface& result)
+	{
+		result.DegreeU = surface.DegreeU;
+		result.DegreeV = surface.DegreeV;
+		result.KnotVectorU = surface.KnotVectorU;
+		result.KnotVectorV = surface.KnotVectorV;
+		result.ControlPoints.resize(surface.ControlPoints.size());
+	}
+
+	/// <summary>
+	/// Transform control point row i of surface into result on the calling thread.
+	/// </summary>
+	void TransformRow(const LN_NurbsSurface& surface, const Matrix4d& matrix, int i, LN_NurbsSurface& result)
+	{
+		int columns = surface.ControlPoints[i].size();
+		result.ControlPoints[i].resize(columns);
+		matrix.OfWeightedPoints(surface.ControlPoints[i].data(), columns, result.ControlPoints[i].data(), false);
+	}
+
+	/// <summary>
+	/// Boolean sum surfaces[0] + surfaces[1] - surfaces[2] of surfaces over the same domain.
+	/// The surfaces are brought to common degrees and knot vectors one after another,
+	/// each step running in parallel over control point rows.
+	/// </summary>
+	void CombineSurfaces(std::vector<LN_NurbsSurface>& surfaces, LN_NurbsSurface& result)
+	{
+		int count = surfaces.size();
+		int degreeU = 0;
+		int degreeV = 0;
+		for (int i = 0; i < count; i++)
+		{
+			degreeU = std::max(degreeU, surfaces[i].DegreeU);
+			degreeV = std::max(degreeV, surfaces[i].DegreeV);
+		}
+		for (int i = 0; i < count; i++)
+		{
+			LN_NurbsSurface& current = surfaces[i];
+			if (degreeU > current.DegreeU)
+			{
+				NurbsSurface::ElevateDegree(current, degreeU - current.DegreeU, true, current);
+			}
+			if (degreeV > current.DegreeV)
+			{
+				NurbsSurface::ElevateDegree(current, degreeV - current.DegreeV, false, current);
+			}
+		}
+
+		std::vector<std::vector<double>> knotVectorsU(count);
+		std::vector<std::vector<double>> knotVectorsV(count);
+		for (int i = 0; i < count; i++)
+		{
+			knotVectorsU[i] = surfaces[i].KnotVectorU;
+			knotVectorsV[i] = surfaces[i].KnotVectorV;
+		}
+		auto insertElementsU = KnotVectorUtils::GetInsertedKnotElements(knotVectorsU);
+		auto insertElementsV = KnotVectorUtils::GetInsertedKnotElements(knotVectorsV);
+		for (int i = 0; i < count; i++)
+		{
+			NurbsSurface::RefineKnotVector(surfaces[i], insertElementsU[i], insertElementsV[i], surfaces[i]);
+		}
+
+		const LN_NurbsSurface& first = surfaces[0];
+		const LN_NurbsSurface& second = surfaces[1];
+		const LN_NurbsSurface& third = surfaces[2];
+		int rows = first.ControlPoints.size();
+		int columns = first.ControlPoints[0].size();
+
+		result.DegreeU = first.DegreeU;
+		result.DegreeV = first.DegreeV;
+		result.KnotVectorU = first.KnotVectorU;
+		result.KnotVectorV = first.KnotVectorV;
+		result.ControlPoints.assign(rows, std::vector<XYZW>(columns));
+		ThreadUtils::ParallelFor(0, rows, [&](int i)
+			{
+				for (int j = 0; j < columns; j++)
+				{
+					result.ControlPoints[i][j] = first.ControlPoints[i][j] + second.ControlPoints[i][j] - third.ControlPoints[i][j];
+				}
+			}, 16);
+	}
 }
 
 void  LNLib::NurbsSurface::Check(const LN_NurbsSurface& surface)
@@ -249,8 +977,8 @@ double LNLib::NurbsSurface::Curvature(const LN_NurbsSurface& surface, SurfaceCur
 
 	double K = (L * N - M * M) / denominator;
 	double H = (E * N + G * L - 2 * F * M) / (2 * denominator);
-	double k1 = H + std::sqrt(abs(H * H - K));
-	double k2 = H - std::sqrt(abs(H * H - K));
+	double k1 = H + std::sqrt(std::abs(H * H - K));
+	double k2 = H - std::sqrt(std::abs(H * H - K));
 
 	if (curvature == SurfaceCurvature::Gauss)
 	{
@@ -270,7 +998,7 @@ double LNLib::NurbsSurface::Curvature(const LN_NurbsSurface& surface, SurfaceCur
 	}
 	else if (curvature == SurfaceCurvature::Abs)
 	{
-		return abs(k1) + abs(k2);
+		return std::abs(k1) + std::abs(k2);
 	}
 	else if (curvature == SurfaceCurvature::Rms)
 	{
@@ -389,9 +1117,9 @@ void LNLib::NurbsSurface::InsertKnot(const LN_NurbsSurface& surface, double inse
 {
 	int degreeU = surface.DegreeU;
 	int degreeV = surface.DegreeV;
-	std::vector<double> knotVectorU = surface.KnotVectorU;
-	std::vector<double> knotVectorV = surface.KnotVectorV;
-	std::vector<std::vector<XYZW>> controlPoints = surface.ControlPoints;
+	const std::vector<double>& knotVectorU = surface.KnotVectorU;
+	const std::vector<double>& knotVectorV = surface.KnotVectorV;
+	const std::vector<std::vector<XYZW>>& controlPoints = surface.ControlPoints;
 
 	if (isUDirection)
 	{
@@ -402,396 +1130,189 @@ void LNLib::NurbsSurface::InsertKnot(const LN_NurbsSurface& surface, double inse
 		VALIDATE_ARGUMENT(ValidationUtils::IsValidNurbs(degreeV, knotVectorV.size(), controlPoints[0].size()), "controlPoints", "Arguments must be fit: m = n + p + 1");
 	}
 
-	int degree = isUDirection ? surface.DegreeU : surface.DegreeV;
-	std::vector<double> knotVector = isUDirection ? surface.KnotVectorU : surface.KnotVectorV;
-	int knotSpanIndex = Polynomials::GetKnotSpanIndex(degree, knotVector, insertKnot);
+	int degree = isUDirection ? degreeU : degreeV;
+	const std::vector<double>& knotVector = isUDirection ? knotVectorU : knotVectorV;
 	int multiplicity = Polynomials::GetKnotMultiplicity(knotVector, insertKnot);
 
-	if (multiplicity == degree)
-	{
-		result = surface;
-		return;
-	}
-
 	if ((times + multiplicity) > degree)
 	{
 		times = degree - multiplicity;
 	}
-
-	std::vector<double> insertedKnotVector(knotVector.size() + times);
-	for (int i = 0; i <= knotSpanIndex; i++)
-	{
-		insertedKnotVector[i] = knotVector[i];
-	}
-
-	for (int i = 1; i <= times; i++)
+	if (times <= 0)
 	{
-		insertedKnotVector[knotSpanIndex + i] = insertKnot;
+		result = surface;
+		return;
 	}
 
-	for (int i = knotSpanIndex + 1; i < knotVector.size(); i++)
-	{
-		insertedKnotVector[i + times] = knotVector[i];
-	}
+	// Inserting one knot several times is the refinement by that many copies of it.
+	std::vector<double> insertKnotElements(times, insertKnot);
+	RefineKnotVector(surface, insertKnotElements, isUDirection, result);
+}
 
-	std::vector<std::vector<double>> alpha(degree - multiplicity, std::vector<double>(times + 1));
-	for (int j = 1; j <= times; j++)
-	{
-		int L = knotSpanIndex - degree + j;
-		for (int i = 0; i <= degree - j - multiplicity; i++)
-		{
-			alpha[i][j] = (insertKnot - knotVector[L + i]) / (knotVector[i + knotSpanIndex + 1] - knotVector[L + i]);
-		}
-	}
+void LNLib::NurbsSurface::RefineKnotVector(const LN_NurbsSurface& surface, std::vector<double>& insertKnotElements, bool isUDirection, LN_NurbsSurface& result)
+{
+	const std::vector<std::vector<XYZW>>& controlPoints = surface.ControlPoints;
 
-	std::vector<XYZW> temp(degree + 1);
+	VALIDATE_ARGUMENT(insertKnotElements.size() > 0, "insertKnotElements", "insertKnotElements size must be greater than zero.");
 
 	int rows = controlPoints.size();
 	int columns = controlPoints[0].size();
+	int added = insertKnotElements.size();
 
-	result = surface;
-
-	std::vector<std::vector<XYZW>> updatedControlPoints;
+	LN_NurbsSurface refined;
+	refined.DegreeU = surface.DegreeU;
+	refined.DegreeV = surface.DegreeV;
 	if (isUDirection)
 	{
-		updatedControlPoints.resize(rows + times, std::vector<XYZW>(columns));
-		for (int col = 0; col < columns; col++)
-		{
-			for (int i = 0; i <= knotSpanIndex - degree; i++)
-			{
-				updatedControlPoints[i][col] = controlPoints[i][col];
-			}
-
-			for (int i = knotSpanIndex - multiplicity; i < rows; i++)
-			{
-				updatedControlPoints[i + times][col] = controlPoints[i][col];
-			}
-
-			for (int i = 0; i < degree - multiplicity + 1; i++)
-			{
-				temp[i] = controlPoints[knotSpanIndex - degree + i][col];
-			}
-
-			int L = 0;
-			for (int j = 1; j <= times; j++)
-			{
-				L = knotSpanIndex - degree + j;
-				for (int i = 0; i <= degree - j - multiplicity; i++)
-				{
-					double a = alpha[i][j];
-					temp[i] = a * temp[i + 1] + (1.0 - a) * temp[i];
-				}
-				updatedControlPoints[L][col] = temp[0];
-				updatedControlPoints[knotSpanIndex + times - j - multiplicity][col] = temp[degree - j - multiplicity];
-			}
+		LN_KnotRefinement refinement;
+		KnotVectorUtils::GetKnotRefinement(surface.DegreeU, surface.KnotVectorU, insertKnotElements, refinement);
+		refined.KnotVectorU = refinement.KnotVector;
+		refined.KnotVectorV = surface.KnotVectorV;
+		refined.ControlPoints.assign(rows + added, std::vector<XYZW>(columns));
 
-			for (int i = L + 1; i < knotSpanIndex - multiplicity; i++)
+		// Every step combines whole rows, so blocks of columns are refined in parallel.
+		const int blockSize = 64;
+		int blocks = (columns + blockSize - 1) / blockSize;
+		ThreadUtils::ParallelFor(0, blocks, [&](int block)
 			{
-				updatedControlPoints[i][col] = temp[i - L];
-			}
-		}
-		result.KnotVectorU = insertedKnotVector;
-		result.ControlPoints = updatedControlPoints;
+				int first = block * blockSize;
+				int count = std::min(blockSize, columns - first);
+				ControlPointsUtils::RefineControlPoints(refinement, rows - 1, count,
+					[&](int i, int c) -> const XYZW& { return controlPoints[i][first + c]; },
+					[&](int i, int c) -> XYZW& { return refined.ControlPoints[i][first + c]; });
+			});
 	}
 	else
 	{
-		updatedControlPoints.resize(rows, std::vector<XYZW>(columns + times));
-		for (int row = 0; row < rows; row++)
-		{
-			for (int i = 0; i <= knotSpanIndex - degree; i++)
-			{
-				updatedControlPoints[row][i] = controlPoints[row][i];
-			}
-
-			for (int i = knotSpanIndex - multiplicity; i < columns; i++)
-			{
-				updatedControlPoints[row][i + times] = controlPoints[row][i];
-			}
-
-			for (int i = 0; i < degree - multiplicity + 1; i++)
-			{
-				temp[i] = controlPoints[row][knotSpanIndex - degree + i];
-			}
-
-			int L = 0;
-			for (int j = 1; j <= times; j++)
-			{
-				L = knotSpanIndex - degree + j;
-				for (int i = 0; i <= degree - j - multiplicity; i++)
-				{
-					double a = alpha[i][j];
-					temp[i] = a * temp[i + 1] + (1.0 - a) * temp[i];
-				}
-				updatedControlPoints[row][L] = temp[0];
-				updatedControlPoints[row][knotSpanIndex + times - j - multiplicity] = temp[degree - j - multiplicity];
-			}
+		LN_KnotRefinement refinement;
+		KnotVectorUtils::GetKnotRefinement(surface.DegreeV, surface.KnotVectorV, insertKnotElements, refinement);
+		refined.KnotVectorU = surface.KnotVectorU;
+		refined.KnotVectorV = refinement.KnotVector;
+		refined.ControlPoints.assign(rows, std::vector<XYZW>(columns + added));
 
-			for (int i = L + 1; i < knotSpanIndex - multiplicity; i++)
+		ThreadUtils::ParallelFor(0, rows, [&](int row)
 			{
-				updatedControlPoints[row][i] = temp[i - L];
-			}
-		}
-		result.KnotVectorV = insertedKnotVector;
-		result.ControlPoints = updatedControlPoints;
+				ControlPointsUtils::RefineControlPoints(refinement, columns - 1, 1,
+					[&](int i, int) -> const XYZW& { return controlPoints[row][i]; },
+					[&](int i, int) -> XYZW& { return refined.ControlPoints[row][i]; });
+			}, 16);
 	}
+	result = std::move(refined);
 }
 
-void LNLib::NurbsSurface::RefineKnotVector(const LN_NurbsSurface& surface, std::vector<double>& insertKnotElements, bool isUDirection, LN_NurbsSurface& result)
+void LNLib::NurbsSurface::RefineKnotVector(const LN_NurbsSurface& surface, std::vector<double>& insertKnotElementsU, std::vector<double>& insertKnotElementsV, LN_NurbsSurface& result)
 {
-	int degreeU = surface.DegreeU;
-	int degreeV = surface.DegreeV;
-	std::vector<double> knotVectorU = surface.KnotVectorU;
-	std::vector<double> knotVectorV = surface.KnotVectorV;
-	std::vector<std::vector<XYZW>> controlPoints = surface.ControlPoints;
-
-	VALIDATE_ARGUMENT(insertKnotElements.size() > 0, "insertKnotElements", "insertKnotElements size must be greater than zero.");
-
-	std::vector<double> tempKnotVector;
-	std::vector<std::vector<XYZW>> tempControlPoints;
-
-	result = surface;
-
-	if (isUDirection)
+	if (insertKnotElementsU.empty() && insertKnotElementsV.empty())
 	{
-		std::vector<std::vector<XYZW>> transposedControlPoints;
-		MathUtils::Transpose(controlPoints, transposedControlPoints);
+		result = surface;
+		return;
+	}
+	if (insertKnotElementsU.empty())
+	{
+		RefineKnotVector(surface, insertKnotElementsV, false, result);
+		return;
+	}
+	if (insertKnotElementsV.empty())
+	{
+		RefineKnotVector(surface, insertKnotElementsU, true, result);
+		return;
+	}
 
-		for (int i = 0; i < transposedControlPoints.size(); i++)
-		{
-			LN_NurbsCurve tc;
-			tc.Degree = degreeU;
-			tc.KnotVector = knotVectorU;
-			tc.ControlPoints = transposedControlPoints[i];
+	// The V pass refines each row on its own, the U pass then combines the refined rows.
+	LN_NurbsSurface temp;
+	RefineKnotVector(surface, insertKnotElementsV, false, temp);
+	RefineKnotVector(temp, insertKnotElementsU, true, result);
+}
 
-			LN_NurbsCurve newtc;
-			NurbsCurve::RefineKnotVector(tc, insertKnotElements, newtc);
-			tempControlPoints.emplace_back(newtc.ControlPoints);
-			tempKnotVector = newtc.KnotVector;
-		}
-		result.KnotVectorU = tempKnotVector;
-		result.KnotVectorV = knotVectorV;
-		std::vector<std::vector<XYZW>> updatedControlPoints;
-		MathUtils::Transpose(tempControlPoints, updatedControlPoints);
-		result.ControlPoints = updatedControlPoints;
-	}
-	else
+std::vector<LNLib::LN_NurbsSurface> LNLib::NurbsSurface::DecomposeToBeziers(const LN_NurbsSurface& surface)
+{
+	LN_BezierPatches patches;
+	DecomposeToBeziers(surface, patches);
+
+	int degreeU = patches.DegreeU;
+	int degreeV = patches.DegreeV;
+	std::vector<double> bezierKnotsU(2 * (degreeU + 1), 0.0);
+	std::vector<double> bezierKnotsV(2 * (degreeV + 1), 0.0);
+	std::fill(bezierKnotsU.begin() + degreeU + 1, bezierKnotsU.end(), 1.0);
+	std::fill(bezierKnotsV.begin() + degreeV + 1, bezierKnotsV.end(), 1.0);
+
+	int size = patches.SpansU.size() * patches.SpansV.size();
+	int patchSize = (degreeU + 1) * (degreeV + 1);
+	std::vector<LN_NurbsSurface> bezierPatches(size);
+	for (int k = 0; k < size; k++)
 	{
-		for (int i = 0; i < controlPoints.size(); i++)
+		LN_NurbsSurface& patch = bezierPatches[k];
+		patch.DegreeU = degreeU;
+		patch.DegreeV = degreeV;
+		patch.KnotVectorU = bezierKnotsU;
+		patch.KnotVectorV = bezierKnotsV;
+		patch.ControlPoints.resize(degreeU + 1);
+		auto first = patches.ControlPoints.begin() + k * patchSize;
+		for (int i = 0; i <= degreeU; i++)
 		{
-			LN_NurbsCurve tc;
-			tc.Degree = degreeV;
-			tc.KnotVector = knotVectorV;
-			tc.ControlPoints = controlPoints[i];
-
-			LN_NurbsCurve newtc;
-			NurbsCurve::RefineKnotVector(tc, insertKnotElements, newtc);
-			tempControlPoints.emplace_back(newtc.ControlPoints);
-			tempKnotVector = newtc.KnotVector;
+			patch.ControlPoints[i].assign(first + i * (degreeV + 1), first + (i + 1) * (degreeV + 1));
 		}
-		result.KnotVectorU = knotVectorU;
-		result.KnotVectorV = tempKnotVector;
-		result.ControlPoints = tempControlPoints;
 	}
+	return bezierPatches;
 }
 
-std::vector<LNLib::LN_NurbsSurface> LNLib::NurbsSurface::DecomposeToBeziers(const LN_NurbsSurface& surface)
+void LNLib::NurbsSurface::DecomposeToBeziers(const LN_NurbsSurface& surface, LN_BezierPatches& patches)
 {
 	int degreeU = surface.DegreeU;
 	int degreeV = surface.DegreeV;
-	std::vector<double> knotVectorU = surface.KnotVectorU;
-	std::vector<double> knotVectorV = surface.KnotVectorV;
-	std::vector<std::vector<XYZW>> controlPoints = surface.ControlPoints;
-
-	int rows = controlPoints.size();
-	int columns = controlPoints[0].size();
-
-	int knotUSize = 2 * (degreeU + 1);
-	std::vector<double> bezierKnotsU(knotUSize);
-	for (int i = 0; i < knotUSize / 2; i++)
-	{
-		bezierKnotsU[i] = 0;
-	}
-	for (int i = knotUSize / 2; i < knotUSize; i++)
-	{
-		bezierKnotsU[i] = 1;
-	}
-	int knotVSize = 2 * (degreeV + 1);
-	std::vector<double> bezierKnotsV(knotVSize);
-	for (int i = 0; i < knotVSize / 2; i++)
-	{
-		bezierKnotsV[i] = 0;
-	}
-	for (int i = knotVSize / 2; i < knotVSize; i++)
-	{
-		bezierKnotsV[i] = 1;
-	}
-
-	std::vector<LNLib::LN_NurbsSurface> tempBezierPatches(rows - degreeU);
-	for (int i = 0; i < tempBezierPatches.size(); i++)
-	{
-		tempBezierPatches[i].DegreeU = degreeU;
-		tempBezierPatches[i].DegreeV = degreeV;
-		tempBezierPatches[i].KnotVectorU = bezierKnotsU;
-		tempBezierPatches[i].KnotVectorV = knotVectorV;
-		tempBezierPatches[i].ControlPoints = std::vector<std::vector<XYZW>>(degreeU + 1, std::vector<XYZW>(columns));
-	}
+	const std::vector<double>& knotVectorU = surface.KnotVectorU;
+	const std::vector<double>& knotVectorV = surface.KnotVectorV;
+	const std::vector<std::vector<XYZW>>& controlPoints = surface.ControlPoints;
 
-	int m = rows - 1 + degreeU + 1;
-	int a = degreeU;
-	int b = degreeU + 1;
-
-	int nb = 0;
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidNurbs(degreeU, knotVectorU.size(), controlPoints.size()), "controlPoints", "Arguments must be fit: m = n + p + 1");
+	VALIDATE_ARGUMENT(ValidationUtils::IsValidNurbs(degreeV, knotVectorV.size(), controlPoints[0].size()), "controlPoints", "Arguments must be fit: m = n + p + 1");
 
-	for (int i = 0; i <= degreeU; i++)
-	{
-		for (int j = 0; j < columns; j++)
-		{
-			tempBezierPatches[nb].ControlPoints[i][j] = controlPoints[i][j];
-		}
-	}
-	std::vector<double> alphaVector(std::max(degreeU, degreeV) + 1);
-	while (b < m)
+	patches.DegreeU = degreeU;
+	patches.DegreeV = degreeV;
+	patches.SpansU = GetNonEmptySpans(degreeU, knotVectorU);
+	patches.SpansV = GetNonEmptySpans(degreeV, knotVectorV);
+	patches.ParamsU.clear();
+	patches.ParamsV.clear();
+	for (int span : patches.SpansU)
 	{
-		int i = b;
-		while (b < m && MathUtils::IsLessThanOrEqual(knotVectorU[b + 1], knotVectorU[b]))
-		{
-			b++;
-		}
-		int multi = b - i + 1;
-		if (multi < degreeU)
-		{
-			double numerator = knotVectorU[b] - knotVectorU[a];
-
-			for (int j = degreeU; j > multi; j--)
-			{
-				alphaVector[j - multi - 1] = numerator / (knotVectorU[a + j] - knotVectorU[a]);
-			}
-			int r = degreeU - multi;
-			for (int j = 1; j <= r; j++)
-			{
-				int save = r - j;
-				int s = multi + j;
-				for (int k = degreeU; k >= s; k--)
-				{
-					double alpha = alphaVector[k - s];
-					for (int col = 0; col < columns; col++)
-					{
-						tempBezierPatches[nb].ControlPoints[k][col] = alpha * tempBezierPatches[nb].ControlPoints[k][col] + (1.0 - alpha) * tempBezierPatches[nb].ControlPoints[k - 1][col];
-					}
-				}
-				if (b < m)
-				{
-					for (int col = 0; col < columns; col++)
-					{
-						tempBezierPatches[nb + 1].ControlPoints[save][col] = tempBezierPatches[nb].ControlPoints[degreeU][col];
-					}
-				}
-			}
-		}
-		nb++;
-		if (b < m)
-		{
-			for (int i = degreeU - multi; i <= degreeU; i++)
-			{
-				for (int col = 0; col < columns; col++)
-				{
-					tempBezierPatches[nb].ControlPoints[i][col] = controlPoints[b - degreeU + i][col];
-				}
-			}
-			a = b;
-			b++;
-		}
+		patches.ParamsU.emplace_back(knotVectorU[span]);
 	}
-
-	std::vector<LNLib::LN_NurbsSurface> bezierPatches(tempBezierPatches.size() * (columns - degreeV));
-	for (int i = 0; i < bezierPatches.size(); i++)
+	patches.ParamsU.emplace_back(knotVectorU[patches.SpansU.back() + 1]);
+	for (int span : patches.SpansV)
 	{
-		bezierPatches[i].DegreeU = degreeU;
-		bezierPatches[i].DegreeV = degreeV;
-		bezierPatches[i].KnotVectorU = bezierKnotsU;
-		bezierPatches[i].KnotVectorV = bezierKnotsV;
-		bezierPatches[i].ControlPoints = std::vector<std::vector<XYZW>>(degreeU + 1, std::vector<XYZW>(degreeV + 1));
+		patches.ParamsV.emplace_back(knotVectorV[span]);
 	}
+	patches.ParamsV.emplace_back(knotVectorV[patches.SpansV.back() + 1]);
 
-	int size = nb;
-	nb = 0;
-	for (int np = 0; np < size; np++)
-	{
-		for (int i = 0; i <= degreeU; i++)
-		{
-			for (int j = 0; j <= degreeV; j++)
-			{
-				bezierPatches[nb].ControlPoints[i][j] = tempBezierPatches[np].ControlPoints[i][j];
-			}
-		}
-
-		m = columns + degreeV;
-		a = degreeV;
-		b = degreeV + 1;
+	int countU = patches.SpansU.size();
+	int countV = patches.SpansV.size();
+	int columns = controlPoints[0].size();
+	int patchSize = (degreeU + 1) * (degreeV + 1);
+	patches.ControlPoints.assign(countU * countV * patchSize, XYZW());
 
-		while (b < m)
+	// Each U span only needs its own degreeU + 1 rows, so strips are independent.
+	ThreadUtils::ParallelFor(0, countU, [&](int i)
 		{
-			int i = b;
-			while (b < m && MathUtils::IsLessThanOrEqual(knotVectorV[b + 1], knotVectorV[b]))
-			{
-				b++;
-			}
-			int multi = b - i + 1;
-			if (multi < degreeV)
+			int spanU = patches.SpansU[i];
+			std::vector<std::vector<XYZW>> strip(degreeU + 1, std::vector<XYZW>(columns));
+			for (int column = 0; column < columns; column++)
 			{
-				double numrator = knotVectorV[b] - knotVectorV[a];
-				for (int j = degreeV; j > multi; j--)
-				{
-					alphaVector[j - multi - 1] = numrator / (knotVectorV[a + j] - knotVectorV[a]);
-				}
-				int r = degreeV - multi;
-				for (int j = 1; j <= r; j++)
-				{
-					int save = r - j;
-					int s = multi + j;
-					for (int k = degreeV; k >= s; k--)
-					{
-						double alpha = alphaVector[k - s];
-						for (int row = 0; row <= degreeU; row++)
-						{
-							bezierPatches[nb].ControlPoints[row][k] = alpha * bezierPatches[nb].ControlPoints[row][k] + (1.0 - alpha) * bezierPatches[nb].ControlPoints[row][k - 1];
-						}
-					}
-					if (b < m)
-					{
-						for (int row = 0; row <= degreeU; row++)
-						{
-							bezierPatches[nb + 1].ControlPoints[row][save] = bezierPatches[nb].ControlPoints[row][degreeV];
-						}
-					}
-				}
+				GetBezierSegment(degreeU, knotVectorU, spanU,
+					[&](int k) -> const XYZW& { return controlPoints[spanU - degreeU + k][column]; },
+					[&](int k) -> XYZW& { return strip[k][column]; });
 			}
-			nb++;
-			if (b < m)
+			for (int j = 0; j < countV; j++)
 			{
-				for (int i = degreeV - multi; i <= degreeV; i++)
+				int spanV = patches.SpansV[j];
+				XYZW* patch = patches.ControlPoints.data() + (i * countV + j) * patchSize;
+				for (int row = 0; row <= degreeU; row++)
 				{
-					for (int row = 0; row <= degreeU; row++)
-					{
-						bezierPatches[nb].ControlPoints[row][i] = tempBezierPatches[np].ControlPoints[row][b - degreeV + i];
-					}
+					GetBezierSegment(degreeV, knotVectorV, spanV,
+						[&](int k) -> const XYZW& { return strip[row][spanV - degreeV + k]; },
+						[&](int k) -> XYZW& { return patch[row * (degreeV + 1) + k]; });
 				}
-				a = b;
-				b++;
 			}
-		}
-	}
-
-	int currentPatchesSize = bezierPatches.size();
-	int diff = currentPatchesSize - nb;
-	if (diff > 0)
-	{
-		for (int d = 0; d < diff; d++)
-		{
-			bezierPatches.pop_back();
-		}
-	}
-	return bezierPatches;
+		});
 }
 
 void LNLib::NurbsSurface::RemoveKnot(const LN_NurbsSurface& surface, double removeKnot, int times, bool isUDirection, LN_NurbsSurface& result)
@@ -810,130 +1331,13 @@ void LNLib::NurbsSurface::RemoveKnot(const LN_NurbsSurface& surface, double remo
 	{
 		VALIDATE_ARGUMENT_RANGE(removeKnot, knotVectorV[0], knotVectorV[knotVectorV.size() - 1]);
 	}
-	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
-
-	std::vector<double> tempKnotVector;
-	std::vector<std::vector<XYZW>> tempControlPoints;
-
-	result = surface;
-
-	if (isUDirection)
-	{
-		std::vector<std::vector<XYZW>> transposedControlPoints;
-		MathUtils::Transpose(controlPoints, transposedControlPoints);
-
-		for (int i = 0; i < transposedControlPoints.size(); i++)
-		{
-			LN_NurbsCurve tc;
-			tc.Degree = degreeU;
-			tc.KnotVector = knotVectorU;
-			tc.ControlPoints = transposedControlPoints[i];
-
-			LN_NurbsCurve newtc;
-
-			NurbsCurve::RemoveKnot(tc, removeKnot, times, newtc);
-			tempControlPoints.emplace_back(newtc.ControlPoints);
-			tempKnotVector = newtc.KnotVector;
-		}
-		result.KnotVectorU = tempKnotVector;
-		result.KnotVectorV = knotVectorV;
-		std::vector<std::vector<XYZW>> updatedControlPoints;
-		MathUtils::Transpose(tempControlPoints, updatedControlPoints);
-		result.ControlPoints = updatedControlPoints;
-	}
-	else
-	{
-		for (int i = 0; i < controlPoints.size(); i++)
-		{
-			LN_NurbsCurve tc;
-			tc.Degree = degreeV;
-			tc.KnotVector = knotVectorV;
-			tc.ControlPoints = controlPoints[i];
-
-			LN_NurbsCurve newtc;
-			NurbsCurve::RemoveKnot(tc, removeKnot, times, newtc);
-			tempControlPoints.emplace_back(newtc.ControlPoints);
-			tempKnotVector = newtc.KnotVector;
-		}
-		result.KnotVectorU = knotVectorU;
-		result.KnotVectorV = tempKnotVector;
-		result.ControlPoints = tempControlPoints;
-	}
-}
-
-void LNLib::NurbsSurface::ElevateDegree(const LN_NurbsSurface& surface, int times, bool isUDirection, LN_NurbsSurface& result)
-{
-	int degreeU = surface.DegreeU;
-	int degreeV = surface.DegreeV;
-	std::vector<double> knotVectorU = surface.KnotVectorU;
-	std::vector<double> knotVectorV = surface.KnotVectorV;
-	std::vector<std::vector<XYZW>> controlPoints = surface.ControlPoints;
-
-	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
-
-	std::vector<double> tempKnotVector;
-	std::vector<std::vector<XYZW>> tempControlPoints;
-
-	if (isUDirection)
-	{
-		std::vector<std::vector<XYZW>> transposedControlPoints;
-		MathUtils::Transpose(controlPoints, transposedControlPoints);
-
-		for (int i = 0; i < transposedControlPoints.size(); i++)
-		{
-			LN_NurbsCurve tc;
-			tc.Degree = degreeU;
-			tc.KnotVector = knotVectorU;
-			tc.ControlPoints = transposedControlPoints[i];
-
-			LN_NurbsCurve newtc;
-
-			NurbsCurve::ElevateDegree(tc, times, newtc);
-			tempControlPoints.emplace_back(newtc.ControlPoints);
-			tempKnotVector = newtc.KnotVector;
-		}
-		result.DegreeU = degreeU + times;
-		result.DegreeV = degreeV;
-		result.KnotVectorU = tempKnotVector;
-		result.KnotVectorV = knotVectorV;
-		std::vector<std::vector<XYZW>> updatedControlPoints;
-		MathUtils::Transpose(tempControlPoints, updatedControlPoints);
-		result.ControlPoints = updatedControlPoints;
-	}
-	else
-	{
-		for (int i = 0; i < controlPoints.size(); i++)
-		{
-			LN_NurbsCurve tc;
-			tc.Degree = degreeV;
-			tc.KnotVector = knotVectorV;
-			tc.ControlPoints = controlPoints[i];
-
-			LN_NurbsCurve newtc;
-
-			NurbsCurve::ElevateDegree(tc, times, newtc);
-			tempControlPoints.emplace_back(newtc.ControlPoints);
-			tempKnotVector = newtc.KnotVector;
-		}
-		result.DegreeU = degreeU;
-		result.DegreeV = degreeV + times;
-		result.KnotVectorU = knotVectorU;
-		result.KnotVectorV = tempKnotVector;
-		result.ControlPoints = tempControlPoints;
-	}
-}
-
-bool LNLib::NurbsSurface::ReduceDegree(const LN_NurbsSurface& surface, bool isUDirection, LN_NurbsSurface& result)
-{
-	int degreeU = surface.DegreeU;
-	int degreeV = surface.DegreeV;
-	std::vector<double> knotVectorU = surface.KnotVectorU;
-	std::vector<double> knotVectorV = surface.KnotVectorV;
-	std::vector<std::vector<XYZW>> controlPoints = surface.ControlPoints;
+	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
 
 	std::vector<double> tempKnotVector;
 	std::vector<std::vector<XYZW>> tempControlPoints;
 
+	result = surface;
+
 	if (isUDirection)
 	{
 		std::vector<std::vector<XYZW>> transposedControlPoints;
@@ -948,16 +1352,10 @@ bool LNLib::NurbsSurface::ReduceDegree(const LN_NurbsSurface& surface, bool isUD
 
 			LN_NurbsCurve newtc;
 
-			bool result = NurbsCurve::ReduceDegree(tc, newtc);
-			if (!result)
-			{
-				return false;
-			}
+			NurbsCurve::RemoveKnot(tc, removeKnot, times, newtc);
 			tempControlPoints.emplace_back(newtc.ControlPoints);
 			tempKnotVector = newtc.KnotVector;
 		}
-		result.DegreeU = degreeU - 1;
-		result.DegreeV = degreeV;
 		result.KnotVectorU = tempKnotVector;
 		result.KnotVectorV = knotVectorV;
 		std::vector<std::vector<XYZW>> updatedControlPoints;
@@ -966,7 +1364,6 @@ bool LNLib::NurbsSurface::ReduceDegree(const LN_NurbsSurface& surface, bool isUD
 	}
 	else
 	{
-		std::vector<XYZW> temp;
 		for (int i = 0; i < controlPoints.size(); i++)
 		{
 			LN_NurbsCurve tc;
@@ -975,21 +1372,117 @@ bool LNLib::NurbsSurface::ReduceDegree(const LN_NurbsSurface& surface, bool isUD
 			tc.ControlPoints = controlPoints[i];
 
 			LN_NurbsCurve newtc;
-
-			bool result = NurbsCurve::ReduceDegree(tc, newtc);
-			if (!result)
-			{
-				return false;
-			}
+			NurbsCurve::RemoveKnot(tc, removeKnot, times, newtc);
 			tempControlPoints.emplace_back(newtc.ControlPoints);
 			tempKnotVector = newtc.KnotVector;
 		}
-		result.DegreeU = degreeU;
-		result.DegreeV = degreeV - 1;
 		result.KnotVectorU = knotVectorU;
 		result.KnotVectorV = tempKnotVector;
 		result.ControlPoints = tempControlPoints;
 	}
+}
+
+void LNLib::NurbsSurface::ElevateDegree(const LN_NurbsSurface& surface, int times, bool isUDirection, LN_NurbsSurface& result)
+{
+	const std::vector<std::vector<XYZW>>& controlPoints = surface.ControlPoints;
+
+	VALIDATE_ARGUMENT(times > 0, "times", "Times must be greater than zero.");
+
+	int rows = controlPoints.size();
+	int columns = controlPoints[0].size();
+	int degree = isUDirection ? surface.DegreeU : surface.DegreeV;
+	const std::vector<double>& knotVector = isUDirection ? surface.KnotVectorU : surface.KnotVectorV;
+
+	// Coefficients and the new knots depend on the knots only, so they are shared by every row.
+	std::vector<std::vector<double>> bezalfs = Polynomials::GetDegreeElevationCoefficients(degree, times);
+	std::vector<double> elevatedKnotVector = KnotVectorUtils::GetElevatedKnotVector(knotVector, times);
+	int size = elevatedKnotVector.size() - degree - times - 1;
+
+	LN_NurbsSurface elevated;
+	elevated.DegreeU = isUDirection ? surface.DegreeU + times : surface.DegreeU;
+	elevated.DegreeV = isUDirection ? surface.DegreeV : surface.DegreeV + times;
+	elevated.KnotVectorU = isUDirection ? elevatedKnotVector : surface.KnotVectorU;
+	elevated.KnotVectorV = isUDirection ? surface.KnotVectorV : elevatedKnotVector;
+	if (isUDirection)
+	{
+		elevated.ControlPoints.assign(size, std::vector<XYZW>(columns));
+
+		// Every step combines whole rows, so blocks of columns are elevated in parallel.
+		const int blockSize = 64;
+		int blocks = (columns + blockSize - 1) / blockSize;
+		ThreadUtils::ParallelFor(0, blocks, [&](int block)
+			{
+				int first = block * blockSize;
+				int count = std::min(blockSize, columns - first);
+				ControlPointsUtils::ElevateControlPoints(degree, knotVector, times, bezalfs, elevatedKnotVector, count,
+					[&](int i, int c) -> const XYZW& { return controlPoints[i][first + c]; },
+					[&](int i, int c) -> XYZW& { return elevated.ControlPoints[i][first + c]; });
+			});
+	}
+	else
+	{
+		elevated.ControlPoints.assign(rows, std::vector<XYZW>(size));
+		ThreadUtils::ParallelFor(0, rows, [&](int row)
+			{
+				ControlPointsUtils::ElevateControlPoints(degree, knotVector, times, bezalfs, elevatedKnotVector, 1,
+					[&](int i, int) -> const XYZW& { return controlPoints[row][i]; },
+					[&](int i, int) -> XYZW& { return elevated.ControlPoints[row][i]; });
+			}, 16);
+	}
+	result = std::move(elevated);
+}
+
+bool LNLib::NurbsSurface::ReduceDegree(const LN_NurbsSurface& surface, bool isUDirection, LN_NurbsSurface& result)
+{
+	const std::vector<std::vector<XYZW>>& controlPoints = surface.ControlPoints;
+
+	int rows = controlPoints.size();
+	int columns = controlPoints[0].size();
+	int degree = isUDirection ? surface.DegreeU : surface.DegreeV;
+	const std::vector<double>& knotVector = isUDirection ? surface.KnotVectorU : surface.KnotVectorV;
+	int size = isUDirection ? rows : columns;
+	int lines = isUDirection ? columns : rows;
+	if (!ValidationUtils::IsValidBezier(degree, size)) return false;
+
+	LN_NurbsSurface reduced;
+	reduced.DegreeU = isUDirection ? surface.DegreeU - 1 : surface.DegreeU;
+	reduced.DegreeV = isUDirection ? surface.DegreeV : surface.DegreeV - 1;
+	std::vector<double> reducedKnotVector(knotVector.begin() + 1, knotVector.end() - 1);
+	reduced.KnotVectorU = isUDirection ? reducedKnotVector : surface.KnotVectorU;
+	reduced.KnotVectorV = isUDirection ? surface.KnotVectorV : reducedKnotVector;
+	if (isUDirection)
+	{
+		reduced.ControlPoints.assign(degree, std::vector<XYZW>(columns));
+	}
+	else
+	{
+		reduced.ControlPoints.assign(rows, std::vector<XYZW>(degree));
+	}
+
+	std::atomic<bool> isReduced(true);
+	ThreadUtils::ParallelFor(0, lines, [&](int line)
+		{
+			if (!isReduced) return;
+
+			std::vector<XYZW> points(size);
+			for (int i = 0; i < size; i++)
+			{
+				points[i] = isUDirection ? controlPoints[i][line] : controlPoints[line][i];
+			}
+			std::vector<XYZW> updatedPoints;
+			if (!ControlPointsUtils::ReduceBezierDegree(degree, points, updatedPoints))
+			{
+				isReduced = false;
+				return;
+			}
+			for (int i = 0; i < degree; i++)
+			{
+				(isUDirection ? reduced.ControlPoints[i][line] : reduced.ControlPoints[line][i]) = updatedPoints[i];
+			}
+		}, 16);
+
+	if (!isReduced) return false;
+	result = std::move(reduced);
 	return true;
 }
 
@@ -1101,20 +1594,8 @@ LNLib::UV LNLib::NurbsSurface::GetParamOnSurface(const LN_NurbsSurface& surface,
 	std::vector<std::vector<XYZW>> controlPoints = surface.ControlPoints;
 
 	double minValue = Constants::MaxDistance;
-
-	int maxIterations = 10;
 	UV param = UV(Constants::DoubleEpsilon, Constants::DoubleEpsilon);
 
-	double minUParam = knotVectorU[0];
-	double maxUParam = knotVectorU[knotVectorU.size() - 1];
-	double minVParam = knotVectorV[0];
-	double maxVParam = knotVectorV[knotVectorV.size() - 1];
-
-	double a = minUParam;
-	double b = maxUParam;
-	double c = minVParam;
-	double d = maxVParam;
-
 	bool isClosedU = IsClosed(surface, true);
 	bool isClosedV = IsClosed(surface, false);
 
@@ -1160,148 +1641,149 @@ LNLib::UV LNLib::NurbsSurface::GetParamOnSurface(const LN_NurbsSurface& surface,
 		}
 	}
 
-	int counters = 0;
-	while (counters < maxIterations)
-	{
-		std::vector<std::vector<XYZ>> derivatives = ComputeRationalSurfaceDerivatives(surface, 2, param);
-		XYZ difference = derivatives[0][0] - givenPoint;
-		double fa = derivatives[1][0].DotProduct(difference);
-		double fb = derivatives[0][1].DotProduct(difference);
+	GetParamByNewtonIteration(surface, givenPoint, knotVectorU[0], knotVectorU[knotVectorU.size() - 1], knotVectorV[0], knotVectorV[knotVectorV.size() - 1], isClosedU, isClosedV, param);
+	return param;
+}
 
-		double condition1 = difference.Length();
-		double condition2a = std::abs(fa / (derivatives[1][0].Length() * condition1));
-		double condition2b = std::abs(fb / (derivatives[0][1].Length() * condition1));
+LNLib::UV LNLib::NurbsSurface::GetParamOnSurface(const LN_NurbsSurface& surface, const XYZ& givenPoint, const UV& initialParam)
+{
+	const std::vector<double>& knotVectorU = surface.KnotVectorU;
+	const std::vector<double>& knotVectorV = surface.KnotVectorV;
+	VALIDATE_ARGUMENT_RANGE(initialParam.GetU(), knotVectorU[0], knotVectorU.back());
+	VALIDATE_ARGUMENT_RANGE(initialParam.GetV(), knotVectorV[0], knotVectorV.back());
 
-		if (condition1 < Constants::DistanceEpsilon &&
-			condition2a < Constants::DistanceEpsilon &&
-			condition2b < Constants::DistanceEpsilon)
-		{
-			return param;
-		}
+	double a, b, c, d;
+	KnotVectorUtils::GetNeighborhoodRange(surface.DegreeU, knotVectorU, initialParam.GetU(), a, b);
+	KnotVectorUtils::GetNeighborhoodRange(surface.DegreeV, knotVectorV, initialParam.GetV(), c, d);
 
-		XYZ Su = derivatives[1][0];
-		XYZ Sv = derivatives[0][1];
+	UV param = initialParam;
+	bool isConverged = GetParamByNewtonIteration(surface, givenPoint, a, b, c, d, false, false, param);
+	if (isConverged &&
+		!KnotVectorUtils::IsOnInteriorBound(surface.DegreeU, knotVectorU, param.GetU(), a, b) &&
+		!KnotVectorUtils::IsOnInteriorBound(surface.DegreeV, knotVectorV, param.GetV(), c, d) &&
+		IsAcceptedProjection(surface, givenPoint, param))
+	{
+		return param;
+	}
+	return GetParamOnSurface(surface, givenPoint);
+}
 
-		XYZ Suu = derivatives[2][0];
-		XYZ Svv = derivatives[0][2];
+void LNLib::NurbsSurface::GetParamsOnSurface(const LN_NurbsSurface& surface, const std::vector<XYZ>& givenPoints, std::vector<UV>& params, std::vector<double>& distances)
+{
+	int size = givenPoints.size();
+	params.resize(size);
+	distances.resize(size);
+	if (size == 0) return;
 
-		XYZ Suv, Svu = derivatives[1][1];
+	bool isClosedU = IsClosed(surface, true);
+	bool isClosedV = IsClosed(surface, false);
 
-		double fuv = -Su.DotProduct(difference);
-		double guv = -Sv.DotProduct(difference);
+	std::vector<XYZ> tessellatedPoints;
+	std::vector<UV> correspondingKnots;
+	EquallyTessellate(surface, tessellatedPoints, correspondingKnots);
+	const SurfaceSampleTree tree(std::move(tessellatedPoints), std::move(correspondingKnots));
+
+	double minU = surface.KnotVectorU[0];
+	double maxU = surface.KnotVectorU[surface.KnotVectorU.size() - 1];
+	double minV = surface.KnotVectorV[0];
+	double maxV = surface.KnotVectorV[surface.KnotVectorV.size() - 1];
+	ThreadUtils::ParallelFor(0, size, [&](int i)
+		{
+			const XYZ& givenPoint = givenPoints[i];
+			UV param = tree.GetNearestParam(givenPoint);
+			GetParamByNewtonIteration(surface, givenPoint, minU, maxU, minV, maxV, isClosedU, isClosedV, param);
+			params[i] = param;
+			distances[i] = GetPointOnSurface(surface, param).Distance(givenPoint);
+		}, 64);
+}
 
-		double fu = Su.DotProduct(Su) + difference.DotProduct(Suu);
-		double fv = Su.DotProduct(Sv) + difference.DotProduct(Suv);
-		double gu = Su.DotProduct(Sv) + difference.DotProduct(Svu);
-		double gv = Sv.DotProduct(Sv) + difference.DotProduct(Svv);
+void LNLib::NurbsSurface::Reparametrize(const LN_NurbsSurface& surface, double minU, double maxU, double minV, double maxV, LN_NurbsSurface& result)
+{
+	const std::vector<double>& knotVectorU = surface.KnotVectorU;
+	const std::vector<double>& knotVectorV = surface.KnotVectorV;
 
-		if (MathUtils::IsAlmostEqualTo(fu * gv, fv * gu))
-		{
-			counters++;
-			continue;
-		}
+	if ((MathUtils::IsAlmostEqualTo(minU, knotVectorU[0]) && MathUtils::IsAlmostEqualTo(maxU, knotVectorU[knotVectorU.size() - 1])) &&
+		(MathUtils::IsAlmostEqualTo(minV, knotVectorV[0]) && MathUtils::IsAlmostEqualTo(maxV, knotVectorV[knotVectorV.size() - 1])))
+	{
+		result = surface;
+		return;
+	}
 
-		double deltaU = ((-fuv * gv) - fv * (-guv)) / (fu * gv - fv * gu);
-		double deltaV = (fu * (-guv) - (-fuv) * gu) / (fu * gv - fv * gu);
+	std::vector<double> newKnotVectorU = KnotVectorUtils::Rescale(knotVectorU, minU, maxU);
+	std::vector<double> newKnotVectorV = KnotVectorUtils::Rescale(knotVectorV, minV, maxV);
+	
+	result.DegreeU = surface.DegreeU;
+	result.DegreeV = surface.DegreeV;
+	result.ControlPoints = surface.ControlPoints;
+	result.KnotVectorU = std::move(newKnotVectorU);
+	result.KnotVectorV = std::move(newKnotVectorV);
+}
 
-		UV delta = UV(deltaU, deltaV);
-		UV temp = param + delta;
+void LNLib::NurbsSurface::Reparametrize(const LN_NurbsSurface& surface, double minU, double maxU, double minV, double maxV, LN_SurfaceView& view)
+{
+	VALIDATE_ARGUMENT(maxU > minU, "maxU", "MaxU must be greater than minU.");
+	VALIDATE_ARGUMENT(maxV > minV, "maxV", "MaxV must be greater than minV.");
 
-		if (!isClosedU)
-		{
-			if (param[0] < a)
-			{
-				param = UV(a, param[1]);
-			}
-			if (param[0] > b)
-			{
-				param = UV(b, param[1]);
-			}
-		}
-		if (!isClosedV)
-		{
-			if (param[1] < c)
-			{
-				param = UV(param[0], c);
-			}
-			if (param[1] > d)
-			{
-				param = UV(param[0], d);
-			}
-		}
-		if (isClosedU)
-		{
-			if (param[0] < a)
-			{
-				param = UV(b - (a - param[0]), param[1]);
-			}
-			if (param[0] > b)
-			{
-				param = UV(a + (param[0] - b), param[1]);
-			}
-		}
-		if (isClosedV)
-		{
-			if (param[1] < c)
-			{
-				param = UV(param[0], d - (c - param[1]));
-			}
-			if (param[1] > d)
-			{
-				param = UV(param[0], c + (param[1] - d));
-			}
-		}
+	const std::vector<double>& knotVectorU = surface.KnotVectorU;
+	const std::vector<double>& knotVectorV = surface.KnotVectorV;
+	double startU = knotVectorU[0];
+	double startV = knotVectorV[0];
 
-		double condition4a = ((temp[0] - param[0]) * derivatives[1][0]).Length();
-		double condition4b = ((temp[1] - param[1]) * derivatives[0][1]).Length();
-		if (condition4a + condition4b < Constants::DistanceEpsilon) {
-			return param;
-		}
+	view.Surface = &surface;
+	view.MapU.Scale = (knotVectorU[knotVectorU.size() - 1] - startU) / (maxU - minU);
+	view.MapU.Offset = startU - view.MapU.Scale * minU;
+	view.MapV.Scale = (knotVectorV[knotVectorV.size() - 1] - startV) / (maxV - minV);
+	view.MapV.Offset = startV - view.MapV.Scale * minV;
+}
 
-		param = temp;
-		double u = param.GetU();
-		double v = param.GetV();
+LNLib::XYZ LNLib::NurbsSurface::GetPointOnSurface(const LN_SurfaceView& view, UV uv)
+{
+	UV mapped(view.MapU.Scale * uv.GetU() + view.MapU.Offset, view.MapV.Scale * uv.GetV() + view.MapV.Offset);
+	return GetPointOnSurface(*view.Surface, mapped);
+}
 
-		if (MathUtils::IsLessThan(u, minUParam))
-		{
-			param = UV(minUParam, param.GetV());
-		}
-		if (MathUtils::IsGreaterThan(u, maxUParam))
-		{
-			param = UV(maxUParam, param.GetV());
-		}
+std::vector<std::vector<LNLib::XYZ>> LNLib::NurbsSurface::ComputeRationalSurfaceDerivatives(const LN_SurfaceView& view, int derivative, UV uv)
+{
+	UV mapped(view.MapU.Scale * uv.GetU() + view.MapU.Offset, view.MapV.Scale * uv.GetV() + view.MapV.Offset);
+	std::vector<std::vector<XYZ>> derivatives = ComputeRationalSurfaceDerivatives(*view.Surface, derivative, mapped);
 
-		if (MathUtils::IsLessThan(v, minVParam))
-		{
-			param = UV(param.GetU(), minVParam);
-		}
-		if (MathUtils::IsGreaterThan(v, maxUParam))
+	double factorU = 1.0;
+	for (int k = 0; k <= derivative; k++)
+	{
+		double factor = factorU;
+		for (int l = 0; l <= derivative - k; l++)
 		{
-			param = UV(param.GetU(), maxUParam);
+			derivatives[k][l] *= factor;
+			factor *= view.MapV.Scale;
 		}
-		counters++;
+		factorU *= view.MapU.Scale;
 	}
-	return param;
+	return derivatives;
 }
 
-void LNLib::NurbsSurface::Reparametrize(const LN_NurbsSurface& surface, double minU, double maxU, double minV, double maxV, LN_NurbsSurface& result)
+void LNLib::NurbsSurface::CreateTransformed(const LN_NurbsSurface& surface, const Matrix4d& matrix, LN_NurbsSurface& result)
 {
-	std::vector<double> knotVectorU = surface.KnotVectorU;
-	std::vector<double> knotVectorV = surface.KnotVectorV;
-
-	if ((MathUtils::IsAlmostEqualTo(minU, knotVectorU[0]) && MathUtils::IsAlmostEqualTo(maxU, knotVectorU[knotVectorU.size() - 1])) ||
-		(MathUtils::IsAlmostEqualTo(minV, knotVectorV[0]) && MathUtils::IsAlmostEqualTo(maxV, knotVectorV[knotVectorV.size() - 1])))
-	{
-		result = surface;
-		return;
-	}
+	int rows = surface.ControlPoints.size();
+	CopyTransformedHeader(surface, result);
+	ThreadUtils::ParallelFor(0, rows, [&](int i)
+		{
+			TransformRow(surface, matrix, i, result);
+		}, 16);
+}
 
-	std::vector<double> newKnotVectorU = KnotVectorUtils::Rescale(knotVectorU, minU, maxU);
-	std::vector<double> newKnotVectorV = KnotVectorUtils::Rescale(knotVectorV, minV, maxV);
-	
-	result = surface;
-	result.KnotVectorU = newKnotVectorU;
-	result.KnotVectorV = newKnotVectorV;
+void LNLib::NurbsSurface::CreateTransformed(const std::vector<LN_NurbsSurface>& surfaces, const Matrix4d& matrix, std::vector<LN_NurbsSurface>& result)
+{
+	int count = surfaces.size();
+	result.resize(count);
+	ThreadUtils::ParallelFor(0, count, [&](int k)
+		{
+			const LN_NurbsSurface& surface = surfaces[k];
+			CopyTransformedHeader(surface, result[k]);
+			for (int i = 0; i < surface.ControlPoints.size(); i++)
+			{
+				TransformRow(surface, matrix, i, result[k]);
+			}
+		}, 16);
 }
 
 bool LNLib::NurbsSurface::GetUVTangent(const LN_NurbsSurface& surface, const UV param, const XYZ& tangent, UV& uvTangent)
@@ -1566,7 +2048,7 @@ bool LNLib::NurbsSurface::CreateRevolvedSurface(const XYZ& origin, const XYZ& ax
 		XYZ O = Projection::PointToRay(origin, axis, p);
 		X = p - O;
 
-		r = X.Normalize().Length();
+		r = X.Length();
 		Y = axis.CrossProduct(X);
 
 		if (MathUtils::IsGreaterThan(r, 0.0))
@@ -1807,37 +2289,20 @@ void LNLib::NurbsSurface::GlobalInterpolation(const std::vector<std::vector<XYZ>
 	int rows = throughPoints.size();
 	int cols = throughPoints[0].size();
 
-	std::vector<std::vector<XYZW>> controlPoints(rows, std::vector<XYZW>(cols));
 	std::vector<double> knotVectorU = Interpolation::AverageKnotVector(degreeU, uk);
 	std::vector<double> knotVectorV = Interpolation::AverageKnotVector(degreeV, vl);
 
-	for (int j = 0; j < cols; j++)
-	{
-		std::vector<XYZ> temp(rows);
-		for (int i = 0; i < rows; i++)
-		{
-			temp[i] = throughPoints[i][j];
-		}
-		LN_NurbsCurve tc;
-		NurbsCurve::GlobalInterpolation(degreeU, temp, tc);
-		for (int i = 0; i < rows; i++)
-		{
-			controlPoints[i][j] = tc.ControlPoints[i];
-		}
-	}
+	std::vector<std::vector<XYZ>> R = InterpolateColumns(degreeU, knotVectorU, uk, throughPoints);
+	std::vector<std::vector<XYZ>> transposedR;
+	MathUtils::Transpose(R, transposedR);
+	std::vector<std::vector<XYZ>> P = InterpolateColumns(degreeV, knotVectorV, vl, transposedR);
 
+	std::vector<std::vector<XYZW>> controlPoints(rows, std::vector<XYZW>(cols));
 	for (int i = 0; i < rows; i++)
 	{
-		std::vector<XYZ> temp(cols);
-		for (int j = 0; j < cols; j++)
-		{
-			temp[j] = throughPoints[i][j];
-		}
-		LN_NurbsCurve tc;
-		NurbsCurve::GlobalInterpolation(degreeV, temp, tc);
 		for (int j = 0; j < cols; j++)
 		{
-			controlPoints[i][j] = tc.ControlPoints[j];
+			controlPoints[i][j] = XYZW(P[j][i], 1.0);
 		}
 	}
 	surface.DegreeU = degreeU;
@@ -2075,14 +2540,14 @@ bool LNLib::NurbsSurface::GlobalApproximation(const std::vector<std::vector<XYZ>
 	std::vector<std::vector<XYZW>> controlPoints;
 
 	std::vector<std::vector<XYZ>> tempControlPoints;
-	for (int i = 0; i < rows; i++)
+	for (int i = 0; i < throughPoints.size(); i++)
 	{
 		LN_NurbsCurve tc;
-		bool result = NurbsCurve::LeastSquaresApproximation(degreeU, throughPoints[i], rows, tc);
+		bool result = NurbsCurve::LeastSquaresApproximation(degreeV, throughPoints[i], columns, tc);
 		if (!result) return false;
 		std::vector<XYZ> points = ControlPointsUtils::ToXYZ(tc.ControlPoints);
 		tempControlPoints.emplace_back(points);
-		knotVectorU = tc.KnotVector;
+		knotVectorV = tc.KnotVector;
 	}
 
 	std::vector<std::vector<XYZ>> preControlPoints;
@@ -2091,11 +2556,11 @@ bool LNLib::NurbsSurface::GlobalApproximation(const std::vector<std::vector<XYZ>
 	{
 		std::vector<XYZ> c = MathUtils::GetColumn(tempControlPoints, i);
 		LN_NurbsCurve tc;
-		bool result = NurbsCurve::LeastSquaresApproximation(degreeV, c, columns, tc);
+		bool result = NurbsCurve::LeastSquaresApproximation(degreeU, c, rows, tc);
 		if (!result) return false;
 		std::vector<XYZ> points = ControlPointsUtils::ToXYZ(tc.ControlPoints);
 		tPoints.emplace_back(points);
-		knotVectorV = tc.KnotVector;
+		knotVectorU = tc.KnotVector;
 	}
 	MathUtils::Transpose(tPoints, preControlPoints);
 	controlPoints = ControlPointsUtils::ToXYZW(preControlPoints);
@@ -2108,6 +2573,179 @@ bool LNLib::NurbsSurface::GlobalApproximation(const std::vector<std::vector<XYZ>
 	return true;
 }
 
+bool LNLib::NurbsSurface::GlobalApproximation(const std::vector<std::vector<XYZ>>& throughPoints, int degreeU, int degreeV, int controlPointsRows, int controlPointsColumns, int maxIterations, double tolerance, LN_NurbsSurface& surface, LN_FittingReport& report)
+{
+	VALIDATE_ARGUMENT(maxIterations >= 0, "maxIterations", "MaxIterations must be greater than or equal zero.");
+	VALIDATE_ARGUMENT(tolerance >= 0.0, "tolerance", "Tolerance must not be negative.");
+
+	if (!GlobalApproximation(throughPoints, degreeU, degreeV, controlPointsRows, controlPointsColumns, surface))
+	{
+		return false;
+	}
+
+	std::vector<double> uk;
+	std::vector<double> vl;
+	Interpolation::GetSurfaceMeshParameterization(throughPoints, uk, vl);
+
+	int rows = throughPoints.size();
+	int columns = throughPoints[0].size();
+	int count = rows * columns;
+	std::vector<XYZ> points(count);
+	std::vector<UV> params(count);
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			points[i * columns + j] = throughPoints[i][j];
+			params[i * columns + j] = UV(uk[i], vl[j]);
+		}
+	}
+
+	std::vector<double> distances(count);
+	std::vector<char> isFitted(std::max(rows, controlPointsColumns));
+	report.MaxErrors.clear();
+	report.RmsErrors.clear();
+	std::vector<std::vector<XYZW>> bestControlPoints = surface.ControlPoints;
+	double bestMaxError = Constants::MaxDistance;
+	for (int iteration = 0; ; iteration++)
+	{
+		// Newton steps from the current parameters only, a point whose step does not converge keeps its parameter.
+		ThreadUtils::ParallelFor(0, count, [&](int i)
+			{
+				double a, b, c, d;
+				KnotVectorUtils::GetNeighborhoodRange(surface.DegreeU, surface.KnotVectorU, params[i].GetU(), a, b);
+				KnotVectorUtils::GetNeighborhoodRange(surface.DegreeV, surface.KnotVectorV, params[i].GetV(), c, d);
+				UV param = params[i];
+				if (GetParamByNewtonIteration(surface, points[i], a, b, c, d, false, false, param))
+				{
+					params[i] = param;
+				}
+				distances[i] = GetPointOnSurface(surface, params[i]).Distance(points[i]);
+			}, 64);
+
+		double maxError = 0.0;
+		double squareSum = 0.0;
+		for (int i = 0; i < count; i++)
+		{
+			maxError = std::max(maxError, distances[i]);
+			squareSum += distances[i] * distances[i];
+		}
+		report.MaxErrors.emplace_back(maxError);
+		report.RmsErrors.emplace_back(std::sqrt(squareSum / count));
+
+		// A refit may increase the error, so only the best fit so far is kept.
+		if (maxError < bestMaxError)
+		{
+			bestMaxError = maxError;
+			bestControlPoints = surface.ControlPoints;
+		}
+
+		if (iteration == maxIterations) break;
+		if (iteration > 0 && report.MaxErrors[iteration - 1] - maxError < tolerance) break;
+
+		// Refit by the same row and column solve as the first fit, interpolating the boundary points,
+		// at grid parameters averaged from the projections.
+		for (int i = 1; i < rows - 1; i++)
+		{
+			double sum = 0.0;
+			for (int j = 0; j < columns; j++)
+			{
+				sum += params[i * columns + j].GetU();
+			}
+			uk[i] = sum / columns;
+		}
+		for (int j = 1; j < columns - 1; j++)
+		{
+			double sum = 0.0;
+			for (int i = 0; i < rows; i++)
+			{
+				sum += params[i * columns + j].GetV();
+			}
+			vl[j] = sum / rows;
+		}
+
+		std::vector<std::vector<XYZ>> rowControlPoints(rows);
+		ThreadUtils::ParallelFor(0, rows, [&](int i)
+			{
+				LN_NurbsCurve tc;
+				isFitted[i] = NurbsCurve::LeastSquaresApproximation(degreeV, throughPoints[i], vl, surface.KnotVectorV, tc);
+				rowControlPoints[i] = ControlPointsUtils::ToXYZ(tc.ControlPoints);
+			});
+		if (std::find(isFitted.begin(), isFitted.begin() + rows, 0) != isFitted.begin() + rows) break;
+
+		std::vector<std::vector<XYZW>> controlPoints(controlPointsRows, std::vector<XYZW>(controlPointsColumns));
+		ThreadUtils::ParallelFor(0, controlPointsColumns, [&](int j)
+			{
+				LN_NurbsCurve tc;
+				isFitted[j] = NurbsCurve::LeastSquaresApproximation(degreeU, MathUtils::GetColumn(rowControlPoints, j), uk, surface.KnotVectorU, tc);
+				if (!isFitted[j]) return;
+				for (int i = 0; i < controlPointsRows; i++)
+				{
+					controlPoints[i][j] = tc.ControlPoints[i];
+				}
+			});
+		if (std::find(isFitted.begin(), isFitted.begin() + controlPointsColumns, 0) != isFitted.begin() + controlPointsColumns) break;
+		surface.ControlPoints = std::move(controlPoints);
+	}
+	surface.ControlPoints = std::move(bestControlPoints);
+	return true;
+}
+
+bool LNLib::NurbsSurface::ScatteredApproximation(const std::vector<XYZ>& points, const LN_NurbsSurface& baseSurface, int degreeU, int degreeV, int controlPointsRows, int controlPointsColumns, double smoothing, LN_NurbsSurface& surface)
+{
+	VALIDATE_ARGUMENT(points.size() > 0, "points", "Points size must be greater than zero.");
+	VALIDATE_ARGUMENT(degreeU > 0 && degreeU <= Constants::NURBSMaxDegree, "degreeU", "DegreeU must be greater than zero and not exceed the maximun degree.");
+	VALIDATE_ARGUMENT(degreeV > 0 && degreeV <= Constants::NURBSMaxDegree, "degreeV", "DegreeV must be greater than zero and not exceed the maximun degree.");
+	VALIDATE_ARGUMENT(controlPointsRows > degreeU, "controlPointsRows", "ControlPointsRows must be greater than degreeU.");
+	VALIDATE_ARGUMENT(controlPointsColumns > degreeV, "controlPointsColumns", "ControlPointsColumns must be greater than degreeV.");
+	VALIDATE_ARGUMENT(smoothing >= 0.0, "smoothing", "Smoothing must not be negative.");
+
+	int rows = controlPointsRows;
+	int columns = controlPointsColumns;
+
+	const std::vector<double>& baseKnotVectorU = baseSurface.KnotVectorU;
+	const std::vector<double>& baseKnotVectorV = baseSurface.KnotVectorV;
+	double startU = baseKnotVectorU[0];
+	double endU = baseKnotVectorU[baseKnotVectorU.size() - 1];
+	double startV = baseKnotVectorV[0];
+	double endV = baseKnotVectorV[baseKnotVectorV.size() - 1];
+
+	// Parameterize by batch projection, seeded from the sample tree of baseSurface.
+	std::vector<UV> params;
+	std::vector<double> distances;
+	GetParamsOnSurface(baseSurface, points, params, distances);
+
+	auto uniformKnotVector = [](int degree, int controlPointsCount, double start, double end)
+	{
+		std::vector<double> knotVector(controlPointsCount + degree + 1, end);
+		int spans = controlPointsCount - degree;
+		for (int i = 0; i <= degree; i++)
+		{
+			knotVector[i] = start;
+		}
+		for (int i = 1; i < spans; i++)
+		{
+			knotVector[degree + i] = start + (end - start) * i / spans;
+		}
+		return knotVector;
+	};
+	std::vector<double> knotVectorU = uniformKnotVector(degreeU, rows, startU, endU);
+	std::vector<double> knotVectorV = uniformKnotVector(degreeV, columns, startV, endV);
+
+	std::vector<std::vector<XYZW>> controlPoints;
+	if (!FitScatteredPoints(points, params, degreeU, degreeV, knotVectorU, knotVectorV, smoothing, controlPoints))
+	{
+		return false;
+	}
+
+	surface.DegreeU = degreeU;
+	surface.DegreeV = degreeV;
+	surface.KnotVectorU = knotVectorU;
+	surface.KnotVectorV = knotVectorV;
+	surface.ControlPoints = controlPoints;
+	return true;
+}
+
 bool LNLib::NurbsSurface::CreateSwungSurface(const LN_NurbsCurve& profile, const LN_NurbsCurve& trajectory, double scale, LN_NurbsSurface& surface)
 {
 	int pDegree = profile.Degree;
@@ -2210,34 +2848,16 @@ bool LNLib::NurbsSurface::CreateSwungSurface(const LN_NurbsCurve& profile, const
 
 void LNLib::NurbsSurface::CreateLoftSurface(const std::vector<LN_NurbsCurve>& sections, LN_NurbsSurface& surface, int customTrajectoryDegree, const std::vector<double>& customTrajectoryKnotVector)
 {
-	int degree_max = 0;
-	for (int k = 0; k < sections.size(); k++)
-	{
-		LN_NurbsCurve current = sections[k];
-		if (degree_max < current.Degree)
-		{
-			degree_max = current.Degree;
-		}
-	}
-
 	int size = sections.size();
 
-	std::vector<LN_NurbsCurve> internals(size);
+	std::vector<LN_NurbsCurve> internals;
+	NurbsCurve::MakeCompatible(sections, internals);
+	int degree_max = internals[0].Degree;
+
 	std::vector<std::vector<XYZW>> curvesControlPoints(size);
 	for (int k = 0; k < size; k++)
-	{
-		LN_NurbsCurve current = sections[k];
-		if (degree_max > current.Degree)
-		{
-			int times = degree_max - current.Degree;
-			LN_NurbsCurve tc;
-			NurbsCurve::ElevateDegree(current, times, tc);
-			current.Degree = degree_max;
-			current.KnotVector = tc.KnotVector;
-			current.ControlPoints = tc.ControlPoints;
-		}
-		curvesControlPoints[k] = current.ControlPoints;
-		internals[k] = current;
+	{
+		curvesControlPoints[k] = std::move(internals[k].ControlPoints);
 	}
 
 	int degreeU = degree_max;
@@ -2278,28 +2898,24 @@ void LNLib::NurbsSurface::CreateLoftSurface(const std::vector<LN_NurbsCurve>& se
 		vl = customTrajectoryKnotVector;
 	}
 	std::vector<double> knotVectorV = Interpolation::AverageKnotVector(degreeV, vl);
-	std::vector<std::vector<XYZW>> controlPoints;
 	int column = curvesControlPoints[0].size();
-	for (int c = 0; c < column; c++)
+	std::vector<std::vector<XYZ>> points(size, std::vector<XYZ>(column));
+	for (int k = 0; k < size; k++)
 	{
-		std::vector<XYZ> temp(size);
-		std::vector<double> weightCache(size);
-		for (int k = 0; k < size; k++)
+		for (int c = 0; c < column; c++)
 		{
-			XYZW cp = curvesControlPoints[k][c];
-			double w = cp.GetW();
-			weightCache[k] = w;
-			temp[k] = XYZ(cp.GetWX() / w, cp.GetWY() / w, cp.GetWZ() / w);
+			points[k][c] = curvesControlPoints[k][c].ToXYZ(true);
 		}
-		LN_NurbsCurve tc;
-		NurbsCurve::GlobalInterpolation(degreeV, temp, tc, vl);
-		for (int i = 0; i < tc.ControlPoints.size(); i++)
+	}
+	std::vector<std::vector<XYZ>> result = InterpolateColumns(degreeV, knotVectorV, vl, points);
+
+	std::vector<std::vector<XYZW>> controlPoints(column, std::vector<XYZW>(size));
+	for (int c = 0; c < column; c++)
+	{
+		for (int k = 0; k < size; k++)
 		{
-			XYZW cp = tc.ControlPoints[i];
-			double w = cp.GetW();
-			tc.ControlPoints[i] = XYZW(XYZ(cp.GetWX() / w, cp.GetWY() / w, cp.GetWZ() / w), weightCache[i]);
+			controlPoints[c][k] = XYZW(result[k][c], curvesControlPoints[k][c].GetW());
 		}
-		controlPoints.emplace_back(tc.ControlPoints);
 	}
 
 	surface.DegreeU = degreeU;
@@ -2473,251 +3089,150 @@ void LNLib::NurbsSurface::CreateSweepSurface(const LN_NurbsCurve& profile, const
 
 void LNLib::NurbsSurface::CreateGordonSurface(const std::vector<LN_NurbsCurve>& uCurves, const std::vector<LN_NurbsCurve>& vCurves, const std::vector<std::vector<XYZ>>& intersectionPoints, LN_NurbsSurface& surface)
 {
-	int degree_u_max = 0;
-	for (int i = 0; i < uCurves.size(); i++)
-	{
-		LN_NurbsCurve current = uCurves[i];
-		if (current.Degree > degree_u_max)
-		{
-			degree_u_max = current.Degree;
-		}
-	}
+	int rows = intersectionPoints.size();
+	VALIDATE_ARGUMENT(rows > 1 && rows == uCurves.size(), "intersectionPoints", "IntersectionPoints must have one row per U-curve.");
+	int columns = intersectionPoints[0].size();
+	VALIDATE_ARGUMENT(columns > 1 && columns == vCurves.size(), "intersectionPoints", "IntersectionPoints must have one column per V-curve.");
 
 	std::vector<LN_NurbsCurve> uInternals;
-	for (int i = 0; i < uCurves.size(); i++)
-	{
-		LN_NurbsCurve current;
-		NurbsCurve::Reparametrize(uCurves[i], 0, 1, current);
-
-		if (degree_u_max > current.Degree)
-		{
-			int times = degree_u_max - current.Degree;
-			LN_NurbsCurve tc;
-			NurbsCurve::ElevateDegree(current, times, tc);
-			uInternals.emplace_back(tc);
-		}
-		else
-		{
-			uInternals.emplace_back(current);
-		}
-	}
-
-	std::vector<std::vector<double>> knotVectorsU;
-	for (int i = 0; i < uInternals.size(); i++)
-	{
-		knotVectorsU.emplace_back(uInternals[i].KnotVector);
-	}
-	auto insertElements = KnotVectorUtils::GetInsertedKnotElements(knotVectorsU);
-	for (int i = 0; i < uInternals.size(); i++)
-	{
-		auto insertElement = insertElements[i];
-		if (insertElement.size() > 0)
-		{
-			LN_NurbsCurve tc;
-			NurbsCurve::RefineKnotVector(uInternals[i], insertElement, tc);
-			uInternals[i] = tc;
-		}
-	}
-
-	int degree_v_max = 0;
-	for (int i = 0; i < vCurves.size(); i++)
+	std::vector<LN_NurbsCurve> vInternals;
+	NurbsCurve::MakeCompatible(uCurves, uInternals);
+	NormalizeKnotVectors(uInternals);
+	NurbsCurve::MakeCompatible(vCurves, vInternals);
+	NormalizeKnotVectors(vInternals);
+
+	// V-curve j lies at ul[j] along the U-curves and U-curve i at vl[i] along the V-curves.
+	// Skinning and the interpolant share these parameters, so the three surfaces cancel on the curves.
+	std::vector<double> ul(columns, 0.0);
+	std::vector<double> vl(rows, 0.0);
+	for (int i = 0; i < rows; i++)
 	{
-		LN_NurbsCurve current = vCurves[i];
-		if (current.Degree > degree_v_max)
+		LN_CurveProjection projection;
+		NurbsCurve::CreateProjection(uInternals[i], projection);
+		std::vector<double> params;
+		std::vector<double> distances;
+		NurbsCurve::GetParamsOnCurve(projection, intersectionPoints[i], params, distances);
+		for (int j = 0; j < columns; j++)
 		{
-			degree_v_max = current.Degree;
+			ul[j] += params[j] / rows;
 		}
 	}
-
-	std::vector<LN_NurbsCurve> vInternals;
-	for (int i = 0; i < vCurves.size(); i++)
+	for (int j = 0; j < columns; j++)
 	{
-		LN_NurbsCurve current;
-		NurbsCurve::Reparametrize(vCurves[i], 0, 1, current);
-		if (degree_v_max > current.Degree)
-		{
-			int times = degree_v_max - current.Degree;
-			LN_NurbsCurve tc;
-			NurbsCurve::ElevateDegree(current, times, tc);
-			vInternals.emplace_back(tc);
-		}
-		else
+		std::vector<XYZ> points(rows);
+		for (int i = 0; i < rows; i++)
 		{
-			vInternals.emplace_back(current);
+			points[i] = intersectionPoints[i][j];
 		}
-	}
-
-	std::vector<std::vector<double>> knotVectorsV;
-	for (int i = 0; i < vInternals.size(); i++)
-	{
-		knotVectorsV.emplace_back(vInternals[i].KnotVector);
-	}
-	insertElements = KnotVectorUtils::GetInsertedKnotElements(knotVectorsV);
-	for (int i = 0; i < vInternals.size(); i++)
-	{
-		auto insertElement = insertElements[i];
-		if (insertElement.size() > 0)
+		LN_CurveProjection projection;
+		NurbsCurve::CreateProjection(vInternals[j], projection);
+		std::vector<double> params;
+		std::vector<double> distances;
+		NurbsCurve::GetParamsOnCurve(projection, points, params, distances);
+		for (int i = 0; i < rows; i++)
 		{
-			LN_NurbsCurve tc;
-			NurbsCurve::RefineKnotVector(vInternals[i], insertElement, tc);
-			vInternals[i] = tc;
+			vl[i] += params[i] / columns;
 		}
 	}
+	ul.front() = vl.front() = 0.0;
+	ul.back() = vl.back() = 1.0;
 
-	int rows = intersectionPoints.size();
-	int columns = intersectionPoints[0].size();
-
-	LN_NurbsSurface loftSurfaceV;
-	CreateLoftSurface(uInternals, loftSurfaceV);
-	LN_NurbsSurface ts;
-	CreateLoftSurface(vInternals, ts);
-	std::vector<std::vector<XYZW>> transposedControlPoints;
-	MathUtils::Transpose(ts.ControlPoints, transposedControlPoints);
-	LN_NurbsSurface loftSurfaceU;
-	loftSurfaceU.DegreeU = ts.DegreeV;
-	loftSurfaceU.DegreeV = ts.DegreeU;
-	loftSurfaceU.KnotVectorU = ts.KnotVectorV;
-	loftSurfaceU.KnotVectorV = ts.KnotVectorU;
-	loftSurfaceU.ControlPoints = transposedControlPoints;
+	int degreeU = std::min(columns - 1, uInternals[0].Degree);
+	int degreeV = std::min(rows - 1, vInternals[0].Degree);
+	std::vector<double> knotVectorU = Interpolation::AverageKnotVector(degreeU, ul);
+	std::vector<double> knotVectorV = Interpolation::AverageKnotVector(degreeV, vl);
 
-	int degreeU = std::min(columns - 1, degree_u_max);
-	int degreeV = std::min(rows - 1, degree_v_max);
-	GlobalInterpolation(intersectionPoints, degreeU, degreeV, ts);
-	MathUtils::Transpose(ts.ControlPoints, transposedControlPoints);
-	LN_NurbsSurface interpolatedSurface;
-	Swap(ts, interpolatedSurface);
+	InterpolationFactors factorsU;
+	FactorInterpolation(degreeU, knotVectorU, ul, factorsU);
+	InterpolationFactors factorsV;
+	FactorInterpolation(degreeV, knotVectorV, vl, factorsV);
 
+	// The Boolean sum skinU + skinV - interpolant. SolveColumns spreads each solve over all threads.
+	std::vector<LN_NurbsSurface> surfaces(3);
+	// Skin of the U-curves along V.
 	{
-		int lsu_degreeU = loftSurfaceU.DegreeU;
-		int lsv_degreeU = loftSurfaceV.DegreeU;
-		int inp_degreeU = interpolatedSurface.DegreeU;
-
-		int degreeU = std::max(lsu_degreeU, std::max(lsv_degreeU, inp_degreeU));
-		if (degreeU > lsu_degreeU)
-		{
-			int times = degreeU - lsu_degreeU;
-			LN_NurbsSurface temp;
-			ElevateDegree(loftSurfaceU, times, true, temp);
-			loftSurfaceU = temp;
-		}
-
-		if (degreeU > lsv_degreeU)
-		{
-			int times = degreeU - lsv_degreeU;
-			LN_NurbsSurface temp;
-			ElevateDegree(loftSurfaceV, times, true, temp);
-			loftSurfaceV = temp;
-		}
-
-		if (degreeU > inp_degreeU)
-		{
-			int times = degreeU - inp_degreeU;
-			LN_NurbsSurface temp;
-			ElevateDegree(interpolatedSurface, times, true, temp);
-			interpolatedSurface = temp;
-		}
-
-		int lsu_degreeV = loftSurfaceU.DegreeV;
-		int lsv_degreeV = loftSurfaceV.DegreeV;
-		int inp_degreeV = interpolatedSurface.DegreeV;
-
-		int degreeV = std::max(lsu_degreeV, std::max(lsv_degreeV, inp_degreeV));
-		if (degreeV > lsu_degreeV)
-		{
-			int times = degreeV - lsu_degreeV;
-			LN_NurbsSurface temp;
-			ElevateDegree(loftSurfaceU, times, false, temp);
-			loftSurfaceU = temp;
-		}
-
-		if (degreeV > lsv_degreeV)
+		LN_NurbsSurface& skinU = surfaces[0];
+		int size = uInternals[0].ControlPoints.size();
+		std::vector<std::vector<XYZ>> points(rows, std::vector<XYZ>(size));
+		for (int i = 0; i < rows; i++)
 		{
-			int times = degreeV - lsv_degreeV;
-			LN_NurbsSurface temp;
-			ElevateDegree(loftSurfaceV, times, false, temp);
-			loftSurfaceV = temp;
+			for (int c = 0; c < size; c++)
+			{
+				points[i][c] = uInternals[i].ControlPoints[c].ToXYZ(true);
+			}
 		}
+		std::vector<std::vector<XYZ>> solved = SolveColumns(factorsV, points);
 
-		if (degreeV > inp_degreeV)
+		skinU.DegreeU = uInternals[0].Degree;
+		skinU.DegreeV = degreeV;
+		skinU.KnotVectorU = uInternals[0].KnotVector;
+		skinU.KnotVectorV = knotVectorV;
+		skinU.ControlPoints.assign(size, std::vector<XYZW>(rows));
+		for (int c = 0; c < size; c++)
 		{
-			int times = degreeV - inp_degreeV;
-			LN_NurbsSurface temp;
-			ElevateDegree(interpolatedSurface, times, false, temp);
-			interpolatedSurface = temp;
+			for (int i = 0; i < rows; i++)
+			{
+				skinU.ControlPoints[c][i] = XYZW(solved[i][c], uInternals[i].ControlPoints[c].GetW());
+			}
 		}
 	}
-
+	// Skin of the V-curves along U.
 	{
-		std::vector<std::vector<double>> knotVectorsU;
-		knotVectorsU.emplace_back(loftSurfaceU.KnotVectorU);
-		knotVectorsU.emplace_back(loftSurfaceV.KnotVectorU);
-		knotVectorsU.emplace_back(interpolatedSurface.KnotVectorU);
-
-		auto insertElements = KnotVectorUtils::GetInsertedKnotElements(knotVectorsU);
-		if (insertElements[0].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(loftSurfaceU, insertElements[0], true, temp);
-			loftSurfaceU = temp;
-		}
-		if (insertElements[1].size() > 0)
+		LN_NurbsSurface& skinV = surfaces[1];
+		int size = vInternals[0].ControlPoints.size();
+		std::vector<std::vector<XYZ>> points(columns, std::vector<XYZ>(size));
+		for (int j = 0; j < columns; j++)
 		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(loftSurfaceV, insertElements[1], true, temp);
-			loftSurfaceV = temp;
+			for (int c = 0; c < size; c++)
+			{
+				points[j][c] = vInternals[j].ControlPoints[c].ToXYZ(true);
+			}
 		}
-		if (insertElements[2].size() > 0)
+		std::vector<std::vector<XYZ>> solved = SolveColumns(factorsU, points);
+
+		skinV.DegreeU = degreeU;
+		skinV.DegreeV = vInternals[0].Degree;
+		skinV.KnotVectorU = knotVectorU;
+		skinV.KnotVectorV = vInternals[0].KnotVector;
+		skinV.ControlPoints.assign(columns, std::vector<XYZW>(size));
+		for (int j = 0; j < columns; j++)
 		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(interpolatedSurface, insertElements[2], true, temp);
-			interpolatedSurface = temp;
+			for (int c = 0; c < size; c++)
+			{
+				skinV.ControlPoints[j][c] = XYZW(solved[j][c], vInternals[j].ControlPoints[c].GetW());
+			}
 		}
 	}
-
+	// Interpolant of the intersection points.
 	{
-		std::vector<std::vector<double>> knotVectorsV;
-		knotVectorsV.emplace_back(loftSurfaceU.KnotVectorV);
-		knotVectorsV.emplace_back(loftSurfaceV.KnotVectorV);
-		knotVectorsV.emplace_back(interpolatedSurface.KnotVectorV);
-
-		auto insertElements = KnotVectorUtils::GetInsertedKnotElements(knotVectorsV);
-		if (insertElements[0].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(loftSurfaceU, insertElements[0], false, temp);
-			loftSurfaceU = temp;
-		}
-		if (insertElements[1].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(loftSurfaceV, insertElements[1], false, temp);
-			loftSurfaceV = temp;
-		}
-		if (insertElements[2].size() > 0)
+		LN_NurbsSurface& interpolant = surfaces[2];
+		std::vector<std::vector<XYZ>> points(columns, std::vector<XYZ>(rows));
+		for (int i = 0; i < rows; i++)
 		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(interpolatedSurface, insertElements[2], false, temp);
-			interpolatedSurface = temp;
+			for (int j = 0; j < columns; j++)
+			{
+				points[j][i] = intersectionPoints[i][j];
+			}
 		}
-	}
-
-	surface.DegreeU = interpolatedSurface.DegreeU;
-	surface.DegreeV = interpolatedSurface.DegreeV;
-	surface.KnotVectorU = interpolatedSurface.KnotVectorU;
-	surface.KnotVectorV = interpolatedSurface.KnotVectorV;
-
-	int row = interpolatedSurface.ControlPoints.size();
-	int column = interpolatedSurface.ControlPoints[0].size();
+		std::vector<std::vector<XYZ>> solvedU = SolveColumns(factorsU, points);
+		std::vector<std::vector<XYZ>> transposed;
+		MathUtils::Transpose(solvedU, transposed);
+		std::vector<std::vector<XYZ>> solved = SolveColumns(factorsV, transposed);
 
-	std::vector<std::vector<XYZW>> controlPoints(row, std::vector<XYZW>(column));
-	for (int i = 0; i < row; i++)
-	{
-		for (int j = 0; j < column; j++)
+		interpolant.DegreeU = degreeU;
+		interpolant.DegreeV = degreeV;
+		interpolant.KnotVectorU = knotVectorU;
+		interpolant.KnotVectorV = knotVectorV;
+		interpolant.ControlPoints.assign(columns, std::vector<XYZW>(rows));
+		for (int j = 0; j < columns; j++)
 		{
-			controlPoints[i][j] = loftSurfaceU.ControlPoints[i][j] + loftSurfaceV.ControlPoints[i][j] - interpolatedSurface.ControlPoints[i][j];
+			for (int i = 0; i < rows; i++)
+			{
+				interpolant.ControlPoints[j][i] = XYZW(solved[i][j], 1.0);
+			}
 		}
 	}
-	surface.ControlPoints = controlPoints;
+	CombineSurfaces(surfaces, surface);
 }
 
 void LNLib::NurbsSurface::CreateCoonsSurface(const LN_NurbsCurve& leftCurve, const LN_NurbsCurve& bottomCurve, const LN_NurbsCurve& rightCurve, const LN_NurbsCurve& topCurve, LN_NurbsSurface& surface)
@@ -2756,251 +3271,40 @@ void LNLib::NurbsSurface::CreateCoonsSurface(const LN_NurbsCurve& leftCurve, con
 	VALIDATE_ARGUMENT(isP00 & isP01 & isP10 & isP11, "Curves", "Four Corners must be connected.");
 
 
-	auto n0 = nurbs[0]; auto n2 = nurbs[2];
-	int degree_n0 = n0.Degree;
-	int degree_n2 = n2.Degree;
-	if (degree_n0 > degree_n2)
-	{
-		int times = degree_n0 - degree_n2;
-		LN_NurbsCurve tc;
-		NurbsCurve::ElevateDegree(n2, times, tc);
-		n2 = tc;
-	}
-	if (degree_n2 > degree_n0)
-	{
-		int times = degree_n2 - degree_n0;
-		LN_NurbsCurve tc;
-		NurbsCurve::ElevateDegree(n0, times, tc);
-		n0 = tc;
-	}
-	if (n0.KnotVector != n2.KnotVector)
-	{
-		std::vector<double> insertedKnotElement0;
-		std::vector<double> insertedKnotElement2;
-		KnotVectorUtils::GetInsertedKnotElement(n0.KnotVector, n2.KnotVector, insertedKnotElement0, insertedKnotElement2);
-
-		if (insertedKnotElement0.size() > 0)
-		{
-			LN_NurbsCurve tc;
-			NurbsCurve::RefineKnotVector(n0, insertedKnotElement0, tc);
-			n0 = tc;
-		}
-		if (insertedKnotElement2.size() > 0)
-		{
-			LN_NurbsCurve tc;
-			NurbsCurve::RefineKnotVector(n2, insertedKnotElement2, tc);
-			n2 = tc;
-		}
-	}
-
-	auto n1 = nurbs[1]; auto n3 = nurbs[3];
-	int degree_n1 = n1.Degree;
-	int degree_n3 = n3.Degree;
-	if (degree_n1 > degree_n3)
-	{
-		int times = degree_n1 - degree_n3;
-		LN_NurbsCurve tc;
-		NurbsCurve::ElevateDegree(n3, times, tc);
-		n3 = tc;
-	}
-	if (degree_n3 > degree_n1)
-	{
-		int times = degree_n3 - degree_n1;
-		LN_NurbsCurve tc;
-		NurbsCurve::ElevateDegree(n1, times, tc);
-		n1 = tc;
-	}
-	if (n1.KnotVector != n3.KnotVector)
-	{
-		std::vector<double> insertedKnotElement1;
-		std::vector<double> insertedKnotElement3;
-		KnotVectorUtils::GetInsertedKnotElement(n1.KnotVector, n3.KnotVector, insertedKnotElement1, insertedKnotElement3);
-
-		if (insertedKnotElement1.size() > 0)
-		{
-			LN_NurbsCurve tc;
-			NurbsCurve::RefineKnotVector(n1, insertedKnotElement1, tc);
-			n1 = tc;
-		}
-		if (insertedKnotElement3.size() > 0)
-		{
-			LN_NurbsCurve tc;
-			NurbsCurve::RefineKnotVector(n3, insertedKnotElement3, tc);
-			n3 = tc;
-		}
-	}
-
-	LN_NurbsSurface ruledSurface0;
-	{
-		std::vector<std::vector<XYZW>> cps;
-		CreateRuledSurface(n0, n2, ruledSurface0);
-	}
-
-	LN_NurbsSurface ruledSurface1;
-	{
-		LN_NurbsSurface ts;
-		CreateRuledSurface(n1, n3, ts);
-		Swap(ts, ruledSurface1);
-	}
-
-	LN_NurbsSurface bilinearSurface;
-	{
-		XYZ point00 = NurbsCurve::GetPointOnCurve(n0, n0.KnotVector[0]);
-		XYZ point01 = NurbsCurve::GetPointOnCurve(n2, n2.KnotVector[0]);
-		XYZ point10 = NurbsCurve::GetPointOnCurve(n0, n0.KnotVector[n0.KnotVector.size() - 1]);
-		XYZ point11 = NurbsCurve::GetPointOnCurve(n2, n2.KnotVector[n2.KnotVector.size() - 1]);
-
-		int degree_u;
-		int degree_v;
-		std::vector<double> kv_u;
-		std::vector<double> kv_v;
-		std::vector<std::vector<XYZW>> cps;
-		CreateBilinearSurface(point00, point01, point10, point11, bilinearSurface);
-	}
-
-	{
-		int rs0_degreeU = ruledSurface0.DegreeU;
-		int rs1_degreeU = ruledSurface1.DegreeU;
-		int bs_degreeU = bilinearSurface.DegreeU;
-
-		int degreeU = std::max(rs0_degreeU, std::max(rs1_degreeU, bs_degreeU));
-		if (degreeU > rs0_degreeU)
-		{
-			int times = degreeU - rs0_degreeU;
-			LN_NurbsSurface temp;
-			ElevateDegree(ruledSurface0, times, true, temp);
-			ruledSurface0 = temp;
-		}
-
-		if (degreeU > rs1_degreeU)
-		{
-			int times = degreeU - rs1_degreeU;
-			LN_NurbsSurface temp;
-			ElevateDegree(ruledSurface1, times, true, temp);
-			ruledSurface1 = temp;
-		}
-
-		if (degreeU > bs_degreeU)
-		{
-			int times = degreeU - bs_degreeU;
-			LN_NurbsSurface temp;
-			ElevateDegree(bilinearSurface, times, true, temp);
-			bilinearSurface = temp;
-		}
-
-		int rs0_degreeV = ruledSurface0.DegreeV;
-		int rs1_degreeV = ruledSurface1.DegreeV;
-		int bs_degreeV = bilinearSurface.DegreeV;
-
-		int degreeV = std::max(rs0_degreeV, std::max(rs1_degreeV, bs_degreeV));
-		if (degreeV > rs0_degreeV)
-		{
-			int times = degreeV - rs0_degreeV;
-			LN_NurbsSurface temp;
-			ElevateDegree(ruledSurface0, times, false, temp);
-			ruledSurface0 = temp;
-		}
-
-		if (degreeV > rs1_degreeV)
-		{
-			int times = degreeV - rs1_degreeV;
-			LN_NurbsSurface temp;
-			ElevateDegree(ruledSurface1, times, false, temp);
-			ruledSurface1 = temp;
-		}
-
-		if (degreeV > bs_degreeV)
-		{
-			int times = degreeV - bs_degreeV;
-			LN_NurbsSurface temp;
-			ElevateDegree(bilinearSurface, times, false, temp);
-			bilinearSurface = temp;
-		}
-	}
-
-	{
-		std::vector<std::vector<double>> knotVectorsU;
-		knotVectorsU.emplace_back(ruledSurface0.KnotVectorU);
-		knotVectorsU.emplace_back(ruledSurface1.KnotVectorU);
-		knotVectorsU.emplace_back(bilinearSurface.KnotVectorU);
-
-		auto insertElements = KnotVectorUtils::GetInsertedKnotElements(knotVectorsU);
-		if (insertElements[0].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(ruledSurface0, insertElements[0], true, temp);
-			ruledSurface0 = temp;
-		}
-		if (insertElements[1].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(ruledSurface1, insertElements[1], true, temp);
-			ruledSurface1 = temp;
-		}
-		if (insertElements[2].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(bilinearSurface, insertElements[2], true, temp);
-			bilinearSurface = temp;
-		}
-	}
+	std::vector<LN_NurbsCurve> pair02;
+	NurbsCurve::MakeCompatible({ nurbs[0], nurbs[2] }, pair02);
+	const LN_NurbsCurve& n0 = pair02[0];
+	const LN_NurbsCurve& n2 = pair02[1];
 
-	{
-		std::vector<std::vector<double>> knotVectorsV;
-		knotVectorsV.emplace_back(ruledSurface0.KnotVectorV);
-		knotVectorsV.emplace_back(ruledSurface1.KnotVectorV);
-		knotVectorsV.emplace_back(bilinearSurface.KnotVectorV);
+	std::vector<LN_NurbsCurve> pair13;
+	NurbsCurve::MakeCompatible({ nurbs[1], nurbs[3] }, pair13);
+	const LN_NurbsCurve& n1 = pair13[0];
+	const LN_NurbsCurve& n3 = pair13[1];
 
-		auto insertElements = KnotVectorUtils::GetInsertedKnotElements(knotVectorsV);
-		if (insertElements[0].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(ruledSurface0, insertElements[0], false, temp);
-			ruledSurface0 = temp;
-		}
-		if (insertElements[1].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(ruledSurface1, insertElements[1], false, temp);
-			ruledSurface1 = temp;
-		}
-		if (insertElements[2].size() > 0)
-		{
-			LN_NurbsSurface temp;
-			RefineKnotVector(bilinearSurface, insertElements[2], false, temp);
-			bilinearSurface = temp;
-		}
-	}
+	// surfaces[0] and surfaces[1] rule the opposite boundaries, surfaces[2] is the bilinear surface of the corners.
+	std::vector<LN_NurbsSurface> surfaces(3);
+	CreateRuledSurface(n0, n2, surfaces[0]);
 
-	surface.DegreeU = ruledSurface0.DegreeU;
-	surface.DegreeV = ruledSurface0.DegreeV;
-	surface.KnotVectorU = ruledSurface0.KnotVectorU;
-	surface.KnotVectorV = ruledSurface0.KnotVectorV;
+	LN_NurbsSurface ts;
+	CreateRuledSurface(n1, n3, ts);
+	Swap(ts, surfaces[1]);
 
-	int row = ruledSurface0.ControlPoints.size();
-	int column = ruledSurface0.ControlPoints[0].size();
+	XYZ point00 = NurbsCurve::GetPointOnCurve(n0, n0.KnotVector[0]);
+	XYZ point01 = NurbsCurve::GetPointOnCurve(n2, n2.KnotVector[0]);
+	XYZ point10 = NurbsCurve::GetPointOnCurve(n0, n0.KnotVector[n0.KnotVector.size() - 1]);
+	XYZ point11 = NurbsCurve::GetPointOnCurve(n2, n2.KnotVector[n2.KnotVector.size() - 1]);
+	CreateBilinearSurface(point00, point01, point10, point11, surfaces[2]);
 
-	std::vector<std::vector<XYZW>> controlPoints(row, std::vector<XYZW>(column));
-	for (int i = 0; i < row; i++)
-	{
-		for (int j = 0; j < column; j++)
-		{
-			controlPoints[i][j] = ruledSurface0.ControlPoints[i][j] + ruledSurface1.ControlPoints[i][j] - bilinearSurface.ControlPoints[i][j];
-		}
-	}
-	surface.ControlPoints = controlPoints;
+	CombineSurfaces(surfaces, surface);
 }
 
 double LNLib::NurbsSurface::ApproximateArea(const LN_NurbsSurface& surface, IntegratorType type)
 {
-	LN_NurbsSurface reSurface;
-	Reparametrize(surface, 0.0, 1.0, 0.0, 1.0, reSurface);
-
-	int degreeU = reSurface.DegreeU;
-	int degreeV = reSurface.DegreeV;
-	std::vector<double> knotVectorU = reSurface.KnotVectorU;
-	std::vector<double> knotVectorV = reSurface.KnotVectorV;
-	std::vector<std::vector<XYZW>> controlPoints = reSurface.ControlPoints;
+	int degreeU = surface.DegreeU;
+	int degreeV = surface.DegreeV;
+	const std::vector<double>& knotVectorU = surface.KnotVectorU;
+	const std::vector<double>& knotVectorV = surface.KnotVectorV;
+	const std::vector<std::vector<XYZW>>& controlPoints = surface.ControlPoints;
 
 	double startU = knotVectorU[0];
 	double endU = knotVectorU[knotVectorU.size() - 1];
@@ -3012,21 +3316,7 @@ double LNLib::NurbsSurface::ApproximateArea(const LN_NurbsSurface& surface, Inte
 	{
 		case IntegratorType::Simpson:
 		{
-			struct fun
-			:public BinaryIntegrationFunction
-			{
-				virtual double operator()(double u, double v, void* customData)const override
-				{
-					auto surface = (LN_NurbsSurface*)customData;
-					XYZ S, Su, Sv;
-					NurbsSurface::ComputeRationalSurfaceFirstOrderDerivative(*surface, UV(u, v), S, Su, Sv);
-					double E = Su.DotProduct(Su);
-					double F = Su.DotProduct(Sv);
-					double G = Sv.DotProduct(Sv);
-					double ds = std::sqrt(E * G - F * F);
-					return ds;
-				}
-			}function;
+			auto function = [&surface](double u, double v) { return GetAreaElement(surface, u, v); };
 
 			// the initial search range
 			struct UVA
@@ -3035,11 +3325,11 @@ double LNLib::NurbsSurface::ApproximateArea(const LN_NurbsSurface& surface, Inte
 				double area;
 			};
 			UVA init;
-			init.u1 = 0;
-			init.u2 = 1;
-			init.v1 = 0;
-			init.v2 = 1;
-			init.area = Integrator::Simpson(function, (void*)&reSurface, init.u1, init.u2, init.v1, init.v2);
+			init.u1 = startU;
+			init.u2 = endU;
+			init.v1 = startV;
+			init.v2 = endV;
+			init.area = Integrator::Simpson(function, init.u1, init.u2, init.v1, init.v2);
 			std::vector<UVA> stack(1, init);
 
 			while(!stack.empty())
@@ -3057,22 +3347,22 @@ double LNLib::NurbsSurface::ApproximateArea(const LN_NurbsSurface& surface, Inte
 				uva1.u2 = uva.u1 + hdu;
 				uva1.v1 = uva.v1;
 				uva1.v2 = uva.v1 + hdv;
-				uva1.area = Integrator::Simpson(function, (void*)&reSurface, uva1.u1, uva1.u2, uva1.v1, uva1.v2);
+				uva1.area = Integrator::Simpson(function, uva1.u1, uva1.u2, uva1.v1, uva1.v2);
 				uva2.u1 = uva.u1 + hdu;
 				uva2.u2 = uva.u2;
 				uva2.v1 = uva.v1;
 				uva2.v2 = uva.v1 + hdv;
-				uva2.area = Integrator::Simpson(function, (void*)&reSurface, uva2.u1, uva2.u2, uva2.v1, uva2.v2);
+				uva2.area = Integrator::Simpson(function, uva2.u1, uva2.u2, uva2.v1, uva2.v2);
 				uva3.u1 = uva.u1;
 				uva3.u2 = uva.u1 + hdu;
 				uva3.v1 = uva.v1 + hdv;
 				uva3.v2 = uva.v2;
-				uva3.area = Integrator::Simpson(function, (void*)&reSurface, uva3.u1, uva3.u2, uva3.v1, uva3.v2);
+				uva3.area = Integrator::Simpson(function, uva3.u1, uva3.u2, uva3.v1, uva3.v2);
 				uva4.u1 = uva.u1 + hdu;
 				uva4.u2 = uva.u2;
 				uva4.v1 = uva.v1 + hdv;
 				uva4.v2 = uva.v2;
-				uva4.area = Integrator::Simpson(function, (void*)&reSurface, uva4.u1, uva4.u2, uva4.v1, uva4.v2);
+				uva4.area = Integrator::Simpson(function, uva4.u1, uva4.u2, uva4.v1, uva4.v2);
 
 				// sum area
 				double areaNew = uva1.area + uva2.area + uva3.area + uva4.area;
@@ -3097,70 +3387,162 @@ double LNLib::NurbsSurface::ApproximateArea(const LN_NurbsSurface& surface, Inte
 		}
 		case IntegratorType::GaussLegendre:
 		{
-			std::vector<LN_NurbsSurface> bezierSurfaces = DecomposeToBeziers(reSurface);
-			for (int i = 0; i < bezierSurfaces.size(); i++)
-			{
-				LN_NurbsSurface bezierSurface = bezierSurfaces[i];
-
-				std::vector<double> bKnotsU = bezierSurface.KnotVectorU;
-				double a = bKnotsU[0];
-				double b = bKnotsU[bKnotsU.size() - 1];
-				double coefficient1 = (b - a) * 0.5;
-
-				std::vector<double> bKnotsV = bezierSurface.KnotVectorV;
-				double c = bKnotsV[0];
-				double d = bKnotsV[bKnotsV.size() - 1];
-				double coefficient2 = (d - c) * 0.5;
-
-				double bArea = 0.0;
-				std::vector<double> abscissae = Integrator::GaussLegendreAbscissae;
-				int size = abscissae.size();
-				for (int i = 0; i < size; i++)
+			LN_BezierPatches patches;
+			DecomposeToBeziers(surface, patches);
+			int countV = static_cast<int>(patches.SpansV.size());
+			int size = static_cast<int>(patches.SpansU.size()) * countV;
+			std::vector<double> areas(size);
+			ThreadUtils::ParallelFor(0, size, [&](int k)
 				{
-					double u = coefficient1 * abscissae[i] + (a + b) * 0.5;
-					for (int j = 0; j < size; j++)
-					{
-						double v = coefficient2 * abscissae[j] + (c + d) * 0.5;
-						XYZ S, Su, Sv;
-						NurbsSurface::ComputeRationalSurfaceFirstOrderDerivative(bezierSurface, UV(u, v), S, Su, Sv);
-						double E = Su.DotProduct(Su);
-						double F = Su.DotProduct(Sv);
-						double G = Sv.DotProduct(Sv);
-						double ds = std::sqrt(E * G - F * F);
-						bArea += Integrator::GaussLegendreWeights[i] * Integrator::GaussLegendreWeights[j] * ds;
-					}
-				}
-				bArea = coefficient1 * coefficient2 * bArea;
-				area += bArea;
+					int i = k / countV;
+					int j = k % countV;
+					areas[k] = Integrator::GaussLegendre([&](double u, double v) { return GetBezierPatchAreaElement(patches, i, j, u, v); },
+						patches.ParamsU[i], patches.ParamsU[i + 1], patches.ParamsV[j], patches.ParamsV[j + 1]);
+				});
+			for (int i = 0; i < size; i++)
+			{
+				area += areas[i];
 			}
 			break;
 		}
 		case IntegratorType::Chebyshev:
 		{
-			std::vector<double> series = Integrator::ChebyshevSeries();
-			AreaWrapperFunction function;
-			AreaData data(reSurface, series);
-
+			const std::vector<double>& series = Integrator::GetChebyshevSeries();
 			for (int i = degreeU; i < controlPoints.size(); i++) 
 			{
-				data.CurrentKnotU = knotVectorU[i];
-				data.NextKnotU = knotVectorU[i + 1];
+				double currentKnotU = knotVectorU[i];
+				double nextKnotU = knotVectorU[i + 1];
 				for (int j = degreeV; j < controlPoints[0].size(); j++) 
 				{
-					data.CurrentKnotV = knotVectorV[j];
-					data.NextKnotV = knotVectorV[j + 1];
-					
-					area += Integrator::ClenshawCurtisQuadrature2(function, (void*)&data, data.CurrentKnotV, data.NextKnotV, series);
+					auto function = [&](double v)
+					{
+						return Integrator::ClenshawCurtis([&](double u) { return GetAreaElement(surface, u, v); }, currentKnotU, nextKnotU, series);
+					};
+					area += Integrator::ClenshawCurtis(function, knotVectorV[j], knotVectorV[j + 1], series);
 				}
 			}
 			break;
 		}
+		case IntegratorType::GaussKronrod:
+		{
+			double error = 0.0;
+			area = ApproximateArea(surface, Constants::DistanceEpsilon, error);
+			break;
+		}
 		default:
 			break;
 	}
 	return area;
 }
 
+double LNLib::NurbsSurface::ApproximateArea(const LN_SurfaceView& view, IntegratorType type)
+{
+	return ApproximateArea(*view.Surface, type);
+}
+
+double LNLib::NurbsSurface::ApproximateArea(const LN_NurbsSurface& surface, double tolerance, double& error)
+{
+	VALIDATE_ARGUMENT(tolerance > 0.0, "tolerance", "Tolerance must be greater than zero.");
+
+	error = 0.0;
+	LN_BezierPatches patches;
+	DecomposeToBeziers(surface, patches);
+	int countV = static_cast<int>(patches.SpansV.size());
+	int size = static_cast<int>(patches.SpansU.size()) * countV;
+	double patchTolerance = tolerance / size;
+
+	std::vector<double> areas(size);
+	std::vector<double> errors(size);
+	ThreadUtils::ParallelFor(0, size, [&](int k)
+		{
+			int i = k / countV;
+			int j = k % countV;
+			areas[k] = Integrator::GaussKronrod([&](double u, double v) { return GetBezierPatchAreaElement(patches, i, j, u, v); },
+				patches.ParamsU[i], patches.ParamsU[i + 1], patches.ParamsV[j], patches.ParamsV[j + 1], patchTolerance, errors[k]);
+		});
+
+	double area = 0.0;
+	for (int i = 0; i < size; i++)
+	{
+		area += areas[i];
+		error += errors[i];
+	}
+	return area;
+}
+
+void LNLib::NurbsSurface::ComputeMassProperties(const std::vector<LN_NurbsSurface>& surfaces, LN_MassProperties& properties)
+{
+	VALIDATE_ARGUMENT(surfaces.size() > 0, "surfaces", "Surfaces size must be greater than zero.");
+
+	// Patch k of surface s is patch k - offsets[s] of patches[s].
+	int surfaceCount = static_cast<int>(surfaces.size());
+	std::vector<LN_BezierPatches> patches(surfaceCount);
+	std::vector<int> offsets(surfaceCount + 1, 0);
+	for (int s = 0; s < surfaceCount; s++)
+	{
+		DecomposeToBeziers(surfaces[s], patches[s]);
+		offsets[s + 1] = offsets[s] + static_cast<int>(patches[s].SpansU.size() * patches[s].SpansV.size());
+	}
+
+	int size = offsets[surfaceCount];
+	std::vector<std::vector<double>> integrals(size);
+	ThreadUtils::ParallelFor(0, size, [&](int k)
+		{
+			int s = static_cast<int>(std::upper_bound(offsets.begin(), offsets.end(), k) - offsets.begin()) - 1;
+			int countV = static_cast<int>(patches[s].SpansV.size());
+			int local = k - offsets[s];
+			integrals[k] = GetMassIntegrals(patches[s], local / countV, local % countV);
+		});
+
+	std::vector<double> sum(MassIntegralsSize, 0.0);
+	for (int i = 0; i < size; i++)
+	{
+		for (int j = 0; j < MassIntegralsSize; j++)
+		{
+			sum[j] += integrals[i][j];
+		}
+	}
+
+	// Inward oriented surface sets give negative volume integrals.
+	if (sum[1] < 0)
+	{
+		for (int j = 1; j < MassIntegralsSize; j++)
+		{
+			sum[j] = -sum[j];
+		}
+	}
+
+	double volume = sum[1];
+	properties.Area = sum[0];
+	properties.Volume = volume;
+	properties.InertiaTensor = std::vector<std::vector<double>>(3, std::vector<double>(3, 0.0));
+	if (MathUtils::IsAlmostEqualTo(volume, 0.0))
+	{
+		properties.Centroid = XYZ(0, 0, 0);
+		return;
+	}
+
+	double cx = sum[2] / volume;
+	double cy = sum[3] / volume;
+	double cz = sum[4] / volume;
+	properties.Centroid = XYZ(cx, cy, cz);
+
+	double xx = sum[5] - volume * cx * cx;
+	double yy = sum[6] - volume * cy * cy;
+	double zz = sum[7] - volume * cz * cz;
+	double xy = sum[8] - volume * cx * cy;
+	double yz = sum[9] - volume * cy * cz;
+	double zx = sum[10] - volume * cz * cx;
+
+	std::vector<std::vector<double>>& inertia = properties.InertiaTensor;
+	inertia[0][0] = yy + zz;
+	inertia[1][1] = xx + zz;
+	inertia[2][2] = xx + yy;
+	inertia[0][1] = inertia[1][0] = -xy;
+	inertia[1][2] = inertia[2][1] = -yz;
+	inertia[0][2] = inertia[2][0] = -zx;
+}
+
 LNLib::LN_Mesh LNLib::NurbsSurface::Triangulate(const LN_NurbsSurface& surface)
 {
 	int samplesU = 25;
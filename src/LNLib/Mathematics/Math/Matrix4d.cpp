@@ -12,6 +12,7 @@
 #include "XYZ.h"
 #include "XYZW.h"
 #include "MathUtils.h"
+#include "ThreadUtils.h"
 
 #include <algorithm>
 #include <cstring>
@@ -283,6 +284,60 @@ XYZW LNLib::Matrix4d::OfWeightedPoint(const XYZW& point)
 	return XYZW(transformed,w);
 }
 
+void LNLib::Matrix4d::OfWeightedPoints(const XYZW* points, int count, XYZW* transformed, bool isParallel) const
+{
+	static_assert(sizeof(XYZW) == 4 * sizeof(double), "XYZW must be four packed doubles.");
+	if (count <= 0) return;
+
+	// Homogeneous coordinates: row 3 of an affine matrix keeps the weight, so no division is needed.
+	double m[16];
+	std::memcpy(m, m_matrix4d, sizeof(m));
+	bool isAffine = m[12] == 0.0 && m[13] == 0.0 && m[14] == 0.0 && m[15] == 1.0;
+
+	const int blockSize = 4096;
+	int blocks = (count + blockSize - 1) / blockSize;
+	auto transformBlock = [&](int b)
+	{
+		int first = b * blockSize;
+		int size = std::min(count - first, blockSize);
+		const double* source = reinterpret_cast<const double*>(points + first);
+		double* target = reinterpret_cast<double*>(transformed + first);
+		for (int i = 0; i < size; i++)
+		{
+			double wx = source[4 * i];
+			double wy = source[4 * i + 1];
+			double wz = source[4 * i + 2];
+			double w = source[4 * i + 3];
+
+			double x = m[0] * wx + m[1] * wy + m[2] * wz + m[3] * w;
+			double y = m[4] * wx + m[5] * wy + m[6] * wz + m[7] * w;
+			double z = m[8] * wx + m[9] * wy + m[10] * wz + m[11] * w;
+			if (!isAffine)
+			{
+				double scale = w / (m[12] * wx + m[13] * wy + m[14] * wz + m[15] * w);
+				x *= scale;
+				y *= scale;
+				z *= scale;
+			}
+			target[4 * i] = x;
+			target[4 * i + 1] = y;
+			target[4 * i + 2] = z;
+			target[4 * i + 3] = w;
+		}
+	};
+	if (isParallel)
+	{
+		ThreadUtils::ParallelFor(0, blocks, transformBlock);
+	}
+	else
+	{
+		for (int b = 0; b < blocks; b++)
+		{
+			transformBlock(b);
+		}
+	}
+}
+
 XYZ LNLib::Matrix4d::OfVector(const XYZ& vector)
 {
 	double x = m_matrix4d[0][0] * vector[0] + m_matrix4d[0][1] * vector[1] + m_matrix4d[0][2] * vector[2];
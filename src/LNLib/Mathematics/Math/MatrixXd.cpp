@@ -0,0 +1,99 @@
+/*
+ * Author:
+ * 2026/10/16 - Yuqing Liang (BIMCoder Liang)
+ * bim.frankliang@foxmail.com
+ * 微信公众号：BIMCoder梁老师
+ *
+ * Use of this source code is governed by a GPL-3.0 license that can be found in
+ * the LICENSE file.
+ */
+
+#include "MatrixXd.h"
+#include "LNLibExceptions.h"
+
+#include <algorithm>
+
+using namespace LNLib;
+
+LNLib::MatrixXd::MatrixXd() : m_rows(0), m_columns(0)
+{
+}
+
+LNLib::MatrixXd::MatrixXd(int rows, int columns, double value)
+{
+	VALIDATE_ARGUMENT(rows >= 0, "rows", "Rows must be greater than or equal zero.");
+	VALIDATE_ARGUMENT(columns >= 0, "columns", "Columns must be greater than or equal zero.");
+	m_rows = rows;
+	m_columns = columns;
+	m_data.assign(static_cast<std::size_t>(rows) * columns, value);
+}
+
+LNLib::MatrixXd::MatrixXd(const std::vector<std::vector<double>>& matrix)
+{
+	m_rows = static_cast<int>(matrix.size());
+	m_columns = m_rows > 0 ? static_cast<int>(matrix[0].size()) : 0;
+	m_data.resize(static_cast<std::size_t>(m_rows) * m_columns);
+	for (int i = 0; i < m_rows; i++)
+	{
+		VALIDATE_ARGUMENT(matrix[i].size() == m_columns, "matrix", "Matrix rows must have the same size.");
+		std::copy(matrix[i].begin(), matrix[i].end(), GetRow(i));
+	}
+}
+
+MatrixXd LNLib::MatrixXd::CreateIdentity(int size)
+{
+	MatrixXd identity(size, size);
+	for (int i = 0; i < size; i++)
+	{
+		identity(i, i) = 1.0;
+	}
+	return identity;
+}
+
+void LNLib::MatrixXd::Resize(int rows, int columns)
+{
+	if (rows == m_rows && columns == m_columns) return;
+
+	MatrixXd resized(rows, columns);
+	int keepRows = std::min(rows, m_rows);
+	int keepColumns = std::min(columns, m_columns);
+	for (int i = 0; i < keepRows; i++)
+	{
+		std::copy(GetRow(i), GetRow(i) + keepColumns, resized.GetRow(i));
+	}
+	*this = std::move(resized);
+}
+
+void LNLib::MatrixXd::SetZero()
+{
+	std::fill(m_data.begin(), m_data.end(), 0.0);
+}
+
+void LNLib::MatrixXd::SwapRows(int row1, int row2)
+{
+	if (row1 == row2) return;
+	std::swap_ranges(GetRow(row1), GetRow(row1) + m_columns, GetRow(row2));
+}
+
+MatrixXd LNLib::MatrixXd::GetTranspose() const
+{
+	MatrixXd transposed(m_columns, m_rows);
+	for (int i = 0; i < m_rows; i++)
+	{
+		for (int j = 0; j < m_columns; j++)
+		{
+			transposed(j, i) = (*this)(i, j);
+		}
+	}
+	return transposed;
+}
+
+std::vector<std::vector<double>> LNLib::MatrixXd::ToArray() const
+{
+	std::vector<std::vector<double>> result(m_rows);
+	for (int i = 0; i < m_rows; i++)
+	{
+		result[i].assign(GetRow(i), GetRow(i) + m_columns);
+	}
+	return result;
+}
@@ -21,8 +21,27 @@
 #include <Eigen/Dense>
 
 #include <cmath>
+#include <algorithm>
 #include <limits>
 
+namespace LNLib
+{
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrix;
+
+    /// <summary>
+    /// View the contiguous storage of matrix as an Eigen matrix without copying.
+    /// </summary>
+    Eigen::Map<RowMajorMatrix> MapMatrix(MatrixXd& matrix)
+    {
+        return Eigen::Map<RowMajorMatrix>(matrix.GetData(), matrix.GetRowCount(), matrix.GetColumnCount());
+    }
+
+    Eigen::Map<const RowMajorMatrix> MapMatrix(const MatrixXd& matrix)
+    {
+        return Eigen::Map<const RowMajorMatrix>(matrix.GetData(), matrix.GetRowCount(), matrix.GetColumnCount());
+    }
+}
+
 bool LNLib::MathUtils::IsAlmostEqualTo(double value1, double value2, double tolerance)
 {
     if (IsNaN(value1) || IsNaN(value2))
@@ -110,21 +129,13 @@ double LNLib::MathUtils::ComputerCubicEquationsWithOneVariable(double cubic, dou
 
 std::vector<std::vector<double>> LNLib::MathUtils::MatrixMultiply(const std::vector<std::vector<double>>& left, const std::vector<std::vector<double>>& right)
 {
-    int m = left.size();
-    int n = left[0].size();
-    int p = right[0].size();
+    return MatrixMultiply(MatrixXd(left), MatrixXd(right)).ToArray();
+}
 
-    std::vector<std::vector<double>> result(m, std::vector<double>(p,0.0));
-    for (int i = 0; i < m; i++)
-    {
-        for (int j = 0; j < p; j++)
-        {
-            for (int k = 0; k < n; k++)
-            {
-                result[i][j] += left[i][k] * right[k][j];
-            }
-        }
-    }
+LNLib::MatrixXd LNLib::MathUtils::MatrixMultiply(const MatrixXd& left, const MatrixXd& right)
+{
+    MatrixXd result(left.GetRowCount(), right.GetColumnCount());
+    MapMatrix(result).noalias() = MapMatrix(left) * MapMatrix(right);
     return result;
 }
 
@@ -162,71 +173,223 @@ std::vector<std::vector<double>> LNLib::MathUtils::CreateMatrix(int row, int col
 
 double LNLib::MathUtils::GetDeterminant(const std::vector<std::vector<double>>& matrix)
 {
-    Eigen::MatrixXd m(matrix.size(), matrix[0].size());
-    for (int i = 0; i < matrix.size(); i++)
+    return GetDeterminant(MatrixXd(matrix));
+}
+
+double LNLib::MathUtils::GetDeterminant(const MatrixXd& matrix)
+{
+    return MapMatrix(matrix).determinant();
+}
+
+bool LNLib::MathUtils::MakeInverse(const std::vector<std::vector<double>>& matrix, std::vector<std::vector<double>>& inverse)
+{
+    MatrixXd result;
+    if (!MakeInverse(MatrixXd(matrix), result))
     {
-        m.row(i) = Eigen::VectorXd::Map(&matrix[i][0], matrix[i].size());
+        return false;
     }
-    return m.determinant();
+    inverse = result.ToArray();
+    return true;
 }
 
-bool LNLib::MathUtils::MakeInverse(const std::vector<std::vector<double>>& matrix, std::vector<std::vector<double>>& inverse)
+bool LNLib::MathUtils::MakeInverse(const MatrixXd& matrix, MatrixXd& inverse)
 {
-    int row = matrix.size();
-    int column = matrix[0].size();
+    int row = matrix.GetRowCount();
+    int column = matrix.GetColumnCount();
 
     if (!(row == column))
     {
         return false;
     }
-    Eigen::MatrixXd m(matrix.size(), matrix[0].size());
-    for (int i = 0; i < row; i++)
-    {
-        m.row(i) = Eigen::VectorXd::Map(&matrix[i][0], matrix[i].size());
-    }
+    inverse = MatrixXd(row, column);
+    MapMatrix(inverse) = MapMatrix(matrix).inverse();
+    return true;
+}
+
+std::vector<std::vector<double>> LNLib::MathUtils::SolveLinearSystem(const std::vector<std::vector<double>>& matrix, const std::vector<std::vector<double>>& right)
+{
+    return SolveLinearSystem(MatrixXd(matrix), MatrixXd(right)).ToArray();
+}
+
+LNLib::MatrixXd LNLib::MathUtils::SolveLinearSystem(const MatrixXd& matrix, const MatrixXd& right)
+{
+    MatrixXd result(matrix.GetColumnCount(), right.GetColumnCount());
+    MapMatrix(result) = MapMatrix(matrix).lu().solve(MapMatrix(right));
+    return result;
+}
 
-    auto result = m.inverse();
-    inverse.resize(row);
-    for (int k = 0; k < row; k++)
+bool LNLib::MathUtils::SolveBandedLinearSystem(const MatrixXd& band, int lower, int upper, const MatrixXd& right, MatrixXd& result)
+{
+    MatrixXd lu = band;
+    std::vector<int> pivots;
+    if (!BandedLUDecomposition(lu, lower, upper, pivots))
     {
-        inverse[k].resize(column);
+        return false;
     }
+    result = right;
+    BandedLUSolve(lu, lower, upper, pivots, result);
+    return true;
+}
+
+bool LNLib::MathUtils::BandedLUDecomposition(MatrixXd& band, int lower, int upper, std::vector<int>& pivots)
+{
+    int n = band.GetRowCount();
+
+    // Row interchanges widen the upper bandwidth by at most lower.
+    int width = 2 * lower + upper + 1;
+    int reach = lower + upper;
+    band.Resize(n, width);
+    pivots.resize(n);
 
-    for (int col = 0; col < result.cols(); ++col)
+    for (int k = 0; k < n; k++)
     {
-        for (int row = 0; row < result.rows(); ++row)
+        int last = std::min(n - 1, k + lower);
+        int pivot = k;
+        for (int i = k + 1; i <= last; i++)
         {
-            inverse[row][col] = result(row, col);
+            if (std::abs(band(i, k - i + lower)) > std::abs(band(pivot, k - pivot + lower)))
+            {
+                pivot = i;
+            }
+        }
+        if (band(pivot, k - pivot + lower) == 0.0)
+        {
+            return false;
+        }
+        pivots[k] = pivot;
+
+        int end = std::min(n - 1, k + reach);
+        if (pivot != k)
+        {
+            for (int j = k; j <= end; j++)
+            {
+                std::swap(band(k, j - k + lower), band(pivot, j - pivot + lower));
+            }
+        }
+
+        // Multipliers are kept in place of the eliminated entries.
+        double diagonal = band(k, lower);
+        for (int i = k + 1; i <= last; i++)
+        {
+            double factor = band(i, k - i + lower) / diagonal;
+            band(i, k - i + lower) = factor;
+            if (factor == 0.0) continue;
+            for (int j = k + 1; j <= end; j++)
+            {
+                band(i, j - i + lower) -= factor * band(k, j - k + lower);
+            }
         }
     }
     return true;
 }
 
-std::vector<std::vector<double>> LNLib::MathUtils::SolveLinearSystem(const std::vector<std::vector<double>>& matrix, const std::vector<std::vector<double>>& right)
+void LNLib::MathUtils::BandedLUSolve(const MatrixXd& lu, int lower, int upper, const std::vector<int>& pivots, MatrixXd& right)
 {
-    std::vector<std::vector<double>> result(matrix.size(), std::vector<double>(right[0].size()));
+    int n = lu.GetRowCount();
+    int columns = right.GetColumnCount();
+    int reach = lower + upper;
 
-    Eigen::MatrixXd m(matrix.size(), matrix[0].size());
-    for (int i = 0; i < matrix.size(); i++)
+    for (int k = 0; k < n; k++)
     {
-        m.row(i) = Eigen::VectorXd::Map(&matrix[i][0], matrix[i].size());
+        if (pivots[k] != k)
+        {
+            right.SwapRows(k, pivots[k]);
+        }
+        int last = std::min(n - 1, k + lower);
+        for (int i = k + 1; i <= last; i++)
+        {
+            double factor = lu(i, k - i + lower);
+            if (factor == 0.0) continue;
+            for (int c = 0; c < columns; c++)
+            {
+                right(i, c) -= factor * right(k, c);
+            }
+        }
     }
-        
-    Eigen::MatrixXd r(right.size(),  right[0].size());
-    for (int i = 0; i < right.size(); i++)
+
+    for (int k = n - 1; k >= 0; k--)
     {
-        r.row(i) = Eigen::VectorXd::Map(&right[i][0], right[i].size());
+        int end = std::min(n - 1, k + reach);
+        for (int j = k + 1; j <= end; j++)
+        {
+            double value = lu(k, j - k + lower);
+            for (int c = 0; c < columns; c++)
+            {
+                right(k, c) -= value * right(j, c);
+            }
+        }
+        for (int c = 0; c < columns; c++)
+        {
+            right(k, c) /= lu(k, lower);
+        }
     }
+}
 
-    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> solve = m.lu().solve(r);
-    for (int col = 0; col < solve.cols(); ++col)
+bool LNLib::MathUtils::BandedCholeskyDecomposition(MatrixXd& band, int bandwidth)
+{
+    int n = band.GetRowCount();
+    for (int i = 0; i < n; i++)
     {
-        for (int row = 0; row < solve.rows(); ++row)
+        int first = std::max(0, i - bandwidth);
+        for (int j = first; j <= i; j++)
         {
-            result[row][col] = solve(row, col);
+            double sum = band(i, j - i + bandwidth);
+            int start = std::max(first, j - bandwidth);
+            for (int k = start; k < j; k++)
+            {
+                sum -= band(i, k - i + bandwidth) * band(j, k - j + bandwidth);
+            }
+            if (j == i)
+            {
+                if (sum <= 0.0)
+                {
+                    return false;
+                }
+                band(i, bandwidth) = std::sqrt(sum);
+            }
+            else
+            {
+                band(i, j - i + bandwidth) = sum / band(j, bandwidth);
+            }
         }
     }
-    return result;
+    return true;
 }
 
+void LNLib::MathUtils::BandedCholeskySolve(const MatrixXd& factor, int bandwidth, MatrixXd& right)
+{
+    int n = factor.GetRowCount();
+    int columns = right.GetColumnCount();
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int k = std::max(0, i - bandwidth); k < i; k++)
+        {
+            double value = factor(i, k - i + bandwidth);
+            for (int c = 0; c < columns; c++)
+            {
+                right(i, c) -= value * right(k, c);
+            }
+        }
+        for (int c = 0; c < columns; c++)
+        {
+            right(i, c) /= factor(i, bandwidth);
+        }
+    }
 
+    for (int i = n - 1; i >= 0; i--)
+    {
+        for (int k = i + 1; k <= std::min(n - 1, i + bandwidth); k++)
+        {
+            double value = factor(k, i - k + bandwidth);
+            for (int c = 0; c < columns; c++)
+            {
+                right(i, c) -= value * right(k, c);
+            }
+        }
+        for (int c = 0; c < columns; c++)
+        {
+            right(i, c) /= factor(i, bandwidth);
+        }
+    }
+}
@@ -11,12 +11,13 @@
 #pragma once
 
 #include "LNLibDefinitions.h"
+#include "LNObject.h"
 #include <vector>
+#include <algorithm>
 
 namespace LNLib
 {
-	class XYZ;
-	class XYZW;
+	class MatrixXd;
 	class LNLIB_EXPORT ControlPointsUtils
 	{
 	public:
@@ -29,6 +30,240 @@ namespace LNLib
 		static std::vector<std::vector<XYZW>> Multiply(const std::vector<std::vector<XYZW>>& points, const std::vector<std::vector<double>>& coefficient);
 
 		static std::vector<std::vector<XYZW>> Multiply(const std::vector<std::vector<double>>& coefficient, const std::vector<std::vector<XYZW>>& points);
+
+		static std::vector<std::vector<XYZW>> Multiply(const std::vector<std::vector<XYZW>>& points, const MatrixXd& coefficient);
+
+		static std::vector<std::vector<XYZW>> Multiply(const MatrixXd& coefficient, const std::vector<std::vector<XYZW>>& points);
+
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page220
+		/// Degree reduce Bezier control points from degree to degree - 1 when the error stays within tolerance.
+		/// </summary>
+		static bool ReduceBezierDegree(int degree, const std::vector<XYZW>& controlPoints, std::vector<XYZW>& updatedControlPoints);
+
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page209
+		/// Algorithm A5.10 on count rows at once, source(i, c) being control point i of row c
+		/// and target(i, c) its elevated control point i. Each step works on all rows before the next one, a curve being the case count = 1.
+		/// bezalfs and elevatedKnotVector come from Polynomials::GetDegreeElevationCoefficients and KnotVectorUtils::GetElevatedKnotVector.
+		/// </summary>
+		template <typename Source, typename Target>
+		static void ElevateControlPoints(int degree, const std::vector<double>& knotVector, int times, const std::vector<std::vector<double>>& bezalfs, const std::vector<double>& elevatedKnotVector, int count, Source source, Target target)
+		{
+			int n = knotVector.size() - degree - 2;
+			int m = n + degree + 1;
+			int ph = degree + times;
+
+			int kind = ph + 1;
+			int r = -1;
+			int a = degree;
+			int b = degree + 1;
+			int cind = 1;
+			double ua = knotVector[0];
+
+			std::vector<XYZW> bpts((degree + 1) * count);
+			std::vector<XYZW> nextbpts(std::max(degree - 1, 0) * count);
+			std::vector<XYZW> ebpts((ph + 1) * count);
+			std::vector<double> alfs(std::max(degree - 1, 0));
+			for (int c = 0; c < count; c++)
+			{
+				target(0, c) = source(0, c);
+			}
+			for (int i = 0; i <= degree; i++)
+			{
+				for (int c = 0; c < count; c++)
+				{
+					bpts[i * count + c] = source(i, c);
+				}
+			}
+
+			while (b < m)
+			{
+				int i = b;
+				while (b < m && knotVector[b] == knotVector[b + 1])
+				{
+					b = b + 1;
+				}
+				int mul = b - i + 1;
+				double ub = knotVector[b];
+
+				int oldr = r;
+				r = degree - mul;
+
+				int lbz = oldr > 0 ? (oldr + 2) / 2 : 1;
+				int rbz = r > 0 ? ph - (r + 1) / 2 : ph;
+
+				if (r > 0)
+				{
+					double numer = ub - ua;
+					for (int k = degree; k > mul; k--)
+					{
+						alfs[k - mul - 1] = numer / (knotVector[a + k] - ua);
+					}
+					for (int j = 1; j <= r; j++)
+					{
+						int save = r - j;
+						int s = mul + j;
+						for (int k = degree; k >= s; k--)
+						{
+							double alf = alfs[k - s];
+							for (int c = 0; c < count; c++)
+							{
+								bpts[k * count + c] = alf * bpts[k * count + c] + (1.0 - alf) * bpts[(k - 1) * count + c];
+							}
+						}
+						for (int c = 0; c < count; c++)
+						{
+							nextbpts[save * count + c] = bpts[degree * count + c];
+						}
+					}
+				}
+
+				for (int i = lbz; i <= ph; i++)
+				{
+					int mpi = std::min(degree, i);
+					for (int c = 0; c < count; c++)
+					{
+						XYZW point(0.0, 0.0, 0.0, 0.0);
+						for (int j = std::max(0, i - times); j <= mpi; j++)
+						{
+							point += bezalfs[i][j] * bpts[j * count + c];
+						}
+						ebpts[i * count + c] = point;
+					}
+				}
+
+				if (oldr > 1)
+				{
+					int first = kind - 2;
+					int last = kind;
+					double den = ub - ua;
+					double bet = (ub - elevatedKnotVector[kind - 1]) / den;
+
+					for (int tr = 1; tr < oldr; tr++)
+					{
+						int i = first;
+						int j = last;
+						int kj = j - kind + 1;
+
+						while (j - i > tr)
+						{
+							if (i < cind)
+							{
+								double alf = (ub - elevatedKnotVector[i]) / (ua - elevatedKnotVector[i]);
+								for (int c = 0; c < count; c++)
+								{
+									target(i, c) = alf * target(i, c) + (1.0 - alf) * target(i - 1, c);
+								}
+							}
+							if (j >= lbz)
+							{
+								double gam = j - tr <= kind - ph + oldr ? (ub - elevatedKnotVector[j - tr]) / den : bet;
+								for (int c = 0; c < count; c++)
+								{
+									ebpts[kj * count + c] = gam * ebpts[kj * count + c] + (1.0 - gam) * ebpts[(kj + 1) * count + c];
+								}
+							}
+							i = i + 1;
+							j = j - 1;
+							kj = kj - 1;
+						}
+						first -= 1;
+						last += 1;
+					}
+				}
+
+				if (a != degree)
+				{
+					kind += ph - oldr;
+				}
+
+				for (int j = lbz; j <= rbz; j++, cind++)
+				{
+					for (int c = 0; c < count; c++)
+					{
+						target(cind, c) = ebpts[j * count + c];
+					}
+				}
+
+				if (b < m)
+				{
+					for (int j = 0; j < r; j++)
+					{
+						for (int c = 0; c < count; c++)
+						{
+							bpts[j * count + c] = nextbpts[j * count + c];
+						}
+					}
+					for (int j = r; j <= degree; j++)
+					{
+						for (int c = 0; c < count; c++)
+						{
+							bpts[j * count + c] = source(b - degree + j, c);
+						}
+					}
+					a = b;
+					b = b + 1;
+					ua = ub;
+				}
+			}
+		}
+
+		/// <summary>
+		/// Replay a knot refinement of KnotVectorUtils::GetKnotRefinement on count rows of n + 1 control points at once,
+		/// source(i, c) being control point i of row c and target(i, c) its refined control point i.
+		/// Each step works on all rows before the next one, a curve being the case count = 1.
+		/// </summary>
+		template <typename Source, typename Target>
+		static void RefineControlPoints(const LN_KnotRefinement& refinement, int n, int count, Source source, Target target)
+		{
+			int degree = refinement.Degree;
+			int a = refinement.SpanStart;
+			int b = refinement.SpanEnd;
+			int r = refinement.Copies.size() - 1;
+
+			for (int j = 0; j <= a - degree; j++)
+			{
+				for (int c = 0; c < count; c++)
+				{
+					target(j, c) = source(j, c);
+				}
+			}
+			for (int j = b - 1; j <= n; j++)
+			{
+				for (int c = 0; c < count; c++)
+				{
+					target(j + r + 1, c) = source(j, c);
+				}
+			}
+
+			int i = b + degree - 1;
+			int k = b + degree + r;
+			for (int step = 0; step <= r; step++)
+			{
+				for (int copy = 0; copy < refinement.Copies[step]; copy++, k--, i--)
+				{
+					for (int c = 0; c < count; c++)
+					{
+						target(k - degree - 1, c) = source(i - degree - 1, c);
+					}
+				}
+				for (int c = 0; c < count; c++)
+				{
+					target(k - degree - 1, c) = target(k - degree, c);
+				}
+				for (int l = 1; l <= degree; l++)
+				{
+					int ind = k - degree + l;
+					double alpha = refinement.Alphas[step * degree + l - 1];
+					for (int c = 0; c < count; c++)
+					{
+						target(ind - 1, c) = alpha * target(ind - 1, c) + (1.0 - alpha) * target(ind, c);
+					}
+				}
+				k--;
+			}
+		}
 	};
 
 }
@@ -11,7 +11,10 @@
 #pragma once
 #include "LNLibDefinitions.h"
 #include "LNObject.h"
+#include "Constants.h"
+#include "MathUtils.h"
 #include <vector>
+#include <cmath>
 
 namespace LNLib
 {
@@ -41,12 +44,273 @@ namespace LNLib
 		static const std::vector<double> GaussLegendreAbscissae;
 		static const std::vector<double> GaussLegendreWeights;
 
+		/// <summary>
+		/// 15-point Kronrod rule on [-1,1] and the embedded 7-point Gauss rule,
+		/// GaussKronrodGaussWeights is zero at the Kronrod-only abscissae.
+		/// According to QUADPACK qk15.
+		/// </summary>
+		static const std::vector<double> GaussKronrodAbscissae;
+		static const std::vector<double> GaussKronrodWeights;
+		static const std::vector<double> GaussKronrodGaussWeights;
+
 		/// <summary>
 		/// According to https://github.com/chrisidefix/nurbs
 		/// </summary>
 		static std::vector<double> ChebyshevSeries(int size = 100);
-		static double ClenshawCurtisQuadrature(IntegrationFunction& function, void* customData, double start, double end, std::vector<double>& series, double epsilon = Constants::DistanceEpsilon);
+
+		/// <summary>
+		/// The ChebyshevSeries table of the given size, built on first request and cached.
+		/// The returned table is never modified afterwards and can be shared by any number of threads.
+		/// </summary>
+		static const std::vector<double>& GetChebyshevSeries(int size = 100);
+
+		/// <summary>
+		/// series is the table created by ChebyshevSeries and is only read,
+		/// one table can be shared by any number of threads.
+		/// </summary>
+		static double ClenshawCurtisQuadrature(IntegrationFunction& function, void* customData, double start, double end, const std::vector<double>& series, double epsilon = Constants::DistanceEpsilon);
 		static double ClenshawCurtisQuadrature2(IntegrationFunction& function, void* customData, double start, double end, std::vector<double> series, double epsilon = Constants::DistanceEpsilon);
+
+		/// <summary>
+		/// The template versions below accept any callable, double(double) or double(double, double),
+		/// so the integrand is called directly and can be inlined.
+		/// </summary>
+		template<typename Function>
+		static double Simpson(Function&& function, double start, double end)
+		{
+			double st = function(start);
+			double mt = function((start + end) / 2.0);
+			double et = function(end);
+			return ((end - start) / 6.0) * (st + 4 * mt + et);
+		}
+
+		template<typename Function>
+		static double Simpson(Function&& function, double uStart, double uEnd, double vStart, double vEnd)
+		{
+			double uMiddle = (uStart + uEnd) / 2.0;
+			double vMiddle = (vStart + vEnd) / 2.0;
+
+			double sum = function(uStart, vStart) + 4 * function(uStart, vMiddle) + function(uStart, vEnd) +
+				4 * function(uMiddle, vStart) + 16 * function(uMiddle, vMiddle) + 4 * function(uMiddle, vEnd) +
+				function(uEnd, vStart) + 4 * function(uEnd, vMiddle) + function(uEnd, vEnd);
+			return sum * (uEnd - uStart) * (vEnd - vStart) / 36.0;
+		}
+
+		/// <summary>
+		/// Recursively bisect [start, end] until the Simpson estimates of both halves agree with the whole within tolerance.
+		/// </summary>
+		template<typename Function>
+		static double AdaptiveSimpson(Function&& function, double start, double end, double tolerance = Constants::DistanceEpsilon)
+		{
+			return AdaptiveSimpson(function, start, end, Simpson(function, start, end), tolerance, 0);
+		}
+
+		template<typename Function>
+		static double GaussLegendre(Function&& function, double start, double end)
+		{
+			double coefficient = (end - start) / 2.0;
+			double middle = (start + end) / 2.0;
+
+			double result = 0.0;
+			int size = static_cast<int>(GaussLegendreAbscissae.size());
+			for (int i = 0; i < size; i++)
+			{
+				result += GaussLegendreWeights[i] * function(coefficient * GaussLegendreAbscissae[i] + middle);
+			}
+			return coefficient * result;
+		}
+
+		template<typename Function>
+		static double GaussLegendre(Function&& function, double uStart, double uEnd, double vStart, double vEnd)
+		{
+			double uCoefficient = (uEnd - uStart) / 2.0;
+			double uMiddle = (uStart + uEnd) / 2.0;
+			double vCoefficient = (vEnd - vStart) / 2.0;
+			double vMiddle = (vStart + vEnd) / 2.0;
+
+			double result = 0.0;
+			int size = static_cast<int>(GaussLegendreAbscissae.size());
+			for (int i = 0; i < size; i++)
+			{
+				double u = uCoefficient * GaussLegendreAbscissae[i] + uMiddle;
+				for (int j = 0; j < size; j++)
+				{
+					double v = vCoefficient * GaussLegendreAbscissae[j] + vMiddle;
+					result += GaussLegendreWeights[i] * GaussLegendreWeights[j] * function(u, v);
+				}
+			}
+			return uCoefficient * vCoefficient * result;
+		}
+
+		/// <summary>
+		/// series is the table created by ChebyshevSeries and is only read.
+		/// </summary>
+		template<typename Function>
+		static double ClenshawCurtis(Function&& function, double start, double end, const std::vector<double>& series, double epsilon = Constants::DistanceEpsilon)
+		{
+			int lenw = static_cast<int>(series.size()) - 1;
+			std::vector<double> samples(lenw + 1);
+
+			double esf = 10;
+			double ba = 0.5 * (end - start);
+			double ss = 2 * series[lenw];
+			double x = ba * series[lenw];
+			samples[0] = 0.5 * function(start);
+			samples[3] = 0.5 * function(end);
+			samples[2] = function(start + x);
+			samples[4] = function(end - x);
+			samples[1] = function(start + ba);
+			double eref = 0.5 * (std::fabs(samples[0]) + std::fabs(samples[1]) + std::fabs(samples[2]) + std::fabs(samples[3]) + std::fabs(samples[4]));
+			samples[0] += samples[3];
+			samples[2] += samples[4];
+			double ir = samples[0] + samples[1] + samples[2];
+			double integration = samples[0] * series[lenw - 1] + samples[1] * series[lenw - 2] + samples[2] * series[lenw - 3];
+			double erefh = eref * std::sqrt(epsilon);
+			eref *= epsilon;
+			double hh = 0.25;
+			int l = 2;
+			int k = lenw - 5;
+			double err, errir;
+			do {
+				double iback = integration;
+				double irback = ir;
+				x = ba * series[k + 1];
+				double y = 0;
+				integration = samples[0] * series[k];
+				for (int j = 1; j <= l; j++) {
+					x += y;
+					y += ss * (ba - x);
+					double fx = function(start + x) + function(end - x);
+					ir += fx;
+					integration += samples[j] * series[k - j] + fx * series[k - j - l];
+					samples[j + l] = fx;
+				}
+				ss = 2 * series[k + 1];
+				err = esf * l * std::fabs(integration - iback);
+				hh *= 0.25;
+				errir = hh * std::fabs(ir - 2 * irback);
+				l *= 2;
+				k -= l + 2;
+			} while ((err > erefh || errir > eref) && k > 4 * l);
+			return integration * (end - start);
+		}
+
+		/// <summary>
+		/// Adaptive G7-K15 integration.
+		/// An interval is bisected until |K15 - G7| on it is within its share of tolerance,
+		/// error returns the sum of those estimates.
+		/// </summary>
+		template<typename Function>
+		static double GaussKronrod(Function&& function, double start, double end, double tolerance, double& error)
+		{
+			error = 0.0;
+			return GaussKronrod(function, start, end, tolerance, error, 0);
+		}
+
+		/// <summary>
+		/// Adaptive tensor G7-K15 integration on [uStart, uEnd] x [vStart, vEnd].
+		/// The error of each direction is estimated by replacing K15 with G7 in that direction only,
+		/// a rectangle is bisected along the direction with the larger error.
+		/// </summary>
+		template<typename Function>
+		static double GaussKronrod(Function&& function, double uStart, double uEnd, double vStart, double vEnd, double tolerance, double& error)
+		{
+			error = 0.0;
+			return GaussKronrod(function, uStart, uEnd, vStart, vEnd, tolerance, error, 0);
+		}
+
+	private:
+
+		template<typename Function>
+		static double GaussKronrod(Function& function, double start, double end, double tolerance, double& error, int depth)
+		{
+			double coefficient = (end - start) / 2.0;
+			double middle = (start + end) / 2.0;
+
+			double kronrod = 0.0;
+			double gauss = 0.0;
+			int size = static_cast<int>(GaussKronrodAbscissae.size());
+			for (int i = 0; i < size; i++)
+			{
+				double f = function(coefficient * GaussKronrodAbscissae[i] + middle);
+				kronrod += GaussKronrodWeights[i] * f;
+				gauss += GaussKronrodGaussWeights[i] * f;
+			}
+			kronrod *= coefficient;
+			gauss *= coefficient;
+
+			double differ = std::abs(kronrod - gauss);
+			if (differ <= tolerance || depth >= 30)
+			{
+				error += differ;
+				return kronrod;
+			}
+			return GaussKronrod(function, start, middle, tolerance / 2.0, error, depth + 1) +
+				GaussKronrod(function, middle, end, tolerance / 2.0, error, depth + 1);
+		}
+
+		template<typename Function>
+		static double GaussKronrod(Function& function, double uStart, double uEnd, double vStart, double vEnd, double tolerance, double& error, int depth)
+		{
+			double uCoefficient = (uEnd - uStart) / 2.0;
+			double uMiddle = (uStart + uEnd) / 2.0;
+			double vCoefficient = (vEnd - vStart) / 2.0;
+			double vMiddle = (vStart + vEnd) / 2.0;
+
+			double kk = 0.0;
+			double gk = 0.0;
+			double kg = 0.0;
+			int size = static_cast<int>(GaussKronrodAbscissae.size());
+			for (int i = 0; i < size; i++)
+			{
+				double u = uCoefficient * GaussKronrodAbscissae[i] + uMiddle;
+				for (int j = 0; j < size; j++)
+				{
+					double v = vCoefficient * GaussKronrodAbscissae[j] + vMiddle;
+					double f = function(u, v);
+					kk += GaussKronrodWeights[i] * GaussKronrodWeights[j] * f;
+					gk += GaussKronrodGaussWeights[i] * GaussKronrodWeights[j] * f;
+					kg += GaussKronrodWeights[i] * GaussKronrodGaussWeights[j] * f;
+				}
+			}
+			double scale = uCoefficient * vCoefficient;
+			kk *= scale;
+			gk *= scale;
+			kg *= scale;
+
+			double uError = std::abs(kk - gk);
+			double vError = std::abs(kk - kg);
+			if (uError + vError <= tolerance || depth >= 20)
+			{
+				error += uError + vError;
+				return kk;
+			}
+			if (uError >= vError)
+			{
+				return GaussKronrod(function, uStart, uMiddle, vStart, vEnd, tolerance / 2.0, error, depth + 1) +
+					GaussKronrod(function, uMiddle, uEnd, vStart, vEnd, tolerance / 2.0, error, depth + 1);
+			}
+			return GaussKronrod(function, uStart, uEnd, vStart, vMiddle, tolerance / 2.0, error, depth + 1) +
+				GaussKronrod(function, uStart, uEnd, vMiddle, vEnd, tolerance / 2.0, error, depth + 1);
+		}
+
+		template<typename Function>
+		static double AdaptiveSimpson(Function& function, double start, double end, double whole, double tolerance, int depth)
+		{
+			double middle = (start + end) / 2.0;
+			double left = Simpson(function, start, middle);
+			double right = Simpson(function, middle, end);
+
+			double differ = left + right - whole;
+			if (MathUtils::IsAlmostEqualTo(differ, 0.0) ||
+				MathUtils::IsLessThan(std::abs(differ) / 10.0, tolerance) ||
+				depth >= 50)
+			{
+				return left + right + differ / 10.0;
+			}
+			return AdaptiveSimpson(function, start, middle, left, tolerance / 2.0, depth + 1) +
+				AdaptiveSimpson(function, middle, end, right, tolerance / 2.0, depth + 1);
+		}
 	};
 	
 }
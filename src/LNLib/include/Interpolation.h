@@ -15,6 +15,7 @@
 namespace LNLib
 {
 	class XYZ;
+	class MatrixXd;
 	class LNLIB_EXPORT Interpolation
 	{
 	public:
@@ -49,6 +50,13 @@ namespace LNLib
 		/// </summary>
 		static std::vector<double> AverageKnotVector(int degree, const std::vector<double>& params);
 
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page369
+		/// Coefficient matrix of global interpolation at nondecreasing params, 
+		/// in the band storage of MathUtils::SolveBandedLinearSystem.
+		/// </summary>
+		static void ComputeInterpolationMatrix(int degree, const std::vector<double>& knotVector, const std::vector<double>& params, MatrixXd& band, int& lower, int& upper);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page377
 		/// Algorithm A9.3
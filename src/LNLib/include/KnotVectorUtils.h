@@ -18,6 +18,8 @@
 namespace LNLib
 {
 	class UV;
+	struct LN_KnotStructure;
+	struct LN_KnotRefinement;
 
 	class LNLIB_EXPORT KnotVectorUtils
 	{
@@ -29,6 +31,32 @@ namespace LNLib
 		/// </summary>
 		static int GetContinuity(int degree, const std::vector<double>& knotVector, double knot);
 
+		/// <summary>
+		/// Collect the distinct knots of [knotVector] with their multiplicities, span starts and continuities in one pass.
+		/// Knots equal within Constants::DoubleEpsilon are one knot, as in Polynomials::GetKnotMultiplicity.
+		/// </summary>
+		static void CreateKnotStructure(int degree, const std::vector<double>& knotVector, LN_KnotStructure& structure);
+
+		/// <summary>
+		/// Binary search the index of [knot] in structure.Knots, -1 if it is not a knot.
+		/// </summary>
+		static int GetKnotIndex(const LN_KnotStructure& structure, double knot);
+
+		/// <summary>
+		/// Multiplicity of [knot], zero if it is not a knot.
+		/// </summary>
+		static int GetKnotMultiplicity(const LN_KnotStructure& structure, double knot);
+
+		/// <summary>
+		/// Continuity at [knot], structure.Degree if it is not a knot.
+		/// </summary>
+		static int GetContinuity(const LN_KnotStructure& structure, double knot);
+
+		/// <summary>
+		/// Binary search the knot span index of [knot], matching Polynomials::GetKnotSpanIndex on the knot vector of structure.
+		/// </summary>
+		static int GetKnotSpanIndex(const LN_KnotStructure& structure, double knot);
+
 		static std::vector<double> Rescale(const std::vector<double>& knotVector, double min, double max);
 
 		/// <summary>
@@ -71,6 +99,36 @@ namespace LNLib
 		/// The NURBS Book 2nd Edition Page572
 		/// </summary>
 		static bool IsUniform(const std::vector<double>& knotVector);
+
+		/// <summary>
+		/// Knot vector after degree elevation, where every distinct knot gains times in multiplicity.
+		/// </summary>
+		static std::vector<double> GetElevatedKnotVector(const std::vector<double>& knotVector, int times);
+
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page164
+		/// Algorithm A5.5
+		/// The knot vector and blending factors of refining [knotVector] by the sorted [insertKnotElements],
+		/// to be replayed on control points by ControlPointsUtils::RefineControlPoints.
+		/// </summary>
+		static void GetKnotRefinement(int degree, const std::vector<double>& knotVector, const std::vector<double>& insertKnotElements, LN_KnotRefinement& refinement);
+
+		/// <summary>
+		/// As above, with the spans of the insert knots taken from the prebuilt [structure] of [knotVector].
+		/// </summary>
+		static void GetKnotRefinement(const LN_KnotStructure& structure, const std::vector<double>& knotVector, const std::vector<double>& insertKnotElements, LN_KnotRefinement& refinement);
+
+		/// <summary>
+		/// Get the parameter range made of the knot span containing [knot] and one non-empty span on each side of it,
+		/// clamped to the domain of [knotVector].
+		/// </summary>
+		static void GetNeighborhoodRange(int degree, const std::vector<double>& knotVector, double knot, double& startParam, double& endParam);
+
+		/// <summary>
+		/// Whether [param] lies on a bound of the neighborhood [startParam, endParam] that is not an end of the domain of [knotVector],
+		/// i.e. a search restricted to the neighborhood stopped at its border instead of converging inside the domain.
+		/// </summary>
+		static bool IsOnInteriorBound(int degree, const std::vector<double>& knotVector, double param, double startParam, double endParam);
 	};
 
 }
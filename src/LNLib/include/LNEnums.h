@@ -55,6 +55,7 @@ namespace LNLib
 		Simpson = 0,
 		GaussLegendre = 1,
 		Chebyshev = 2,
+		GaussKronrod = 3,
 	};
 
 }
@@ -54,6 +54,150 @@ namespace LNLib
 
 	typedef LN_BsplineSurface<XYZW> LNLIB_EXPORT LN_NurbsSurface;
 
+	/// <summary>
+	/// One Bezier segment of a decomposed curve, covering [StartParameter, EndParameter] of the original curve.
+	/// MinPoint and MaxPoint bound the segment by the convex hull property.
+	/// </summary>
+	struct LNLIB_EXPORT LN_BezierSegment
+	{
+		double StartParameter;
+		double EndParameter;
+		LN_NurbsCurve Segment;
+		XYZ MinPoint;
+		XYZ MaxPoint;
+		std::vector<double> SampleParams;
+		std::vector<XYZ> SamplePoints;
+	};
+
+	/// <summary>
+	/// Bezier patches of a surface in one buffer. Patch (i, j) covers [ParamsU[i], ParamsU[i + 1]] x [ParamsV[j], ParamsV[j + 1]]
+	/// and lies over knot spans SpansU[i] and SpansV[j] of the decomposed surface.
+	/// Its (DegreeU + 1) * (DegreeV + 1) control points start at (i * SpansV.size() + j) * (DegreeU + 1) * (DegreeV + 1), row by row.
+	/// </summary>
+	struct LNLIB_EXPORT LN_BezierPatches
+	{
+		int DegreeU;
+		int DegreeV;
+		std::vector<double> ParamsU;
+		std::vector<double> ParamsV;
+		std::vector<int> SpansU;
+		std::vector<int> SpansV;
+		std::vector<XYZW> ControlPoints;
+	};
+
+	/// <summary>
+	/// Distinct knots of a knot vector in increasing order, built in one pass so that repeated queries do not rescan it.
+	/// SpanStarts[i] is the index of the knot span starting at Knots[i] (its last occurrence in the knot vector),
+	/// and Continuities[i] = Degree - Multiplicities[i].
+	/// </summary>
+	struct LNLIB_EXPORT LN_KnotStructure
+	{
+		int Degree;
+		std::vector<double> Knots;
+		std::vector<int> Multiplicities;
+		std::vector<int> SpanStarts;
+		std::vector<int> Continuities;
+	};
+
+	/// <summary>
+	/// Knot refinement by Algorithm A5.5 reduced to what depends on the knots only,
+	/// so that it can be replayed on any number of control point rows.
+	/// Copies[j] control points are moved before the blend of the j-th inserted knot from the right,
+	/// whose Degree blending factors start at Alphas[j * Degree].
+	/// </summary>
+	struct LNLIB_EXPORT LN_KnotRefinement
+	{
+		int Degree;
+		int SpanStart;
+		int SpanEnd;
+		std::vector<double> KnotVector;
+		std::vector<int> Copies;
+		std::vector<double> Alphas;
+	};
+
+	/// <summary>
+	/// Affine parameter map t = Scale * s + Offset from the parameter s of a view to the parameter t of the geometry it refers to.
+	/// </summary>
+	struct LNLIB_EXPORT LN_ParameterMap
+	{
+		double Scale;
+		double Offset;
+	};
+
+	/// <summary>
+	/// A curve seen through a parameter map, so that reparameterization does not copy it.
+	/// Curve is not owned and must outlive the view.
+	/// </summary>
+	struct LNLIB_EXPORT LN_CurveView
+	{
+		const LN_NurbsCurve* Curve;
+		LN_ParameterMap Map;
+	};
+
+	/// <summary>
+	/// A surface seen through one parameter map per direction.
+	/// Surface is not owned and must outlive the view.
+	/// </summary>
+	struct LNLIB_EXPORT LN_SurfaceView
+	{
+		const LN_NurbsSurface* Surface;
+		LN_ParameterMap MapU;
+		LN_ParameterMap MapV;
+	};
+
+	/// <summary>
+	/// Prepared data for repeated point inversion on one curve.
+	/// </summary>
+	struct LNLIB_EXPORT LN_CurveProjection
+	{
+		std::vector<LN_BezierSegment> Segments;
+	};
+
+	/// <summary>
+	/// Cumulative arc length of a curve at its distinct knots.
+	/// Lengths[i] is the length of the curve between Params[0] and Params[i].
+	/// </summary>
+	struct LNLIB_EXPORT LN_ArcLengthTable
+	{
+		LN_NurbsCurve Curve;
+		std::vector<double> Params;
+		std::vector<double> Lengths;
+	};
+
+	/// <summary>
+	/// Mass properties of a closed surface set with unit density.
+	/// InertiaTensor is the 3x3 tensor about Centroid.
+	/// </summary>
+	struct LNLIB_EXPORT LN_MassProperties
+	{
+		double Area;
+		double Volume;
+		XYZ Centroid;
+		std::vector<std::vector<double>> InertiaTensor;
+	};
+
+	/// <summary>
+	/// Convergence of iterative fitting.
+	/// MaxErrors[i] and RmsErrors[i] are the distances from the fitted points to the result of iteration i,
+	/// iteration 0 being the fit at the initial parameters.
+	/// </summary>
+	struct LNLIB_EXPORT LN_FittingReport
+	{
+		std::vector<double> MaxErrors;
+		std::vector<double> RmsErrors;
+	};
+
+	/// <summary>
+	/// Singularities found while offsetting a curve, in parameters of the base curve.
+	/// CuspParameters are where the radius of curvature equals the offset distance.
+	/// SelfIntersections holds the parameter pairs (U < V) where the offset crosses itself.
+	/// </summary>
+	struct LNLIB_EXPORT LN_OffsetReport
+	{
+		std::vector<double> CuspParameters;
+		std::vector<UV> SelfIntersections;
+	};
+
 	struct LNLIB_EXPORT LN_Mesh
 	{
 		std::vector<XYZ> Vertices;
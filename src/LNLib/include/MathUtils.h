@@ -12,7 +12,9 @@
 
 #include "LNLibDefinitions.h"
 #include "Constants.h"
+#include "MatrixXd.h"
 #include <vector>
+#include <cmath>
 
 namespace LNLib
 {
@@ -85,19 +87,141 @@ namespace LNLib
 		}
 
 		static std::vector<std::vector<double>> MatrixMultiply(const std::vector<std::vector<double>>& left, const std::vector<std::vector<double>>& right);
-	
+
+		static MatrixXd MatrixMultiply(const MatrixXd& left, const MatrixXd& right);
+
 		static std::vector<std::vector<double>> MakeDiagonal(int size);
-		
+
 		static std::vector<std::vector<double>> CreateMatrix(int row, int column);
 
 		static double GetDeterminant(const std::vector<std::vector<double>>& matrix);
 
+		static double GetDeterminant(const MatrixXd& matrix);
+
 		static bool MakeInverse(const std::vector<std::vector<double>>& matrix, std::vector<std::vector<double>>& inverse);
 
+		static bool MakeInverse(const MatrixXd& matrix, MatrixXd& inverse);
+
 		/// <summary>
 		/// matrix * result = right.
 		/// </summary>
 		static std::vector<std::vector<double>> SolveLinearSystem(const std::vector<std::vector<double>>& matrix, const std::vector<std::vector<double>>& right);
+
+		/// <summary>
+		/// matrix * result = right, solved in place on the contiguous storage.
+		/// </summary>
+		static MatrixXd SolveLinearSystem(const MatrixXd& matrix, const MatrixXd& right);
+
+		/// <summary>
+		/// matrix * result = right, where matrix is a banded n x n matrix with lower and upper bandwidth,
+		/// stored row by row as band(i, j - i + lower) = matrix[i][j] for i - lower <= j <= i + upper.
+		/// Uses LU decomposition with partial pivoting in O(n * lower * (lower + upper)) time and O(n * (lower + upper)) memory.
+		/// Returns false if matrix is singular.
+		/// </summary>
+		static bool SolveBandedLinearSystem(const MatrixXd& band, int lower, int upper, const MatrixXd& right, MatrixXd& result);
+
+		/// <summary>
+		/// LU decomposition with partial pivoting of a banded matrix stored as in SolveBandedLinearSystem.
+		/// On return band holds the factors with width 2 * lower + upper + 1 and pivots the row interchanges.
+		/// Returns false if matrix is singular.
+		/// </summary>
+		static bool BandedLUDecomposition(MatrixXd& band, int lower, int upper, std::vector<int>& pivots);
+
+		/// <summary>
+		/// Solve with factors from BandedLUDecomposition, overwriting each column of right with the result.
+		/// </summary>
+		static void BandedLUSolve(const MatrixXd& lu, int lower, int upper, const std::vector<int>& pivots, MatrixXd& right);
+
+		/// <summary>
+		/// Cholesky decomposition of a symmetric positive definite banded matrix,
+		/// stored by its lower half as band(i, j - i + bandwidth) = matrix[i][j] for i - bandwidth <= j <= i.
+		/// On return band holds the lower triangular factor in the same storage.
+		/// Returns false if matrix is not positive definite.
+		/// </summary>
+		static bool BandedCholeskyDecomposition(MatrixXd& band, int bandwidth);
+
+		/// <summary>
+		/// Solve with the factor from BandedCholeskyDecomposition, overwriting each column of right with the result.
+		/// </summary>
+		static void BandedCholeskySolve(const MatrixXd& factor, int bandwidth, MatrixXd& right);
+
+		/// <summary>
+		/// Jacobi preconditioned conjugate gradient for a symmetric positive semidefinite matrix,
+		/// given by multiply(x, y) computing y = matrix * x, and its diagonal.
+		/// result holds the initial guess and receives the solution.
+		/// Stops when the residual norm is below tolerance times the norm of right, returns the number of iterations.
+		/// </summary>
+		template<typename Multiply>
+		static int ConjugateGradient(Multiply multiply, const std::vector<double>& diagonal, const std::vector<double>& right, std::vector<double>& result, double tolerance, int maxIterations)
+		{
+			int size = static_cast<int>(right.size());
+			std::vector<double> r(size);
+			std::vector<double> z(size);
+			std::vector<double> p(size);
+			std::vector<double> q(size);
+
+			multiply(result, q);
+			double rightNorm = 0.0;
+			for (int i = 0; i < size; i++)
+			{
+				r[i] = right[i] - q[i];
+				rightNorm += right[i] * right[i];
+			}
+			double limit = tolerance * tolerance * rightNorm;
+
+			auto precondition = [&]()
+			{
+				double rz = 0.0;
+				for (int i = 0; i < size; i++)
+				{
+					z[i] = diagonal[i] > 0.0 ? r[i] / diagonal[i] : r[i];
+					rz += r[i] * z[i];
+				}
+				return rz;
+			};
+
+			double rz = precondition();
+			p = z;
+			for (int iteration = 0; iteration < maxIterations; iteration++)
+			{
+				double residual = 0.0;
+				for (int i = 0; i < size; i++)
+				{
+					residual += r[i] * r[i];
+				}
+				if (residual <= limit)
+				{
+					return iteration;
+				}
+
+				multiply(p, q);
+				double pq = 0.0;
+				for (int i = 0; i < size; i++)
+				{
+					pq += p[i] * q[i];
+				}
+				if (pq <= 0.0)
+				{
+					return iteration;
+				}
+
+				double alpha = rz / pq;
+				for (int i = 0; i < size; i++)
+				{
+					result[i] += alpha * p[i];
+					r[i] -= alpha * q[i];
+				}
+
+				double next = precondition();
+				double beta = next / rz;
+				rz = next;
+				for (int i = 0; i < size; i++)
+				{
+					p[i] = z[i] + beta * p[i];
+				}
+			}
+			return maxIterations;
+		}
 	};
 }
 
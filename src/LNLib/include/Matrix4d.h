@@ -58,6 +58,13 @@ namespace LNLib
 		Matrix4d Multiply(const Matrix4d& right);
 		XYZ OfPoint(const XYZ& point);
 		XYZW OfWeightedPoint(const XYZW& point);
+
+		/// <summary>
+		/// Transform count weighted points stored contiguously, as OfWeightedPoint does one by one.
+		/// Large arrays are split into blocks across threads unless isParallel is false, for callers already running in parallel.
+		/// points and transformed may be the same array.
+		/// </summary>
+		void OfWeightedPoints(const XYZW* points, int count, XYZW* transformed, bool isParallel = true) const;
 		XYZ OfVector(const XYZ& vector);
 
 	public:
@@ -0,0 +1,63 @@
+/*
+ * Author:
+ * 2026/10/16 - Yuqing Liang (BIMCoder Liang)
+ * bim.frankliang@foxmail.com
+ * 微信公众号：BIMCoder梁老师
+ *
+ * Use of this source code is governed by a GPL-3.0 license that can be found in
+ * the LICENSE file.
+ */
+
+#pragma once
+#include "LNLibDefinitions.h"
+#include <cstddef>
+#include <vector>
+
+namespace LNLib
+{
+	/// <summary>
+	/// Dense rows * columns matrix of doubles stored row by row in one contiguous block,
+	/// so that solvers work on it in place without copying.
+	/// </summary>
+	class LNLIB_EXPORT MatrixXd
+	{
+	public:
+
+		MatrixXd();
+		MatrixXd(int rows, int columns, double value = 0.0);
+		explicit MatrixXd(const std::vector<std::vector<double>>& matrix);
+
+	public:
+
+		static MatrixXd CreateIdentity(int size);
+
+	public:
+
+		int GetRowCount() const { return m_rows; }
+		int GetColumnCount() const { return m_columns; }
+		bool IsEmpty() const { return m_rows == 0 || m_columns == 0; }
+
+		double* GetData() { return m_data.data(); }
+		const double* GetData() const { return m_data.data(); }
+		double* GetRow(int row) { return m_data.data() + static_cast<std::size_t>(row) * m_columns; }
+		const double* GetRow(int row) const { return m_data.data() + static_cast<std::size_t>(row) * m_columns; }
+
+		double& operator()(int row, int column) { return m_data[static_cast<std::size_t>(row) * m_columns + column]; }
+		double operator()(int row, int column) const { return m_data[static_cast<std::size_t>(row) * m_columns + column]; }
+
+		/// <summary>
+		/// Change the size, keeping the entries that remain inside and setting new ones to zero.
+		/// </summary>
+		void Resize(int rows, int columns);
+		void SetZero();
+		void SwapRows(int row1, int row2);
+
+		MatrixXd GetTranspose() const;
+		std::vector<std::vector<double>> ToArray() const;
+
+	private:
+		int m_rows;
+		int m_columns;
+		std::vector<double> m_data;
+	};
+}
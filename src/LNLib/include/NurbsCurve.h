@@ -67,6 +67,11 @@ namespace LNLib
 		/// </summary>
 		static int InsertKnot(const LN_NurbsCurve& curve, double insertKnot, int times, LN_NurbsCurve& result);
 
+		/// <summary>
+		/// As above, with the span and multiplicity of [insertKnot] looked up in the prebuilt [structure] of curve.KnotVector.
+		/// </summary>
+		static int InsertKnot(const LN_NurbsCurve& curve, const LN_KnotStructure& structure, double insertKnot, int times, LN_NurbsCurve& result);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page155
 		/// Algorithm A5.2
@@ -81,6 +86,11 @@ namespace LNLib
 		/// </summary>
 		static void RefineKnotVector(const LN_NurbsCurve& curve, std::vector<double>& insertKnotElements, LN_NurbsCurve& result);
 
+		/// <summary>
+		/// As above, with the spans of [insertKnotElements] looked up in the prebuilt [structure] of curve.KnotVector.
+		/// </summary>
+		static void RefineKnotVector(const LN_NurbsCurve& curve, const LN_KnotStructure& structure, std::vector<double>& insertKnotElements, LN_NurbsCurve& result);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page173
 		/// Algorithm A5.6
@@ -127,18 +137,62 @@ namespace LNLib
 		/// </summary>
 		static double GetParamOnCurve(const LN_NurbsCurve& curve, const XYZ& givenPoint);
 
+		/// <summary>
+		/// Point inversion warm-started from a known nearby parameter, e.g. the result for the previous point of a path.
+		/// Newton iteration runs inside the knot span of initialParam and its two neighbours,
+		/// falls back to the global search when it does not converge to an interior point there.
+		/// </summary>
+		static double GetParamOnCurve(const LN_NurbsCurve& curve, const XYZ& givenPoint, double initialParam);
+
+		/// <summary>
+		/// Prepare curve for repeated point inversion.
+		/// The curve is decomposed into Bezier segments, each with its bounding box and a few samples.
+		/// </summary>
+		static void CreateProjection(const LN_NurbsCurve& curve, LN_CurveProjection& projection);
+
+		/// <summary>
+		/// Point inversion on a prepared curve.
+		/// Segments whose bounding box is farther than the best distance found so far are skipped,
+		/// Newton iteration only runs on the remaining ones.
+		/// </summary>
+		static double GetParamOnCurve(const LN_CurveProjection& projection, const XYZ& givenPoint);
+
+		/// <summary>
+		/// Point inversion of many points on a prepared curve, running in parallel.
+		/// distances[i] is the distance from givenPoints[i] to its projection C(params[i]).
+		/// </summary>
+		static void GetParamsOnCurve(const LN_CurveProjection& projection, const std::vector<XYZ>& givenPoints, std::vector<double>& params, std::vector<double>& distances);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page236
 		/// Curve make Transform.
 		/// </summary>
 		static void CreateTransformed(const LN_NurbsCurve& curve, const Matrix4d& matrix, LN_NurbsCurve& result);
 
+		/// <summary>
+		/// Transform many curves by one matrix, in parallel over the curves.
+		/// </summary>
+		static void CreateTransformed(const std::vector<LN_NurbsCurve>& curves, const Matrix4d& matrix, std::vector<LN_NurbsCurve>& result);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page241
 		/// Reparameterization of curve.
 		/// </summary>
 		static void Reparametrize(const LN_NurbsCurve& curve, double min, double max, LN_NurbsCurve& result);
 
+		/// <summary>
+		/// Reparameterize the curve to [min, max] without copying it.
+		/// The view refers to curve, which must outlive it.
+		/// </summary>
+		static void Reparametrize(const LN_NurbsCurve& curve, double min, double max, LN_CurveView& view);
+
+		static XYZ GetPointOnCurve(const LN_CurveView& view, double paramT);
+
+		/// <summary>
+		/// Derivatives with respect to the view parameter, the k-th one scaled by Map.Scale^k.
+		/// </summary>
+		static std::vector<XYZ> ComputeRationalCurveDerivatives(const LN_CurveView& view, int derivative, double paramT);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page255
 		/// Reparameterization using a linear rational function : (alpha * u + beta)/(gamma * u + delta)
@@ -166,11 +220,28 @@ namespace LNLib
 		/// </summary>
 		static bool Merge(const LN_NurbsCurve& left, const LN_NurbsCurve& right, LN_NurbsCurve& result);
 
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page472
+		/// Bring curves to a common degree and knot vector on the parameter range of the first curve.
+		/// The knot vectors are merged once and each curve is elevated and refined on its own, in parallel.
+		/// </summary>
+		static void MakeCompatible(const std::vector<LN_NurbsCurve>& curves, std::vector<LN_NurbsCurve>& result);
+
 		/// <summary>
 		/// Offset curve makes bigger or smaller.
+		/// Tessellation points are moved along the principal normal and interpolated, so non-planar curves are supported
+		/// but the deviation from the exact offset is not controlled. Use the tolerance overload for planar curves.
 		/// </summary>
 		static void Offset(const LN_NurbsCurve& curve, double offset, LN_NurbsCurve& result);
 
+		/// <summary>
+		/// Offset a planar curve within its plane so that the result deviates at most tolerance from the exact offset.
+		/// Positive offset moves to the left of the curve seen from the plane normal, which is the inside of a counterclockwise curve.
+		/// The offset is sampled span by span, fitted by cubic least squares and refined where the error exceeds tolerance.
+		/// Cusps and self intersections of the offset are written to report.
+		/// </summary>
+		static void Offset(const LN_NurbsCurve& curve, double offset, double tolerance, LN_NurbsCurve& result, LN_OffsetReport& report);
+
 		/// <summary>
 		/// Create line represented by NURBS.
 		/// </summary>
@@ -234,6 +305,20 @@ namespace LNLib
 		/// </summary>
 		static bool LeastSquaresApproximation(int degree, const std::vector<XYZ>& throughPoints, int controlPointsCount, LN_NurbsCurve& curve);
 
+		/// <summary>
+		/// Least square curve approximation at given parameters with a given knot vector.
+		/// The first and last points are interpolated.
+		/// </summary>
+		static bool LeastSquaresApproximation(int degree, const std::vector<XYZ>& throughPoints, const std::vector<double>& params, const std::vector<double>& knotVector, LN_NurbsCurve& curve);
+
+		/// <summary>
+		/// Least square curve approximation with parameter correction.
+		/// After each fit the points are projected onto the curve and the control points are refit at the projected parameters,
+		/// keeping the knot vector, until maxIterations or until the max error improves by less than tolerance.
+		/// The result is the fit with the smallest max error, report holds the max and RMS error of each fit.
+		/// </summary>
+		static bool LeastSquaresApproximation(int degree, const std::vector<XYZ>& throughPoints, int controlPointsCount, int maxIterations, double tolerance, LN_NurbsCurve& curve, LN_FittingReport& report);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page413
 		/// Algorithm A9.6
@@ -366,6 +451,17 @@ namespace LNLib
 		/// </summary>
 		static double ApproximateLength(const LN_NurbsCurve& curve, IntegratorType type = IntegratorType::GaussLegendre);
 
+		/// <summary>
+		/// Arc length does not depend on the parameterization, so the viewed curve is integrated directly.
+		/// </summary>
+		static double ApproximateLength(const LN_CurveView& view, IntegratorType type = IntegratorType::GaussLegendre);
+
+		/// <summary>
+		/// Calculate curve arc length by adaptive Gauss-Kronrod integration of each Bezier segment,
+		/// error returns the estimated absolute error of the result.
+		/// </summary>
+		static double ApproximateLength(const LN_NurbsCurve& curve, double tolerance, double& error);
+
 		/// <summary>
 		/// Calculate parameter makes first segment length equals to given length.
 		/// </summary>
@@ -376,6 +472,24 @@ namespace LNLib
 		/// </summary>
 		static std::vector<double> GetParamsOnCurve(const LN_NurbsCurve& curve, double givenLength, IntegratorType type = IntegratorType::GaussLegendre);
 
+		/// <summary>
+		/// Build the cumulative arc length table of curve, one entry per distinct knot.
+		/// Each knot span is integrated once with the given integrator.
+		/// </summary>
+		static void CreateArcLengthTable(const LN_NurbsCurve& curve, LN_ArcLengthTable& table, IntegratorType type = IntegratorType::GaussLegendre);
+
+		/// <summary>
+		/// Calculate parameter makes first segment length equals to given length.
+		/// The knot span is found by binary search in the table,
+		/// then the parameter is solved by safeguarded Newton iteration on the Gauss-Legendre arc length inside that span.
+		/// </summary>
+		static double GetParamOnCurve(const LN_ArcLengthTable& table, double givenLength);
+
+		/// <summary>
+		/// Calculate parameters makes every segments length equals to given length.
+		/// </summary>
+		static std::vector<double> GetParamsOnCurve(const LN_ArcLengthTable& table, double givenLength);
+
 		/// <summary>
 		/// Tessellate nurbs curve.
 		/// </summary>
@@ -19,6 +19,7 @@ namespace LNLib
 	class UV;
 	class XYZ;
 	class XYZW;
+	class Matrix4d;
 	class LNLIB_EXPORT NurbsSurface
 	{
 	public:
@@ -72,6 +73,13 @@ namespace LNLib
 		/// </summary>
 		static void RefineKnotVector(const LN_NurbsSurface& surface, std::vector<double>& insertKnotElements, bool isUDirection, LN_NurbsSurface& result);
 
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page167
+		/// Algorithm A5.5
+		/// Refine both surface knot vectors in one call, either list may be empty.
+		/// </summary>
+		static void RefineKnotVector(const LN_NurbsSurface& surface, std::vector<double>& insertKnotElementsU, std::vector<double>& insertKnotElementsV, LN_NurbsSurface& result);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page177
 		/// Algorithm A5.7
@@ -79,6 +87,12 @@ namespace LNLib
 		/// </summary>
 		static std::vector<LN_NurbsSurface> DecomposeToBeziers(const LN_NurbsSurface& surface);
 
+		/// <summary>
+		/// Decompose surface into Bezier patches written to one buffer,
+		/// each strip of patches along a U span computed independently and in parallel.
+		/// </summary>
+		static void DecomposeToBeziers(const LN_NurbsSurface& surface, LN_BezierPatches& patches);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page186
 		/// Surface knot removal.
@@ -118,8 +132,47 @@ namespace LNLib
 		/// </summary>
 		static UV GetParamOnSurface(const LN_NurbsSurface& surface, const XYZ& givenPoint);
 
+		/// <summary>
+		/// Point inversion warm-started from a known nearby parameter, e.g. the result for the previous point of a path.
+		/// Newton iteration runs inside the knot spans around initialParam,
+		/// falls back to the global search when it does not converge to an interior point there.
+		/// </summary>
+		static UV GetParamOnSurface(const LN_NurbsSurface& surface, const XYZ& givenPoint, const UV& initialParam);
+
+		/// <summary>
+		/// Point inversion for a batch of points, such as a scanned point cloud.
+		/// The tessellation used for start parameters is built once and shared by all points,
+		/// and the Newton iterations run in parallel.
+		/// distances[i] is the distance from givenPoints[i] to its projection S(params[i]).
+		/// </summary>
+		static void GetParamsOnSurface(const LN_NurbsSurface& surface, const std::vector<XYZ>& givenPoints, std::vector<UV>& params, std::vector<double>& distances);
+
 		static void Reparametrize(const LN_NurbsSurface& surface, double minU, double maxU, double minV, double maxV, LN_NurbsSurface& result);
 
+		/// <summary>
+		/// Reparameterize the surface to [minU, maxU] x [minV, maxV] without copying it.
+		/// The view refers to surface, which must outlive it.
+		/// </summary>
+		static void Reparametrize(const LN_NurbsSurface& surface, double minU, double maxU, double minV, double maxV, LN_SurfaceView& view);
+
+		static XYZ GetPointOnSurface(const LN_SurfaceView& view, UV uv);
+
+		/// <summary>
+		/// Derivatives with respect to the view parameters, derivatives[k][l] scaled by MapU.Scale^k * MapV.Scale^l.
+		/// </summary>
+		static std::vector<std::vector<XYZ>> ComputeRationalSurfaceDerivatives(const LN_SurfaceView& view, int derivative, UV uv);
+
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page236
+		/// Surface make Transform, rows of the control net in parallel.
+		/// </summary>
+		static void CreateTransformed(const LN_NurbsSurface& surface, const Matrix4d& matrix, LN_NurbsSurface& result);
+
+		/// <summary>
+		/// Transform many surfaces by one matrix, in parallel over the surfaces.
+		/// </summary>
+		static void CreateTransformed(const std::vector<LN_NurbsSurface>& surfaces, const Matrix4d& matrix, std::vector<LN_NurbsSurface>& result);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page235
 		/// Surface Tangent Vector Inversion: finding the corresponding UV tangent [du dv] make T = Su*du+Sv*dv.
@@ -194,6 +247,23 @@ namespace LNLib
 		/// </summary>
 		static bool GlobalApproximation(const std::vector<std::vector<XYZ>>& throughPoints, int degreeU, int degreeV, int controlPointsRows, int controlPointsColumns, LN_NurbsSurface& surface);
 
+		/// <summary>
+		/// Global surface approximation with parameter correction.
+		/// After each fit the points are projected onto the surface and the control points are refit by the same row and column solve
+		/// at grid parameters averaged from the projections, keeping the knot vectors,
+		/// until maxIterations or until the max error improves by less than tolerance.
+		/// The result is the fit with the smallest max error, report holds the max and RMS error of each fit.
+		/// </summary>
+		static bool GlobalApproximation(const std::vector<std::vector<XYZ>>& throughPoints, int degreeU, int degreeV, int controlPointsRows, int controlPointsColumns, int maxIterations, double tolerance, LN_NurbsSurface& surface, LN_FittingReport& report);
+
+		/// <summary>
+		/// Least squares surface approximation of scattered points with fixed number of control points.
+		/// Points are parameterized by projection onto baseSurface, and knots are uniform over its domain.
+		/// smoothing weights a thin plate energy of the control net (zero for pure least squares).
+		/// The sparse normal equations are solved by preconditioned conjugate gradient.
+		/// </summary>
+		static bool ScatteredApproximation(const std::vector<XYZ>& points, const LN_NurbsSurface& baseSurface, int degreeU, int degreeV, int controlPointsRows, int controlPointsColumns, double smoothing, LN_NurbsSurface& surface);
+
 		/// <summary>
 		/// The NURBS Book 2nd Edition Page456
 		/// Create swung surface.
@@ -257,6 +327,24 @@ namespace LNLib
 		/// </summary>
 		static double ApproximateArea(const LN_NurbsSurface& surface, IntegratorType type = IntegratorType::GaussLegendre);
 
+		/// <summary>
+		/// Surface area does not depend on the parameterization, so the viewed surface is integrated directly.
+		/// </summary>
+		static double ApproximateArea(const LN_SurfaceView& view, IntegratorType type = IntegratorType::GaussLegendre);
+
+		/// <summary>
+		/// Calculate surface area by adaptive Gauss-Kronrod integration of each Bezier patch,
+		/// error returns the estimated absolute error of the result.
+		/// </summary>
+		static double ApproximateArea(const LN_NurbsSurface& surface, double tolerance, double& error);
+
+		/// <summary>
+		/// Calculate area, enclosed volume, centroid and inertia tensor (about the centroid, unit density)
+		/// of the solid bounded by surfaces, using the divergence theorem on every Bezier patch.
+		/// Surfaces must form a closed set with consistent orientation.
+		/// </summary>
+		static void ComputeMassProperties(const std::vector<LN_NurbsSurface>& surfaces, LN_MassProperties& properties);
+
 		/// <summary>
 		/// Triangulate nurbs surface.
 		/// According to https://github.com/nortikin/sverchok/blob/master/utils/adaptive_surface.py
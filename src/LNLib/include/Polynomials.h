@@ -123,6 +123,12 @@ namespace LNLib
 		/// Compute inverse of pth-degree Bezier matrix.
 		/// </summary>
 		static std::vector<std::vector<double>> PowerToBezierMatrix(int degree, const std::vector<std::vector<double>>& matrix);
+
+		/// <summary>
+		/// The NURBS Book 2nd Edition Page206
+		/// Coefficients of Bezier degree elevation from degree to degree + times, bezalfs[i][j] in Algorithm A5.9.
+		/// </summary>
+		static std::vector<std::vector<double>> GetDegreeElevationCoefficients(int degree, int times);
 	};
 
 }
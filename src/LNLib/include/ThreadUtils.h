@@ -0,0 +1,108 @@
+/*
+ * Author:
+ * 2026/10/16 - Yuqing Liang (BIMCoder Liang)
+ * bim.frankliang@foxmail.com
+ * 微信公众号：BIMCoder梁老师
+ *
+ * Use of this source code is governed by a GPL-3.0 license that can be found in
+ * the LICENSE file.
+ */
+
+#pragma once
+
+#include "LNLibDefinitions.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+
+namespace LNLib
+{
+	class LNLIB_EXPORT ThreadUtils
+	{
+	public:
+
+		/// <summary>
+		/// Number of worker threads used by parallel algorithms.
+		/// </summary>
+		static int GetThreadCount()
+		{
+			unsigned int count = std::thread::hardware_concurrency();
+			return count == 0 ? 1 : static_cast<int>(count);
+		}
+
+		/// <summary>
+		/// Call function(i) for every i in [start, end) on a group of worker threads.
+		/// Indices are handed out in blocks of blockSize, so neighbouring indices are processed by the same thread.
+		/// The first exception thrown by any worker is rethrown on the calling thread.
+		/// </summary>
+		template<typename Function>
+		static void ParallelFor(int start, int end, Function function, int blockSize = 1)
+		{
+			int count = end - start;
+			if (count <= 0) return;
+			blockSize = std::max(1, blockSize);
+
+			int blocks = (count + blockSize - 1) / blockSize;
+			int threadCount = std::min(GetThreadCount(), blocks);
+			if (threadCount <= 1)
+			{
+				for (int i = start; i < end; i++)
+				{
+					function(i);
+				}
+				return;
+			}
+
+			std::atomic<int> next(start);
+			std::exception_ptr exception = nullptr;
+			std::mutex exceptionMutex;
+
+			auto worker = [&]()
+			{
+				while (true)
+				{
+					int first = next.fetch_add(blockSize);
+					if (first >= end) break;
+					int last = std::min(first + blockSize, end);
+					try
+					{
+						for (int i = first; i < last; i++)
+						{
+							function(i);
+						}
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(exceptionMutex);
+						if (exception == nullptr)
+						{
+							exception = std::current_exception();
+						}
+						next.store(end);
+						break;
+					}
+				}
+			};
+
+			std::vector<std::thread> threads;
+			threads.reserve(threadCount - 1);
+			for (int i = 0; i < threadCount - 1; i++)
+			{
+				threads.emplace_back(worker);
+			}
+			worker();
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+
+			if (exception != nullptr)
+			{
+				std::rethrow_exception(exception);
+			}
+		}
+	};
+}
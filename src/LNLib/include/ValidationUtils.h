@@ -30,6 +30,12 @@ namespace LNLib
 		/// </summary>
 		static bool IsValidKnotVector(const std::vector<double>& knotVector);
 
+		/// <summary>
+		/// The knots read by basis function evaluation on span spanIndex, 
+		/// from spanIndex - degree + 1 to spanIndex + degree, exist and are nondecreasing.
+		/// </summary>
+		static bool IsValidKnotVector(const std::vector<double>& knotVector, int spanIndex, int degree);
+
 		static bool IsValidBspline(int degree, int knotVectorCount, int controlPointsCount);
 
 		static bool IsValidNurbs(int degree, int knotVectorCount, int weightedControlPointsCount);
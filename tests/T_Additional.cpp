@@ -5,6 +5,8 @@
 #include "XYZW.h"
 #include "MathUtils.h"
 #include "LNObject.h"
+#include "Integrator.h"
+#include <thread>
 
 using namespace LNLib;
 
@@ -66,6 +68,36 @@ TEST(Test_Additional, ApproximateLength)
 	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(arcParameters[2], 0.75));
 }
 
+TEST(Test_Additional, ArcLengthTable)
+{
+	int degree = 2;
+	std::vector<double> kv = { 0,0,0,1,2,3,3,3 };
+	std::vector<XYZW> cps = { XYZW(XYZ(0,0,0),1), XYZW(XYZ(1,1,0),4), XYZW(XYZ(3,2,0),1), XYZW(XYZ(4,1,0),1), XYZW(XYZ(5,-1,0),1) };
+	LN_NurbsCurve curve;
+	curve.Degree = degree;
+	curve.KnotVector = kv;
+	curve.ControlPoints = cps;
+
+	LN_ArcLengthTable table;
+	NurbsCurve::CreateArcLengthTable(curve, table);
+	EXPECT_EQ(table.Params.size(), 4);
+	double totalLength = NurbsCurve::ApproximateLength(curve);
+	EXPECT_NEAR(table.Lengths.back(), totalLength, Constants::DistanceEpsilon);
+
+	double step = totalLength / 7.0;
+	std::vector<double> params = NurbsCurve::GetParamsOnCurve(table, step);
+	ASSERT_EQ(params.size(), 6);
+	for (int i = 0; i < params.size(); i++)
+	{
+		LN_NurbsCurve left;
+		LN_NurbsCurve right;
+		EXPECT_TRUE(NurbsCurve::SplitAt(curve, params[i], left, right));
+		EXPECT_NEAR(NurbsCurve::ApproximateLength(left), (i + 1) * step, Constants::DistanceEpsilon);
+	}
+	EXPECT_DOUBLE_EQ(NurbsCurve::GetParamOnCurve(table, 0.0), 0.0);
+	EXPECT_DOUBLE_EQ(NurbsCurve::GetParamOnCurve(table, 2 * totalLength), 3.0);
+}
+
 TEST(Test_Additional, Normal)
 {
 	XYZ center = XYZ(0, 0, 0);
@@ -201,6 +233,35 @@ TEST(Test_Additional, Area_ChebyShev)
 	EXPECT_NEAR(area, standardArea, 2e-3);
 }
 
+TEST(Test_Additional, Area_GaussKronrod)
+{
+	LN_NurbsSurface surface;
+	double standardArea;
+	NURBSSurfaceForAreaTest(surface, standardArea);
+	double error = 0.0;
+	double area = NurbsSurface::ApproximateArea(surface, 1e-6, error);
+	//notice the abs_error
+	EXPECT_NEAR(area, standardArea, 7e-5);
+	EXPECT_LE(error, 1e-6);
+	EXPECT_NEAR(NurbsSurface::ApproximateArea(surface, IntegratorType::GaussKronrod), area, Constants::DistanceEpsilon);
+}
+
+TEST(Test_Additional, Length_GaussKronrod)
+{
+	LN_NurbsCurve curve;
+	double radius = 100;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, radius, radius, curve);
+	double error = 0.0;
+	double length = NurbsCurve::ApproximateLength(curve, 1e-8, error);
+	EXPECT_NEAR(length, 2 * Constants::Pi * radius, 1e-7);
+	EXPECT_LE(error, 1e-8);
+	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(NurbsCurve::ApproximateLength(curve, IntegratorType::GaussKronrod), 2 * Constants::Pi * radius));
+
+	LN_ArcLengthTable table;
+	NurbsCurve::CreateArcLengthTable(curve, table, IntegratorType::GaussKronrod);
+	EXPECT_NEAR(table.Lengths.back(), length, Constants::DistanceEpsilon);
+}
+
 TEST(Test_Additional, MergeCurve)
 {
 	// Make line.
@@ -273,3 +334,186 @@ TEST(Test_Additional, MergeCurve)
 		EXPECT_LT(std::fabs(angle), Constants::AngleEpsilon);
 	}
 }
+
+TEST(Test_Additional, OffsetCurve)
+{
+	// Counterclockwise circle, positive offset moves inside.
+	LN_NurbsCurve circle;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, 10, 10, circle);
+	LN_NurbsCurve offsetCircle;
+	LN_OffsetReport report;
+	double tolerance = 1e-4;
+	NurbsCurve::Offset(circle, 2, tolerance, offsetCircle, report);
+	EXPECT_TRUE(report.CuspParameters.empty());
+	EXPECT_TRUE(report.SelfIntersections.empty());
+	for (int i = 0; i <= 100; i++)
+	{
+		XYZ point = NurbsCurve::GetPointOnCurve(offsetCircle, i / 100.0);
+		EXPECT_NEAR(point.Length(), 8, tolerance);
+	}
+
+	// Radius of curvature at the ends of the major axis is 1.6,
+	// so an inner offset of 3 has a swallowtail with two cusps and one crossing at each end.
+	LN_NurbsCurve ellipse;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, 10, 4, ellipse);
+	LN_NurbsCurve offsetEllipse;
+	NurbsCurve::Offset(ellipse, 3, tolerance, offsetEllipse, report);
+	EXPECT_EQ(report.CuspParameters.size(), 4);
+	EXPECT_EQ(report.SelfIntersections.size(), 2);
+	for (const UV& crossing : report.SelfIntersections)
+	{
+		XYZ point0 = NurbsCurve::GetPointOnCurve(offsetEllipse, crossing[0]);
+		XYZ point1 = NurbsCurve::GetPointOnCurve(offsetEllipse, crossing[1]);
+		EXPECT_LT(point0.Distance(point1), tolerance);
+		EXPECT_NEAR(point0.GetY(), 0, tolerance);
+	}
+	for (int i = 0; i <= 500; i++)
+	{
+		double t = i / 500.0;
+		std::vector<XYZ> ders = NurbsCurve::ComputeRationalCurveDerivatives(ellipse, 1, t);
+		XYZ exact = ders[0] + 3 * XYZ(0, 0, 1).CrossProduct(ders[1]).Normalize();
+		EXPECT_LT(NurbsCurve::GetPointOnCurve(offsetEllipse, t).Distance(exact), tolerance);
+	}
+}
+
+TEST(Test_Additional, OffsetCurveAlongNormal)
+{
+	// The principal normal of a helix points to its axis, so the offset is a helix of smaller radius.
+	int size = 200;
+	std::vector<XYZ> throughPoints(size);
+	for (int i = 0; i < size; i++)
+	{
+		double t = 4 * Constants::Pi * i / (size - 1);
+		throughPoints[i] = XYZ(10 * std::cos(t), 10 * std::sin(t), 2 * t);
+	}
+	LN_NurbsCurve helix;
+	NurbsCurve::GlobalInterpolation(3, throughPoints, helix);
+
+	LN_NurbsCurve offsetHelix;
+	NurbsCurve::Offset(helix, 2, offsetHelix);
+	for (int i = 0; i <= 100; i++)
+	{
+		XYZ point = NurbsCurve::GetPointOnCurve(offsetHelix, i / 100.0);
+		EXPECT_NEAR(std::sqrt(point.GetX() * point.GetX() + point.GetY() * point.GetY()), 8, 1e-2);
+	}
+
+	LN_NurbsCurve same;
+	NurbsCurve::Offset(helix, 0, same);
+	EXPECT_EQ(same.ControlPoints.size(), helix.ControlPoints.size());
+}
+
+TEST(Test_Additional, ChebyshevSeriesCache)
+{
+	const std::vector<double>& series = Integrator::GetChebyshevSeries();
+	EXPECT_EQ(&series, &Integrator::GetChebyshevSeries(100));
+	EXPECT_EQ(series, Integrator::ChebyshevSeries(100));
+
+	const std::vector<double>& largeSeries = Integrator::GetChebyshevSeries(200);
+	EXPECT_EQ(largeSeries.size(), 200);
+	EXPECT_NE(&series, &largeSeries);
+	EXPECT_EQ(&largeSeries, &Integrator::GetChebyshevSeries(200));
+}
+
+TEST(Test_Additional, ConcurrentIntegration)
+{
+	LN_NurbsSurface surface;
+	double standardArea;
+	NURBSSurfaceForAreaTest(surface, standardArea);
+
+	LN_NurbsCurve curve;
+	double radius = 100;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, radius, radius, curve);
+
+	double expectedArea = NurbsSurface::ApproximateArea(surface, IntegratorType::Chebyshev);
+	double expectedLength = NurbsCurve::ApproximateLength(curve, IntegratorType::Chebyshev);
+
+	int threadCount = 4;
+	std::vector<double> areas(threadCount);
+	std::vector<double> lengths(threadCount);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back([&, i]()
+			{
+				areas[i] = NurbsSurface::ApproximateArea(surface, IntegratorType::Chebyshev);
+				lengths[i] = NurbsCurve::ApproximateLength(curve, IntegratorType::Chebyshev);
+			});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	for (int i = 0; i < threadCount; i++)
+	{
+		EXPECT_DOUBLE_EQ(areas[i], expectedArea);
+		EXPECT_DOUBLE_EQ(lengths[i], expectedLength);
+	}
+}
+
+namespace
+{
+	class ArcSpeedFunction : public IntegrationFunction
+	{
+		double operator()(double parameter, void* customData)
+		{
+			LN_NurbsCurve* curve = (LN_NurbsCurve*)customData;
+			return NurbsCurve::ComputeRationalCurveDerivatives(*curve, 1, parameter)[1].Length();
+		}
+	};
+
+	class EllipseSpeedFunction : public IntegrationFunction
+	{
+		double operator()(double parameter, void* customData)
+		{
+			double b = *(double*)customData;
+			return std::sqrt(std::sin(parameter) * std::sin(parameter) + b * b * std::cos(parameter) * std::cos(parameter));
+		}
+	};
+}
+
+TEST(Test_Additional, IntegratorCallable)
+{
+	const std::vector<double>& series = Integrator::GetChebyshevSeries();
+
+	double b = 0.5;
+	EllipseSpeedFunction ellipseFunction;
+	double virtualResult = Integrator::ClenshawCurtisQuadrature(ellipseFunction, (void*)&b, 0, 2 * Constants::Pi, series);
+	double templateResult = Integrator::ClenshawCurtis([b](double t) { return std::sqrt(std::sin(t) * std::sin(t) + b * b * std::cos(t) * std::cos(t)); }, 0, 2 * Constants::Pi, series);
+	EXPECT_DOUBLE_EQ(virtualResult, templateResult);
+	EXPECT_NEAR(templateResult, 4.844224110273838, Constants::DistanceEpsilon);
+
+	LN_NurbsCurve curve;
+	double radius = 100;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, radius, radius, curve);
+	ArcSpeedFunction arcFunction;
+	virtualResult = Integrator::ClenshawCurtisQuadrature(arcFunction, (void*)&curve, 0, 1, series);
+	templateResult = Integrator::ClenshawCurtis([&curve](double t) { return NurbsCurve::ComputeRationalCurveDerivatives(curve, 1, t)[1].Length(); }, 0, 1, series);
+	EXPECT_DOUBLE_EQ(virtualResult, templateResult);
+	EXPECT_NEAR(templateResult, 2 * Constants::Pi * radius, 1e-3 * 2 * Constants::Pi * radius);
+}
+
+TEST(Test_Additional, MassProperties)
+{
+	XYZ center = XYZ(1, 2, 3);
+	double radius = 2;
+	LN_NurbsCurve profile;
+	NurbsCurve::CreateArc(center, XYZ(1, 0, 0), XYZ(0, 0, 1), -Constants::Pi / 2, Constants::Pi / 2, radius, radius, profile);
+	LN_NurbsSurface sphere;
+	NurbsSurface::CreateRevolvedSurface(center, XYZ(0, 0, 1), 2 * Constants::Pi, profile, sphere);
+
+	LN_MassProperties properties;
+	NurbsSurface::ComputeMassProperties({ sphere }, properties);
+
+	double volume = 4.0 / 3.0 * Constants::Pi * radius * radius * radius;
+	double inertia = 2.0 / 5.0 * volume * radius * radius;
+	EXPECT_NEAR(properties.Area, 4 * Constants::Pi * radius * radius, Constants::DistanceEpsilon);
+	EXPECT_NEAR(properties.Volume, volume, Constants::DistanceEpsilon);
+	EXPECT_TRUE(properties.Centroid.IsAlmostEqualTo(center));
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			EXPECT_NEAR(properties.InertiaTensor[i][j], i == j ? inertia : 0.0, Constants::DistanceEpsilon);
+		}
+	}
+}
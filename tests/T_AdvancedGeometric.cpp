@@ -6,6 +6,7 @@
 #include "XYZ.h"
 #include "XYZW.h"
 #include "MathUtils.h"
+#include "Constants.h"
 
 using namespace LNLib;
 
@@ -25,6 +26,49 @@ TEST(Test_AdvancedGeometric, Curve_GetParamOrGetPoint)
 	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(1.0, param));
 }
 
+TEST(Test_AdvancedGeometric, Curve_GetParamsOnCurve)
+{
+	int degree = 2;
+	std::vector<double> kv = { 0,0,0,1,2,3,3,3 };
+	std::vector<XYZW> cps = { XYZW(XYZ(0,0,0),1), XYZW(XYZ(1,1,0),4), XYZW(XYZ(3,2,0),1), XYZW(XYZ(4,1,0),1), XYZW(XYZ(5,-1,0),1) };
+
+	LN_NurbsCurve curve;
+	curve.Degree = degree;
+	curve.KnotVector = kv;
+	curve.ControlPoints = cps;
+
+	LN_CurveProjection projection;
+	NurbsCurve::CreateProjection(curve, projection);
+	EXPECT_EQ(projection.Segments.size(), 3);
+
+	std::vector<double> expected;
+	std::vector<XYZ> points;
+	for (int i = 0; i <= 30; i++)
+	{
+		double t = i / 10.0;
+		expected.emplace_back(t);
+		points.emplace_back(NurbsCurve::GetPointOnCurve(curve, t));
+	}
+	std::vector<double> params;
+	std::vector<double> distances;
+	NurbsCurve::GetParamsOnCurve(projection, points, params, distances);
+	ASSERT_EQ(params.size(), points.size());
+	for (int i = 0; i < points.size(); i++)
+	{
+		EXPECT_NEAR(params[i], expected[i], Constants::DistanceEpsilon);
+		EXPECT_NEAR(distances[i], 0.0, Constants::DistanceEpsilon);
+	}
+
+	LN_NurbsCurve arc;
+	double radius = 10;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, radius, radius, arc);
+	NurbsCurve::CreateProjection(arc, projection);
+	XYZ point = 1.5 * NurbsCurve::GetPointOnCurve(arc, 0.3);
+	double param = NurbsCurve::GetParamOnCurve(projection, point);
+	EXPECT_NEAR(param, 0.3, Constants::DistanceEpsilon);
+	EXPECT_NEAR(param, NurbsCurve::GetParamOnCurve(arc, point), Constants::DistanceEpsilon);
+}
+
 TEST(Test_AdvancedGeometric, Surface_GetParamOrGetPoint)
 {
 	int degreeU = 2;
@@ -104,6 +148,91 @@ TEST(Test_AdvancedGeometric, Surface_GetParamOrGetPoint)
 	EXPECT_TRUE(param.IsAlmostEqualTo(uv));
 }
 
+TEST(Test_AdvancedGeometric, Surface_GetParamsOnSurface)
+{
+	XYZ origin = XYZ(0, 0, 0);
+	XYZ xAxis = XYZ(1, 0, 0);
+	XYZ yAxis = XYZ(0, 1, 0);
+	double radius = 5;
+	double height = 5;
+	double offset = 2;
+	LN_NurbsSurface surface;
+	NurbsSurface::CreateCylindricalSurface(origin, xAxis, yAxis, 0, Constants::Pi, radius, height, surface);
+
+	std::vector<UV> uvs;
+	std::vector<XYZ> points;
+	for (int i = 1; i < 10; i++)
+	{
+		for (int j = 1; j < 10; j++)
+		{
+			UV uv = UV(i / 10.0, j / 10.0);
+			XYZ point = NurbsSurface::GetPointOnSurface(surface, uv);
+			XYZ direction = XYZ(point.GetX(), point.GetY(), 0).Normalize();
+			uvs.emplace_back(uv);
+			points.emplace_back(point + offset * direction);
+		}
+	}
+
+	std::vector<UV> params;
+	std::vector<double> distances;
+	NurbsSurface::GetParamsOnSurface(surface, points, params, distances);
+	ASSERT_EQ(params.size(), points.size());
+	ASSERT_EQ(distances.size(), points.size());
+	for (int i = 0; i < points.size(); i++)
+	{
+		EXPECT_TRUE(params[i].IsAlmostEqualTo(uvs[i]));
+		EXPECT_NEAR(distances[i], offset, Constants::DistanceEpsilon);
+	}
+}
+
+TEST(Test_AdvancedGeometric, GetParamWithInitialParam)
+{
+	int degree = 2;
+	std::vector<double> kv = { 0,0,0,1,2,3,3,3 };
+	std::vector<XYZW> cps = { XYZW(XYZ(0,0,0),1), XYZW(XYZ(1,1,0),4), XYZW(XYZ(3,2,0),1), XYZW(XYZ(4,1,0),1), XYZW(XYZ(5,-1,0),1) };
+
+	LN_NurbsCurve curve;
+	curve.Degree = degree;
+	curve.KnotVector = kv;
+	curve.ControlPoints = cps;
+
+	double previous = 0.0;
+	for (int i = 0; i <= 30; i++)
+	{
+		double t = i / 10.0;
+		XYZ point = NurbsCurve::GetPointOnCurve(curve, t);
+		double param = NurbsCurve::GetParamOnCurve(curve, point, previous);
+		EXPECT_NEAR(param, t, Constants::DistanceEpsilon);
+		previous = param;
+	}
+	XYZ beyondEnd = NurbsCurve::GetPointOnCurve(curve, 3.0) + XYZ(1, -2, 0);
+	EXPECT_NEAR(NurbsCurve::GetParamOnCurve(curve, beyondEnd, 2.5), 3.0, Constants::DistanceEpsilon);
+
+	LN_NurbsCurve arc;
+	double radius = 10;
+	NurbsCurve::CreateArc(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, 2 * Constants::Pi, radius, radius, arc);
+	XYZ point = NurbsCurve::GetPointOnCurve(arc, 0.3);
+	EXPECT_NEAR(NurbsCurve::GetParamOnCurve(arc, point, 0.25), 0.3, Constants::DistanceEpsilon);
+	point = NurbsCurve::GetPointOnCurve(arc, 0.8);
+	EXPECT_NEAR(NurbsCurve::GetParamOnCurve(arc, point, 0.05), NurbsCurve::GetParamOnCurve(arc, point), Constants::DistanceEpsilon);
+
+	LN_NurbsSurface surface;
+	NurbsSurface::CreateCylindricalSurface(XYZ(0, 0, 0), XYZ(1, 0, 0), XYZ(0, 1, 0), 0, Constants::Pi, 5, 5, surface);
+	UV previousUV = UV(0.1, 0.1);
+	for (int i = 1; i < 10; i++)
+	{
+		UV uv = UV(i / 10.0, 1 - i / 10.0);
+		XYZ surfacePoint = NurbsSurface::GetPointOnSurface(surface, uv);
+		UV param = NurbsSurface::GetParamOnSurface(surface, surfacePoint, previousUV);
+		EXPECT_NEAR(param.GetU(), uv.GetU(), Constants::DistanceEpsilon);
+		EXPECT_NEAR(param.GetV(), uv.GetV(), Constants::DistanceEpsilon);
+		previousUV = param;
+	}
+	UV corner = NurbsSurface::GetParamOnSurface(surface, NurbsSurface::GetPointOnSurface(surface, UV(0, 1)), UV(0.05, 0.95));
+	EXPECT_NEAR(corner.GetU(), 0.0, Constants::DistanceEpsilon);
+	EXPECT_NEAR(corner.GetV(), 1.0, Constants::DistanceEpsilon);
+}
+
 TEST(Test_AdvancedGeometric, Reparametrize)
 {
 	int degree = 3;
@@ -149,4 +278,73 @@ TEST(Test_AdvancedGeometric, Reparametrize)
 	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(newCps[3].GetW(), 0.01682));
 	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(newCps[4].GetW(), 0.00975));
 	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(newCps[5].GetW(), 0.008));
-}
\ No newline at end of file
+}
+
+TEST(Test_AdvancedGeometric, ReparametrizedView)
+{
+	int degree = 3;
+	std::vector<double> kv = { 2,2,2,2,3,4.5,5,5,5,5 };
+	std::vector<XYZW> cps = { XYZW(0,0,0,1), XYZW(10,10,0,2), XYZW(20,20,5,1), XYZW(30,30,0,1), XYZW(40,20,0,3), XYZW(50,10,0,1) };
+
+	LN_NurbsCurve curve;
+	curve.Degree = degree;
+	curve.KnotVector = kv;
+	curve.ControlPoints = cps;
+
+	LN_NurbsCurve copied;
+	NurbsCurve::Reparametrize(curve, 0.0, 1.0, copied);
+	LN_CurveView curveView;
+	NurbsCurve::Reparametrize(curve, 0.0, 1.0, curveView);
+	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(copied.KnotVector[4], 1.0 / 3));
+
+	for (int i = 0; i <= 10; i++)
+	{
+		double t = i / 10.0;
+		EXPECT_TRUE(NurbsCurve::GetPointOnCurve(curveView, t).IsAlmostEqualTo(NurbsCurve::GetPointOnCurve(copied, t)));
+		std::vector<XYZ> viewDers = NurbsCurve::ComputeRationalCurveDerivatives(curveView, 2, t);
+		std::vector<XYZ> copiedDers = NurbsCurve::ComputeRationalCurveDerivatives(copied, 2, t);
+		for (int k = 0; k <= 2; k++)
+		{
+			EXPECT_NEAR(viewDers[k].Distance(copiedDers[k]), 0.0, 1e-6 * copiedDers[k].Length() + Constants::DistanceEpsilon);
+		}
+	}
+	double length = NurbsCurve::ApproximateLength(curve);
+	EXPECT_NEAR(NurbsCurve::ApproximateLength(curveView), length, Constants::DistanceEpsilon);
+	EXPECT_NEAR(NurbsCurve::ApproximateLength(copied), length, Constants::DistanceEpsilon);
+	EXPECT_NEAR(NurbsCurve::ApproximateLength(curve, IntegratorType::Chebyshev), NurbsCurve::ApproximateLength(copied, IntegratorType::Chebyshev), Constants::DistanceEpsilon);
+
+	LN_NurbsSurface surface;
+	surface.DegreeU = 2;
+	surface.DegreeV = 2;
+	surface.KnotVectorU = { 0,0,0,1,2,2,2 };
+	surface.KnotVectorV = { 0,0,0,3,3,3 };
+	surface.ControlPoints =
+	{
+		{ XYZW(0,0,0,1), XYZW(0,5,1,1), XYZW(0,10,0,1) },
+		{ XYZW(5,0,2,2), XYZW(10,10,6,2), XYZW(10,20,2,2) },
+		{ XYZW(10,0,1,1), XYZW(10,5,3,1), XYZW(10,10,1,1) },
+		{ XYZW(15,0,0,1), XYZW(15,5,1,1), XYZW(15,10,0,1) },
+	};
+
+	LN_NurbsSurface copiedSurface;
+	NurbsSurface::Reparametrize(surface, 10.0, 12.0, -1.0, 1.0, copiedSurface);
+	LN_SurfaceView surfaceView;
+	NurbsSurface::Reparametrize(surface, 10.0, 12.0, -1.0, 1.0, surfaceView);
+
+	for (int i = 0; i <= 4; i++)
+	{
+		for (int j = 0; j <= 4; j++)
+		{
+			UV uv = UV(10.0 + i / 2.0, -1.0 + j / 2.0);
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(surfaceView, uv).IsAlmostEqualTo(NurbsSurface::GetPointOnSurface(copiedSurface, uv)));
+			std::vector<std::vector<XYZ>> viewDers = NurbsSurface::ComputeRationalSurfaceDerivatives(surfaceView, 1, uv);
+			std::vector<std::vector<XYZ>> copiedDers = NurbsSurface::ComputeRationalSurfaceDerivatives(copiedSurface, 1, uv);
+			EXPECT_NEAR(viewDers[1][0].Distance(copiedDers[1][0]), 0.0, 1e-6 * copiedDers[1][0].Length() + Constants::DistanceEpsilon);
+			EXPECT_NEAR(viewDers[0][1].Distance(copiedDers[0][1]), 0.0, 1e-6 * copiedDers[0][1].Length() + Constants::DistanceEpsilon);
+		}
+	}
+	double area = NurbsSurface::ApproximateArea(surface);
+	EXPECT_NEAR(NurbsSurface::ApproximateArea(surfaceView), area, Constants::DistanceEpsilon);
+	EXPECT_NEAR(NurbsSurface::ApproximateArea(copiedSurface), area, 1e-6 * area);
+	EXPECT_NEAR(NurbsSurface::ApproximateArea(surface, IntegratorType::Simpson), area, 1e-3);
+}
@@ -6,6 +6,7 @@
 #include "XYZ.h"
 #include "XYZW.h"
 #include "MathUtils.h"
+#include <cmath>
 
 using namespace LNLib;
 
@@ -154,6 +155,131 @@ TEST(Test_AdvancedSurface, LoftSurface)
 
 }
 
+TEST(Test_AdvancedSurface, MakeCompatible)
+{
+	int count = 500;
+	std::vector<LN_NurbsCurve> sections(count);
+	for (int s = 0; s < count; s++)
+	{
+		LN_NurbsCurve& section = sections[s];
+		section.Degree = 2 + s % 2;
+		double end = 1.0 + s % 3;
+		double knot = (0.25 + 0.01 * (s % 5)) * end;
+		section.KnotVector.assign(section.Degree + 1, 0.0);
+		section.KnotVector.emplace_back(knot);
+		section.KnotVector.emplace_back(0.5 * end);
+		section.KnotVector.insert(section.KnotVector.end(), section.Degree + 1, end);
+		int size = section.KnotVector.size() - section.Degree - 1;
+		for (int i = 0; i < size; i++)
+		{
+			double w = 1.0 + 0.1 * (i % 2);
+			section.ControlPoints.emplace_back(XYZW(XYZ(i, std::sin(i + 0.1 * s), s), w));
+		}
+	}
+
+	std::vector<LN_NurbsCurve> compatible;
+	NurbsCurve::MakeCompatible(sections, compatible);
+	ASSERT_EQ(compatible.size(), sections.size());
+	for (int s = 0; s < count; s++)
+	{
+		EXPECT_EQ(compatible[s].Degree, 3);
+		EXPECT_TRUE(compatible[s].KnotVector == compatible[0].KnotVector);
+		EXPECT_EQ(compatible[s].ControlPoints.size(), compatible[0].ControlPoints.size());
+
+		double end = sections[s].KnotVector.back();
+		for (int k = 0; k <= 10; k++)
+		{
+			double t = k / 10.0;
+			XYZ expected = NurbsCurve::GetPointOnCurve(sections[s], t * end);
+			XYZ actual = NurbsCurve::GetPointOnCurve(compatible[s], t);
+			EXPECT_TRUE(actual.IsAlmostEqualTo(expected));
+		}
+	}
+
+	LN_NurbsSurface surface;
+	NurbsSurface::CreateLoftSurface(sections, surface);
+	EXPECT_EQ(surface.ControlPoints.size(), compatible[0].ControlPoints.size());
+	EXPECT_TRUE(NurbsSurface::GetPointOnSurface(surface, UV(0.3, 0)).IsAlmostEqualTo(NurbsCurve::GetPointOnCurve(sections[0], 0.3)));
+}
+
+TEST(Test_AdvancedSurface, GordonSurface)
+{
+	LN_NurbsSurface base;
+	base.DegreeU = 2;
+	base.DegreeV = 2;
+	base.KnotVectorU = { 0,0,0,0.4,1,1,1 };
+	base.KnotVectorV = { 0,0,0,1,1,1 };
+	base.ControlPoints.assign(4, std::vector<XYZW>(3));
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			base.ControlPoints[i][j] = XYZW(XYZ(3.0 * i, 4.0 * j, std::sin(i + 2.0 * j)), 1.0);
+		}
+	}
+
+	std::vector<LN_NurbsCurve> rowCurves(4);
+	for (int i = 0; i < 4; i++)
+	{
+		rowCurves[i].Degree = base.DegreeV;
+		rowCurves[i].KnotVector = base.KnotVectorV;
+		rowCurves[i].ControlPoints = base.ControlPoints[i];
+	}
+	std::vector<LN_NurbsCurve> columnCurves(3);
+	for (int j = 0; j < 3; j++)
+	{
+		columnCurves[j].Degree = base.DegreeU;
+		columnCurves[j].KnotVector = base.KnotVectorU;
+		for (int i = 0; i < 4; i++)
+		{
+			columnCurves[j].ControlPoints.emplace_back(base.ControlPoints[i][j]);
+		}
+	}
+
+	// Iso-curves of the base surface, U-curves at vl and V-curves at ul.
+	std::vector<double> ul = { 0,0.2,0.55,0.8,1 };
+	std::vector<double> vl = { 0,0.35,0.7,1 };
+	std::vector<LN_NurbsCurve> uCurves(vl.size());
+	for (int i = 0; i < vl.size(); i++)
+	{
+		uCurves[i].Degree = base.DegreeU;
+		uCurves[i].KnotVector = base.KnotVectorU;
+		for (int r = 0; r < 4; r++)
+		{
+			uCurves[i].ControlPoints.emplace_back(XYZW(NurbsCurve::GetPointOnCurve(rowCurves[r], vl[i]), 1.0));
+		}
+	}
+	std::vector<LN_NurbsCurve> vCurves(ul.size());
+	for (int j = 0; j < ul.size(); j++)
+	{
+		vCurves[j].Degree = base.DegreeV;
+		vCurves[j].KnotVector = base.KnotVectorV;
+		for (int c = 0; c < 3; c++)
+		{
+			vCurves[j].ControlPoints.emplace_back(XYZW(NurbsCurve::GetPointOnCurve(columnCurves[c], ul[j]), 1.0));
+		}
+	}
+	std::vector<std::vector<XYZ>> intersectionPoints(vl.size(), std::vector<XYZ>(ul.size()));
+	for (int i = 0; i < vl.size(); i++)
+	{
+		for (int j = 0; j < ul.size(); j++)
+		{
+			intersectionPoints[i][j] = NurbsSurface::GetPointOnSurface(base, UV(ul[j], vl[i]));
+		}
+	}
+
+	LN_NurbsSurface surface;
+	NurbsSurface::CreateGordonSurface(uCurves, vCurves, intersectionPoints, surface);
+	for (int a = 0; a <= 10; a++)
+	{
+		for (int b = 0; b <= 10; b++)
+		{
+			UV uv(a / 10.0, b / 10.0);
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(surface, uv).IsAlmostEqualTo(NurbsSurface::GetPointOnSurface(base, uv)));
+		}
+	}
+}
+
 TEST(Test_AdvancedSurface, CreateSweepSurface)
 {
 	// Make circular profile.
@@ -9,6 +9,8 @@
 #include "Interpolation.h"
 #include "Intersection.h"
 #include "LNObject.h"
+#include <random>
+#include <algorithm>
 
 using namespace LNLib;
 
@@ -150,6 +152,221 @@ TEST(Test_Fitting, Interpolation)
 	}
 }
 
+TEST(Test_Fitting, LargeInterpolation)
+{
+	int degree = 3;
+	int size = 50000;
+	std::vector<XYZ> Q(size);
+	std::vector<XYZ> T(size);
+	for (int i = 0; i < size; i++)
+	{
+		double t = 0.01 * i;
+		Q[i] = XYZ(10 * cos(t), 10 * sin(t), 0.1 * t);
+		T[i] = XYZ(-10 * sin(t), 10 * cos(t), 0.1);
+	}
+	std::vector<double> params = Interpolation::GetChordParameterization(Q);
+
+	LN_NurbsCurve curve;
+	NurbsCurve::GlobalInterpolation(degree, Q, curve, params);
+	EXPECT_EQ(curve.ControlPoints.size(), size);
+	for (int i = 0; i < size; i += 997)
+	{
+		EXPECT_TRUE(NurbsCurve::GetPointOnCurve(curve, params[i]).IsAlmostEqualTo(Q[i]));
+	}
+
+	LN_NurbsCurve tangentCurve;
+	NurbsCurve::GlobalInterpolation(degree, Q, T, 1, tangentCurve);
+	EXPECT_EQ(tangentCurve.ControlPoints.size(), 2 * size);
+	for (int i = 0; i < size; i += 997)
+	{
+		EXPECT_TRUE(NurbsCurve::GetPointOnCurve(tangentCurve, params[i]).IsAlmostEqualTo(Q[i]));
+	}
+}
+
+TEST(Test_Fitting, SurfaceInterpolation)
+{
+	int rows = 40;
+	int columns = 30;
+	std::vector<std::vector<XYZ>> Q(rows, std::vector<XYZ>(columns));
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			double x = 0.2 * i;
+			double y = 0.3 * j + 0.01 * i * i;
+			Q[i][j] = XYZ(x, y, sin(x) * cos(y));
+		}
+	}
+
+	LN_NurbsSurface surface;
+	NurbsSurface::GlobalInterpolation(Q, 3, 2, surface);
+
+	std::vector<double> uk;
+	std::vector<double> vl;
+	Interpolation::GetSurfaceMeshParameterization(Q, uk, vl);
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(surface, UV(uk[i], vl[j])).IsAlmostEqualTo(Q[i][j]));
+		}
+	}
+}
+
+TEST(Test_Fitting, LargeApproximation)
+{
+	int degree = 3;
+	int size = 1000000;
+	std::vector<XYZ> Q(size);
+	for (int i = 0; i < size; i++)
+	{
+		double t = 20.0 * i / (size - 1);
+		Q[i] = XYZ(10 * cos(t), 10 * sin(t), t);
+	}
+
+	LN_NurbsCurve curve;
+	EXPECT_TRUE(NurbsCurve::LeastSquaresApproximation(degree, Q, 1000, curve));
+	EXPECT_EQ(curve.ControlPoints.size(), 1000);
+	std::vector<double> params = Interpolation::GetChordParameterization(Q);
+	for (int i = 0; i < size; i += 99991)
+	{
+		EXPECT_LT(NurbsCurve::GetPointOnCurve(curve, params[i]).Distance(Q[i]), Constants::DistanceEpsilon);
+	}
+
+	int count = 20000;
+	std::vector<XYZ> points(count);
+	std::vector<double> pointWeights(count, 1.0);
+	for (int i = 0; i < count; i++)
+	{
+		points[i] = Q[i * (size / count)];
+	}
+	pointWeights[0] = -1;
+	pointWeights[count - 1] = -1;
+	std::vector<XYZ> tangents = { XYZ(0, 10, 1), XYZ(-10 * sin(20.0), 10 * cos(20.0), 1) };
+	std::vector<int> indices = { 0, count - 1 };
+	std::vector<double> tangentWeights = { -1, 1 };
+
+	LN_NurbsCurve weighted;
+	EXPECT_TRUE(NurbsCurve::WeightedAndContrainedLeastSquaresApproximation(degree, points, pointWeights, tangents, indices, tangentWeights, 500, weighted));
+	EXPECT_TRUE(NurbsCurve::GetPointOnCurve(weighted, 0.0).IsAlmostEqualTo(points[0]));
+	EXPECT_TRUE(NurbsCurve::GetPointOnCurve(weighted, 1.0).IsAlmostEqualTo(points[count - 1]));
+	XYZ startTangent = NurbsCurve::ComputeRationalCurveDerivatives(weighted, 1, 0.0)[1];
+	EXPECT_TRUE(startTangent.IsAlmostEqualTo(tangents[0]));
+}
+
+TEST(Test_Fitting, ScatteredApproximation)
+{
+	LN_NurbsSurface plane;
+	plane.DegreeU = 2;
+	plane.DegreeV = 2;
+	plane.KnotVectorU = { 0, 0, 0, 1, 1, 1 };
+	plane.KnotVectorV = { 0, 0, 0, 1, 1, 1 };
+	plane.ControlPoints = std::vector<std::vector<XYZW>>(3, std::vector<XYZW>(3));
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			plane.ControlPoints[i][j] = XYZW(1.5 * i, 1.5 * j, 0, 1);
+		}
+	}
+
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<double> distribution(0.0, 3.0);
+	int count = 20000;
+	std::vector<XYZ> points(count);
+	for (int i = 0; i < count; i++)
+	{
+		double x = distribution(generator);
+		double y = distribution(generator);
+		points[i] = XYZ(x, y, sin(x) * cos(y));
+	}
+
+	LN_NurbsSurface surface;
+	EXPECT_TRUE(NurbsSurface::ScatteredApproximation(points, plane, 3, 3, 12, 12, 0.0, surface));
+	EXPECT_EQ(surface.ControlPoints.size(), 12);
+	for (int i = 0; i < count; i += 97)
+	{
+		XYZ point = NurbsSurface::GetPointOnSurface(surface, UV(points[i].GetX() / 3, points[i].GetY() / 3));
+		EXPECT_LT(point.Distance(points[i]), 1e-3);
+	}
+
+	LN_NurbsSurface smoothed;
+	EXPECT_TRUE(NurbsSurface::ScatteredApproximation(points, plane, 3, 3, 12, 12, 1e-2, smoothed));
+	for (int i = 0; i < count; i += 97)
+	{
+		XYZ point = NurbsSurface::GetPointOnSurface(smoothed, UV(points[i].GetX() / 3, points[i].GetY() / 3));
+		EXPECT_LT(point.Distance(points[i]), 1e-2);
+	}
+}
+
+TEST(Test_Fitting, ParameterCorrection)
+{
+	int size = 200;
+	std::vector<XYZ> Q(size);
+	for (int i = 0; i < size; i++)
+	{
+		double t = 4.0 * pow((double)i / (size - 1), 2);
+		Q[i] = XYZ(10 * cos(t), 5 * sin(t), t);
+	}
+
+	LN_NurbsCurve curve;
+	LN_FittingReport report;
+	EXPECT_TRUE(NurbsCurve::LeastSquaresApproximation(3, Q, 12, 10, 0.0, curve, report));
+	EXPECT_EQ(report.MaxErrors.size(), report.RmsErrors.size());
+	EXPECT_LE(report.MaxErrors.size(), 11);
+	EXPECT_LT(report.MaxErrors.back(), report.MaxErrors.front());
+	EXPECT_LT(report.RmsErrors.back(), report.RmsErrors.front());
+	EXPECT_TRUE(NurbsCurve::GetPointOnCurve(curve, 0.0).IsAlmostEqualTo(Q[0]));
+	double maxError = 0.0;
+	for (int i = 0; i < size; i++)
+	{
+		maxError = std::max(maxError, NurbsCurve::GetPointOnCurve(curve, NurbsCurve::GetParamOnCurve(curve, Q[i])).Distance(Q[i]));
+	}
+	EXPECT_LE(maxError, *std::min_element(report.MaxErrors.begin(), report.MaxErrors.end()) + Constants::DistanceEpsilon);
+
+	int rows = 20;
+	int columns = 20;
+	std::vector<std::vector<XYZ>> points(rows, std::vector<XYZ>(columns));
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			double x = 3.0 * pow((double)i / (rows - 1), 2);
+			double y = 3.0 * j / (columns - 1);
+			points[i][j] = XYZ(x, y, sin(x) * cos(y));
+		}
+	}
+
+	LN_NurbsSurface surface;
+	LN_FittingReport surfaceReport;
+	EXPECT_TRUE(NurbsSurface::GlobalApproximation(points, 3, 3, 8, 8, 5, 0.0, surface, surfaceReport));
+	EXPECT_LE(surfaceReport.MaxErrors.size(), 6);
+	EXPECT_LT(surfaceReport.RmsErrors.back(), surfaceReport.RmsErrors.front());
+	EXPECT_TRUE(NurbsSurface::GetPointOnSurface(surface, UV(surface.KnotVectorU.front(), surface.KnotVectorV.front())).IsAlmostEqualTo(points[0][0]));
+	EXPECT_TRUE(NurbsSurface::GetPointOnSurface(surface, UV(surface.KnotVectorU.back(), surface.KnotVectorV.back())).IsAlmostEqualTo(points[rows - 1][columns - 1]));
+}
+
+TEST(Test_Fitting, ErrorBoundApproximation)
+{
+	int size = 20000;
+	std::vector<XYZ> Q(size);
+	for (int i = 0; i < size; i++)
+	{
+		double t = 12.0 * i / (size - 1);
+		Q[i] = XYZ(10 * cos(t), 10 * sin(t), 2 * t);
+	}
+
+	LN_NurbsCurve curve;
+	NurbsCurve::GlobalApproximationByErrorBound(3, Q, 1e-3, curve);
+	EXPECT_TRUE(ValidationUtils::IsValidNurbs(curve.Degree, curve.KnotVector.size(), curve.ControlPoints.size()));
+	EXPECT_LT(curve.ControlPoints.size(), size / 10);
+	std::vector<double> params = Interpolation::GetChordParameterization(Q);
+	for (int i = 0; i < size; i += 97)
+	{
+		EXPECT_LE(NurbsCurve::GetPointOnCurve(curve, params[i]).Distance(Q[i]), 1e-3);
+	}
+}
+
 TEST(Test_Fitting, Approximation)
 {
 	{
@@ -1,10 +1,12 @@
 ﻿#include "gtest/gtest.h"
 #include "XYZ.h"
 #include "XYZW.h"
+#include "UV.h"
 #include "NurbsCurve.h"
 #include "NurbsSurface.h"
 #include "ValidationUtils.h"
 #include "MathUtils.h"
+#include "KnotVectorUtils.h"
 #include "LNObject.h"
 using namespace LNLib;
 
@@ -43,6 +45,16 @@ TEST(Test_Fundamental, All)
 		EXPECT_TRUE(newCp[3].IsAlmostEqualTo(2.0 / 3 * P3 + 1.0 / 3 * P2));
 		EXPECT_TRUE(newCp[4].IsAlmostEqualTo(1.0 / 3 * P4 + 2.0 / 3 * P3));
 		EXPECT_TRUE(newCp[5].IsAlmostEqualTo(P4));
+
+		LN_KnotStructure structure;
+		KnotVectorUtils::CreateKnotStructure(degree, kv, structure);
+		LN_NurbsCurve structureCurve;
+		EXPECT_EQ(NurbsCurve::InsertKnot(curve, structure, insertKnot, 1, structureCurve), 1);
+		EXPECT_TRUE(structureCurve.KnotVector == newKv);
+		for (int i = 0; i < newCp.size(); i++)
+		{
+			EXPECT_TRUE(structureCurve.ControlPoints[i].IsAlmostEqualTo(newCp[i]));
+		}
 	}
 	
 	{
@@ -188,6 +200,13 @@ TEST(Test_Fundamental, All)
 		auto newCp = newCurve.ControlPoints;
 		EXPECT_TRUE(newKv.size() == 46 && newCp.size() == 41);
 		EXPECT_TRUE(newCp[20].ToXYZ(true).IsAlmostEqualTo(XYZ(55.9157986, 12.17447916,0)));
+
+		LN_KnotStructure structure;
+		KnotVectorUtils::CreateKnotStructure(degree, kv, structure);
+		LN_NurbsCurve structureCurve;
+		NurbsCurve::RefineKnotVector(curve, structure, ike, structureCurve);
+		EXPECT_TRUE(structureCurve.KnotVector == newKv);
+		EXPECT_TRUE(structureCurve.ControlPoints[20].IsAlmostEqualTo(newCp[20]));
 	}
 
 	{
@@ -341,4 +360,190 @@ TEST(Test_Fundamental, All)
 		EXPECT_TRUE(updatedCps[2].ToXYZ(true).IsAlmostEqualTo(XYZ(3, 0, 0)));
 		ValidationUtils::IsValidNurbs(degree - 1, updatedKv.size(), updatedCps.size());
 	}
-}
\ No newline at end of file
+}
+
+TEST(Test_Fundamental, RefineSurface)
+{
+	int rows = 120;
+	int columns = 150;
+	LN_NurbsSurface surface;
+	surface.DegreeU = 3;
+	surface.DegreeV = 2;
+	surface.KnotVectorU = std::vector<double>(rows + 4, 0.0);
+	surface.KnotVectorV = std::vector<double>(columns + 3, 0.0);
+	for (int i = 4; i < rows + 4; i++)
+	{
+		surface.KnotVectorU[i] = i < rows ? (i - 3.0) / (rows - 3) : 1.0;
+	}
+	for (int j = 3; j < columns + 3; j++)
+	{
+		surface.KnotVectorV[j] = j < columns ? (j - 2.0) / (columns - 2) : 1.0;
+	}
+	surface.ControlPoints = std::vector<std::vector<XYZW>>(rows, std::vector<XYZW>(columns));
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < columns; j++)
+		{
+			double w = 1.0 + 0.5 * std::sin(0.1 * (i + j));
+			surface.ControlPoints[i][j] = XYZW(XYZ(i, j, std::sin(0.2 * i) * std::cos(0.15 * j)), w);
+		}
+	}
+
+	std::vector<double> insertU;
+	std::vector<double> insertV;
+	for (int k = 1; k < 200; k++)
+	{
+		insertU.emplace_back(k / 200.0);
+		insertV.emplace_back(k / 200.0);
+		if (k == 100)
+		{
+			insertU.insert(insertU.end(), 2, 0.5);
+		}
+	}
+
+	LN_NurbsSurface refined;
+	NurbsSurface::RefineKnotVector(surface, insertU, insertV, refined);
+	EXPECT_EQ(refined.ControlPoints.size(), rows + insertU.size());
+	EXPECT_EQ(refined.ControlPoints[0].size(), columns + insertV.size());
+	EXPECT_TRUE(ValidationUtils::IsValidNurbs(refined.DegreeU, refined.KnotVectorU.size(), refined.ControlPoints.size()));
+	EXPECT_TRUE(ValidationUtils::IsValidNurbs(refined.DegreeV, refined.KnotVectorV.size(), refined.ControlPoints[0].size()));
+
+	LN_NurbsSurface inserted;
+	NurbsSurface::InsertKnot(surface, 0.37, 2, false, inserted);
+	EXPECT_EQ(inserted.ControlPoints[0].size(), columns + 2);
+
+	for (int i = 0; i <= 10; i++)
+	{
+		for (int j = 0; j <= 10; j++)
+		{
+			UV uv(i / 10.0, j / 10.0);
+			XYZ point = NurbsSurface::GetPointOnSurface(surface, uv);
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(refined, uv).IsAlmostEqualTo(point));
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(inserted, uv).IsAlmostEqualTo(point));
+		}
+	}
+}
+
+TEST(Test_Fundamental, SurfaceDegree)
+{
+	LN_NurbsSurface surface;
+	surface.DegreeU = 3;
+	surface.DegreeV = 2;
+	surface.KnotVectorU = { 0,0,0,0,0.2,0.4,0.4,0.7,1,1,1,1 };
+	surface.KnotVectorV = { 0,0,0,0.3,0.3,0.6,1,1,1 };
+	surface.ControlPoints = std::vector<std::vector<XYZW>>(8, std::vector<XYZW>(6));
+	for (int i = 0; i < 8; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			surface.ControlPoints[i][j] = XYZW(XYZ(i, j, std::sin(0.7 * i) * std::cos(0.9 * j)), 1.0 + 0.1 * ((i + j) % 3));
+		}
+	}
+
+	LN_NurbsSurface elevatedU;
+	NurbsSurface::ElevateDegree(surface, 2, true, elevatedU);
+	LN_NurbsSurface elevated;
+	NurbsSurface::ElevateDegree(elevatedU, 1, false, elevated);
+	EXPECT_EQ(elevated.DegreeU, 5);
+	EXPECT_EQ(elevated.DegreeV, 3);
+	EXPECT_TRUE(ValidationUtils::IsValidNurbs(elevated.DegreeU, elevated.KnotVectorU.size(), elevated.ControlPoints.size()));
+	EXPECT_TRUE(ValidationUtils::IsValidNurbs(elevated.DegreeV, elevated.KnotVectorV.size(), elevated.ControlPoints[0].size()));
+
+	// Each column matches the curve algorithm.
+	LN_NurbsCurve column;
+	column.Degree = surface.DegreeU;
+	column.KnotVector = surface.KnotVectorU;
+	for (int i = 0; i < 8; i++)
+	{
+		column.ControlPoints.emplace_back(surface.ControlPoints[i][2]);
+	}
+	LN_NurbsCurve elevatedColumn;
+	NurbsCurve::ElevateDegree(column, 2, elevatedColumn);
+	EXPECT_EQ(elevatedColumn.KnotVector, elevatedU.KnotVectorU);
+	for (int i = 0; i < elevatedColumn.ControlPoints.size(); i++)
+	{
+		EXPECT_TRUE(elevatedColumn.ControlPoints[i].IsAlmostEqualTo(elevatedU.ControlPoints[i][2]));
+	}
+
+	for (int i = 0; i <= 10; i++)
+	{
+		for (int j = 0; j <= 10; j++)
+		{
+			UV uv(i / 10.0, j / 10.0);
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(elevated, uv).IsAlmostEqualTo(NurbsSurface::GetPointOnSurface(surface, uv)));
+		}
+	}
+
+	// A Bezier surface elevated once reduces back to itself.
+	LN_NurbsSurface bezier;
+	bezier.DegreeU = 2;
+	bezier.DegreeV = 3;
+	bezier.KnotVectorU = { 0,0,0,1,1,1 };
+	bezier.KnotVectorV = { 0,0,0,0,1,1,1,1 };
+	bezier.ControlPoints = std::vector<std::vector<XYZW>>(3, std::vector<XYZW>(4));
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			bezier.ControlPoints[i][j] = XYZW(i, j, (i - 1) * std::pow(j - 1.5, 3), 1);
+		}
+	}
+	LN_NurbsSurface elevatedBezier;
+	NurbsSurface::ElevateDegree(bezier, 1, true, elevatedBezier);
+	LN_NurbsSurface reduced;
+	EXPECT_TRUE(NurbsSurface::ReduceDegree(elevatedBezier, true, reduced));
+	EXPECT_EQ(reduced.DegreeU, 2);
+	EXPECT_EQ(reduced.KnotVectorU, bezier.KnotVectorU);
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			EXPECT_TRUE(reduced.ControlPoints[i][j].IsAlmostEqualTo(bezier.ControlPoints[i][j]));
+		}
+	}
+	EXPECT_FALSE(NurbsSurface::ReduceDegree(bezier, false, reduced));
+}
+
+TEST(Test_Fundamental, DecomposeSurface)
+{
+	LN_NurbsSurface surface;
+	surface.DegreeU = 3;
+	surface.DegreeV = 2;
+	surface.KnotVectorU = { 0,0,0,0,0.2,0.4,0.4,0.7,1,1,1,1 };
+	surface.KnotVectorV = { 0,0,0,0.3,0.3,0.6,1,1,1 };
+	surface.ControlPoints = std::vector<std::vector<XYZW>>(8, std::vector<XYZW>(6));
+	for (int i = 0; i < 8; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			surface.ControlPoints[i][j] = XYZW(XYZ(i, j, std::sin(0.7 * i) * std::cos(0.9 * j)), 1.0 + 0.1 * ((i + j) % 3));
+		}
+	}
+
+	LN_BezierPatches patches;
+	NurbsSurface::DecomposeToBeziers(surface, patches);
+	EXPECT_EQ(patches.SpansU, std::vector<int>({ 3, 4, 6, 7 }));
+	EXPECT_EQ(patches.SpansV, std::vector<int>({ 2, 4, 5 }));
+	EXPECT_EQ(patches.ParamsU, std::vector<double>({ 0, 0.2, 0.4, 0.7, 1 }));
+	EXPECT_EQ(patches.ControlPoints.size(), 12 * 4 * 3);
+
+	std::vector<LN_NurbsSurface> beziers = NurbsSurface::DecomposeToBeziers(surface);
+	EXPECT_EQ(beziers.size(), 12);
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			const LN_NurbsSurface& bezier = beziers[i * 3 + j];
+			EXPECT_TRUE(bezier.ControlPoints[1][2].IsAlmostEqualTo(patches.ControlPoints[(i * 3 + j) * 12 + 1 * 3 + 2]));
+			for (int k = 0; k <= 4; k++)
+			{
+				double s = k / 4.0;
+				double t = 1.0 - s;
+				double u = patches.ParamsU[i] + s * (patches.ParamsU[i + 1] - patches.ParamsU[i]);
+				double v = patches.ParamsV[j] + t * (patches.ParamsV[j + 1] - patches.ParamsV[j]);
+				XYZ point = NurbsSurface::GetPointOnSurface(surface, UV(u, v));
+				EXPECT_TRUE(NurbsSurface::GetPointOnSurface(bezier, UV(s, t)).IsAlmostEqualTo(point));
+			}
+		}
+	}
+}
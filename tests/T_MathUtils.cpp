@@ -19,3 +19,64 @@ TEST(Test_MathUtils, Binomial)
 	double bi = MathUtils::Binomial(5, 3);
 	EXPECT_TRUE(MathUtils::IsAlmostEqualTo(bi, 10.0));
 }
+
+TEST(Test_MathUtils, SolveBandedLinearSystem)
+{
+	int lower = 1;
+	int upper = 2;
+	std::vector<std::vector<double>> band = { {0,1,2,3}, {4,0,5,6}, {7,8,9,1}, {2,3,4,0}, {5,6,0,0} };
+	std::vector<std::vector<double>> matrix(5, std::vector<double>(5, 0.0));
+	for (int i = 0; i < 5; i++)
+	{
+		for (int j = std::max(0, i - lower); j <= std::min(4, i + upper); j++)
+		{
+			matrix[i][j] = band[i][j - i + lower];
+		}
+	}
+	std::vector<std::vector<double>> right = { {1,2}, {3,4}, {5,6}, {7,8}, {9,10} };
+
+	MatrixXd result;
+	EXPECT_TRUE(MathUtils::SolveBandedLinearSystem(MatrixXd(band), lower, upper, MatrixXd(right), result));
+	std::vector<std::vector<double>> standard = MathUtils::SolveLinearSystem(matrix, right);
+	for (int i = 0; i < 5; i++)
+	{
+		for (int j = 0; j < 2; j++)
+		{
+			EXPECT_NEAR(result(i, j), standard[i][j], Constants::DoubleEpsilon);
+		}
+	}
+
+	std::vector<std::vector<double>> singular = { {0,1,0,0}, {0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {0,1,0,0} };
+	EXPECT_FALSE(MathUtils::SolveBandedLinearSystem(MatrixXd(singular), lower, upper, MatrixXd(right), result));
+}
+
+TEST(Test_MathUtils, MatrixXd)
+{
+	MatrixXd matrix({ {4,1,2}, {1,5,3}, {2,3,6} });
+	EXPECT_NEAR(MathUtils::GetDeterminant(matrix), 70.0, Constants::DoubleEpsilon);
+
+	MatrixXd inverse;
+	EXPECT_TRUE(MathUtils::MakeInverse(matrix, inverse));
+	MatrixXd identity = MathUtils::MatrixMultiply(matrix, inverse);
+	MatrixXd right({ {1,0}, {2,1}, {3,2} });
+	MatrixXd result = MathUtils::SolveLinearSystem(matrix, right);
+	MatrixXd product = MathUtils::MatrixMultiply(matrix, result);
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			EXPECT_NEAR(identity(i, j), i == j ? 1.0 : 0.0, Constants::DoubleEpsilon);
+		}
+		for (int j = 0; j < 2; j++)
+		{
+			EXPECT_NEAR(product(i, j), right(i, j), Constants::DoubleEpsilon);
+		}
+	}
+
+	MatrixXd transposed = right.GetTranspose();
+	EXPECT_EQ(transposed.GetRowCount(), 2);
+	EXPECT_EQ(transposed(1, 2), 2.0);
+	right.Resize(4, 1);
+	EXPECT_EQ(right(2, 0), 3.0);
+	EXPECT_EQ(right(3, 0), 0.0);
+}
@@ -3,6 +3,8 @@
 #include "XYZ.h"
 #include "XYZW.h"
 #include "MathUtils.h"
+#include <cmath>
+#include <vector>
 using namespace LNLib;
 
 TEST(Test_Matrix4d, Construct)
@@ -135,5 +137,30 @@ TEST(Test_Matrix4d, OperatorOverride)
 	EXPECT_TRUE(add.IsIdentity());
 }
 
+TEST(Test_Matrix4d, OfWeightedPoints)
+{
+	int count = 10000;
+	std::vector<XYZW> points(count);
+	for (int i = 0; i < count; i++)
+	{
+		points[i] = XYZW(XYZ(std::sin(i), std::cos(0.5 * i), 0.01 * i), 1.0 + 0.5 * (i % 3));
+	}
 
-
+	Matrix4d affine = Matrix4d::CreateRotationAtPoint(XYZ(1, 2, 3), XYZ(1, 1, 0).Normalize(), 0.7) * Matrix4d::CreateScale(XYZ(2, 3, 4));
+	Matrix4d projective = Matrix4d(1, 0, 0, 2, 0, 1, 0, 0, 0, 0, 1, 0, 0.1, 0, 0, 1);
+	std::vector<Matrix4d> matrices = { affine, projective };
+	for (int k = 0; k < matrices.size(); k++)
+	{
+		Matrix4d& matrix = matrices[k];
+		std::vector<XYZW> transformed(count);
+		matrix.OfWeightedPoints(points.data(), count, transformed.data());
+		std::vector<XYZW> inPlace = points;
+		matrix.OfWeightedPoints(inPlace.data(), count, inPlace.data());
+		for (int i = 0; i < count; i++)
+		{
+			XYZW expected = matrix.OfWeightedPoint(points[i]);
+			EXPECT_TRUE(transformed[i].IsAlmostEqualTo(expected));
+			EXPECT_TRUE(inPlace[i].IsAlmostEqualTo(expected));
+		}
+	}
+}
@@ -4,6 +4,7 @@
 #include "XYZW.h"
 #include "NurbsSurface.h"
 #include "LNObject.h"
+#include "Matrix4d.h"
 using namespace LNLib;
 
 TEST(Test_NurbsSurface, All)
@@ -85,4 +86,30 @@ TEST(Test_NurbsSurface, All)
 
 	std::vector<std::vector<XYZ>> ders =  NurbsSurface::ComputeRationalSurfaceDerivatives(surface,1,uv);
 	EXPECT_TRUE(ders[0][0].IsAlmostEqualTo(XYZ(2, 98.0 / 27, 68.0 / 27)));
-}
\ No newline at end of file
+}
+
+TEST(Test_NurbsSurface, CreateTransformed)
+{
+	LN_NurbsSurface surface;
+	surface.DegreeU = 2;
+	surface.DegreeV = 1;
+	surface.KnotVectorU = { 0,0,0,1,1,1 };
+	surface.KnotVectorV = { 0,0,1,1 };
+	surface.ControlPoints = { { XYZW(0,0,0,1), XYZW(0,4,0,1) }, { XYZW(1,1,2,2), XYZW(1,5,2,2) }, { XYZW(2,0,0,1), XYZW(2,4,1,1) } };
+
+	Matrix4d matrix = Matrix4d::CreateTranslation(XYZ(3, -1, 2)) * Matrix4d::CreateRotation(XYZ(0, 0, 1), 1.2);
+	std::vector<LN_NurbsSurface> surfaces(100, surface);
+	std::vector<LN_NurbsSurface> transformed;
+	NurbsSurface::CreateTransformed(surfaces, matrix, transformed);
+	ASSERT_EQ(transformed.size(), surfaces.size());
+	for (int i = 0; i < transformed.size(); i++)
+	{
+		EXPECT_TRUE(transformed[i].KnotVectorU == surface.KnotVectorU);
+		for (int a = 0; a <= 4; a++)
+		{
+			UV uv(a / 4.0, 1.0 - a / 4.0);
+			XYZ expected = matrix.OfPoint(NurbsSurface::GetPointOnSurface(surface, uv));
+			EXPECT_TRUE(NurbsSurface::GetPointOnSurface(transformed[i], uv).IsAlmostEqualTo(expected));
+		}
+	}
+}
@@ -2,6 +2,7 @@
 #include "Polynomials.h"
 #include "MathUtils.h"
 #include "KnotVectorUtils.h"
+#include "LNObject.h"
 
 using namespace LNLib;
 
@@ -75,4 +76,40 @@ TEST(Test_Polynomials, All)
 	KnotVectorUtils::GetInsertedKnotElement(u1, u2, i1, i2);
 	EXPECT_TRUE(i1.size() == 4);
 	EXPECT_TRUE(i2.size() == 3);
-}
\ No newline at end of file
+}
+
+TEST(Test_Polynomials, KnotStructure)
+{
+	int degree = 2;
+	std::vector<double> knotVector = { 0,0,0,1,2,2,4,4,4 };
+	LN_KnotStructure structure;
+	KnotVectorUtils::CreateKnotStructure(degree, knotVector, structure);
+	EXPECT_TRUE(structure.Knots == std::vector<double>({ 0,1,2,4 }));
+	EXPECT_TRUE(structure.Multiplicities == std::vector<int>({ 3,1,2,3 }));
+	EXPECT_TRUE(structure.SpanStarts == std::vector<int>({ 2,3,5,8 }));
+	EXPECT_TRUE(structure.Continuities == std::vector<int>({ -1,1,0,-1 }));
+
+	for (int i = 1; i < structure.Knots.size() - 1; i++)
+	{
+		double knot = structure.Knots[i];
+		EXPECT_EQ(structure.SpanStarts[i], Polynomials::GetKnotSpanIndex(degree, knotVector, knot));
+		EXPECT_EQ(structure.Multiplicities[i], Polynomials::GetKnotMultiplicity(knotVector, knot));
+		EXPECT_EQ(structure.Continuities[i], KnotVectorUtils::GetContinuity(degree, knotVector, knot));
+	}
+	for (double knot : { 0.0, 0.5, 1.0, 2.0, 3.0, 4.0 })
+	{
+		EXPECT_EQ(KnotVectorUtils::GetKnotSpanIndex(structure, knot), Polynomials::GetKnotSpanIndex(degree, knotVector, knot));
+	}
+
+	EXPECT_EQ(KnotVectorUtils::GetKnotIndex(structure, 2.0 + 1E-9), 2);
+	EXPECT_EQ(KnotVectorUtils::GetKnotIndex(structure, 3.0), -1);
+	EXPECT_EQ(KnotVectorUtils::GetKnotMultiplicity(structure, 4.0), 3);
+	EXPECT_EQ(KnotVectorUtils::GetKnotMultiplicity(structure, 0.5), 0);
+	EXPECT_EQ(KnotVectorUtils::GetContinuity(structure, 0.5), degree);
+	EXPECT_EQ(Polynomials::GetKnotMultiplicity(knotVector, 3.0), 0);
+
+	auto map = KnotVectorUtils::GetKnotMultiplicityMap(knotVector);
+	EXPECT_EQ(map.size(), structure.Knots.size());
+	EXPECT_EQ(map[2.0], 2);
+	EXPECT_EQ(KnotVectorUtils::GetInternalKnotMultiplicityMap(knotVector).size(), 2);
+}